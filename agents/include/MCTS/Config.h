@@ -2,6 +2,8 @@
 
 #include <type_traits>
 
+#include "neural_net/NeuralNetwork.h"
+
 namespace mcts
 {
 	namespace policy {
@@ -12,6 +14,7 @@ namespace mcts
 
 		namespace selection {
 			class UCBPolicy;
+			class PUCTPolicy;
 		}
 
 		namespace simulation {
@@ -38,8 +41,15 @@ namespace mcts
 		using UpdaterPolicy = updater_policy::TreeUpdate;
 
 		using SelectionPhaseRandomActionPolicy = policy::RandomByMt19937;
-		using SelectionPhaseSelectActionPolicy = policy::selection::UCBPolicy;
+		using SelectionPhaseSelectActionPolicy = policy::selection::PUCTPolicy;
 		static constexpr int kVirtualLoss = 3;
+
+		// Progressive widening for the sub-actions with large equivalent-ish branching
+		// (targets, minion put locations, choose-one): a node visited n times expands at most
+		// floor(kWideningBase * n ^ kWideningExponent) + 1 children. Main actions are always fully expanded.
+		static constexpr bool kProgressiveWidening = true;
+		static constexpr double kWideningBase = 1.0;
+		static constexpr double kWideningExponent = 0.5;
 		static constexpr bool kRecordLeadingNodes = std::is_same_v<UpdaterPolicy, updater_policy::TreeUpdate>;
 
 		using SimulationPhaseRandomActionPolicy = policy::RandomByMt19937;
@@ -51,7 +61,12 @@ namespace mcts
 	// Thread safety: Yes
 	class Config {
 	public:
-		Config() : neural_net_path_() {}
+		Config() :
+			neural_net_path_(), neural_net_is_random_(false),
+			neural_net_precision_(neural_net::InferencePrecision::kFloat),
+			leaf_playouts_(1),
+			policy_priors_(true)
+		{}
 
 		void SetNeuralNetPath(std::string const& filename, bool is_random = false) {
 			neural_net_path_ = filename;
@@ -60,9 +75,27 @@ namespace mcts
 		std::string const& GetNeuralNetPath() const { return neural_net_path_; }
 		bool IsNeuralNetRandom() const { return neural_net_is_random_; }
 
-		
+		// Quantized inference trades a little accuracy of the state values for speed and cache footprint
+		// Use neural_net::NeuralNetwork::MeasureQuantization() to check the accuracy loss.
+		void SetNeuralNetPrecision(neural_net::InferencePrecision precision) { neural_net_precision_ = precision; }
+		neural_net::InferencePrecision GetNeuralNetPrecision() const { return neural_net_precision_; }
+
+		// Number of simulations run from each selected leaf
+		// The averaged credit is back-propagated once, with the visits counted 'playouts' times
+		void SetLeafPlayouts(int playouts) { leaf_playouts_ = playouts; }
+		int GetLeafPlayouts() const { return leaf_playouts_; }
+
+		// Guide the selection of the main actions by the priors of the policy network (PUCT)
+		// The policy network is loaded beside the neural net; see neural_net::PolicyNetwork::GetPath().
+		// Without a trained policy network, the selection falls back to UCB.
+		void SetPolicyPriors(bool enabled) { policy_priors_ = enabled; }
+		bool IsPolicyPriorsEnabled() const { return policy_priors_; }
+
 	private:
 		std::string neural_net_path_;
 		bool neural_net_is_random_;
+		neural_net::InferencePrecision neural_net_precision_;
+		int leaf_playouts_;
+		bool policy_priors_;
 	};
 }
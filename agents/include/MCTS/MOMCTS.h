@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+
 #include "MCTS/SOMCTS.h"
 
 namespace mcts
@@ -11,42 +13,95 @@ namespace mcts
 		MOMCTS(
 			selection::TreeNode & first_tree,
 			selection::TreeNode & second_tree,
-			Statistic<> & statistic,
+			selection::TreeMemoryUsage & memory_usage,
+			ThreadStatistic<> & statistic,
 			std::mt19937 & selection_rand, std::mt19937 & simulation_rand,
+			policy::simulation::NeuralNetworkStateValueFunction & state_value_func,
 			Config const& config
 		) :
+			statistic_(statistic),
+			leaf_playouts_(std::max(1, config.GetLeafPlayouts())),
 			side_controller_(),
-			first_(first_tree, statistic, selection_rand, simulation_rand, config),
-			second_(second_tree, statistic, selection_rand, simulation_rand, config)
+			first_(first_tree, memory_usage, statistic, selection_rand, simulation_rand, state_value_func, config),
+			second_(second_tree, memory_usage, statistic, selection_rand, simulation_rand, state_value_func, config)
 		{}
 
 		template <class... StartArgs>
 		void Iterate(StartArgs&&... start_args)
 		{
-			side_controller_.StartEpisode(std::forward<StartArgs>(start_args)...);
+			StartEpisode(std::forward<StartArgs>(start_args)...);
+			bool finished = Continue(false);
+			assert(finished);
+			(void)finished;
+		}
+
+		// Like Iterate(), but the iteration suspends when the state value of a leaf is needed;
+		// so the caller can estimate the state values of many suspended iterations in a batch.
+		// The trees are not locked while suspended, but the virtual losses are kept on the path.
+		// @return  true if the iteration is finished; false if it should be resumed by ResumeIterate()
+		template <class... StartArgs>
+		bool StartIterate(StartArgs&&... start_args)
+		{
+			StartEpisode(std::forward<StartArgs>(start_args)...);
+			return Continue(true);
+		}
+
+		// The state to estimate for a suspended iteration
+		// Hidden information is revealed; see engine::view::Board::RevealHiddenInformationForSimulation()
+		state::State const& GetPendingState() const {
+			assert(first_.IsStateValueRequested() || second_.IsStateValueRequested());
+			return side_controller_.GetCurrentState();
+		}
+
+		void ResumeIterate(StateValue state_value) {
+			assert(first_.IsStateValueRequested() || second_.IsStateValueRequested());
+			FinishIteration(state_value, 1);
+		}
+
+		auto GetRootNode(StaticConfigs::SideController::Side side) const {
+			return GetSOMCTS(side).GetRootNode();
+		}
+
+	private:
+		template <class... StartArgs>
+		void StartEpisode(StartArgs&&... start_args)
+		{
+			{
+				auto timer = statistic_.Measure(kStatisticStageStateRestore);
+				side_controller_.StartEpisode(std::forward<StartArgs>(start_args)...);
+			}
 			first_.StartIteration();
 			second_.StartIteration();
+		}
 
+		// @param defer_state_value  Suspend at an early cutoff, instead of estimating the state value
+		// @return  true if the iteration is finished; false if suspended
+		bool Continue(bool defer_state_value)
+		{
 			while (true)
 			{
 				StaticConfigs::SideController::Side side = side_controller_.GetActionSide();
 				
 				GetSOMCTS(side).StartActions();
 				bool iteration_ends = false;
+				int repeat_times = 1;
 				StateValue state_value;
 				while (side_controller_.GetActionSide() == side) {
-					iteration_ends = GetSOMCTS(side).PerformAction(side_controller_.GetSideView(side), state_value);
+					if (leaf_playouts_ > 1 && first_.IsInSimulation() && second_.IsInSimulation()) {
+						state_value = RunLeafPlayouts();
+						repeat_times = leaf_playouts_;
+						iteration_ends = true;
+						break;
+					}
+
+					iteration_ends = GetSOMCTS(side).PerformAction(side_controller_.GetSideView(side), state_value, defer_state_value);
 					if (iteration_ends) break;
 				}
 
 				if (iteration_ends) {
-					first_.FinishIteration(
-						side_controller_.GetSideView(StaticConfigs::SideController::Side::First()),
-						state_value);
-					second_.FinishIteration(
-						side_controller_.GetSideView(StaticConfigs::SideController::Side::Second()),
-						state_value);
-					break;
+					if (GetSOMCTS(side).IsStateValueRequested()) return false;
+					FinishIteration(state_value, repeat_times);
+					return true;
 				}
 
 				GetSOMCTS(side.Opposite()).ApplyOthersActions(
@@ -54,11 +109,46 @@ namespace mcts
 			}
 		}
 
-		auto GetRootNode(StaticConfigs::SideController::Side side) const {
-			return GetSOMCTS(side).GetRootNode();
+		void FinishIteration(StateValue state_value, int repeat_times) {
+			auto timer = statistic_.Measure(kStatisticStageBackPropagation);
+			first_.FinishIteration(
+				side_controller_.GetSideView(StaticConfigs::SideController::Side::First()),
+				state_value, repeat_times);
+			second_.FinishIteration(
+				side_controller_.GetSideView(StaticConfigs::SideController::Side::Second()),
+				state_value, repeat_times);
+		}
+
+		// Both trees are in simulation stage, so the remaining playout does not touch the trees.
+		// Run it 'leaf_playouts_' times from the same leaf, and return the averaged value.
+		// This amortizes the selection and back-propagation (and their locks) over several simulations.
+		StateValue RunLeafPlayouts() {
+			state::State const leaf_state = side_controller_.GetCurrentState();
+
+			float sum = 0.0f;
+			for (int i = 0; i < leaf_playouts_; ++i) {
+				if (i > 0) {
+					auto timer = statistic_.Measure(kStatisticStageStateRestore);
+					side_controller_.StartEpisode([&]() -> state::State const& { return leaf_state; });
+				}
+				sum += RunPlayout().GetValue(state::kPlayerFirst);
+			}
+
+			StateValue state_value;
+			state_value.SetValue(sum / leaf_playouts_, state::kPlayerFirst);
+			return state_value;
+		}
+
+		StateValue RunPlayout() {
+			StateValue state_value;
+			while (true) {
+				auto side = side_controller_.GetActionSide();
+				assert(GetSOMCTS(side).IsInSimulation());
+				if (GetSOMCTS(side).PerformAction(side_controller_.GetSideView(side), state_value)) break;
+			}
+			return state_value;
 		}
 
-	private:
 		SOMCTS & GetSOMCTS(StaticConfigs::SideController::Side side) {
 			if (side.IsFirst()) return first_;
 			else {
@@ -76,6 +166,8 @@ namespace mcts
 		}
 
 	private:
+		ThreadStatistic<> & statistic_;
+		int leaf_playouts_;
 		StaticConfigs::SideController side_controller_;
 		SOMCTS first_;
 		SOMCTS second_;
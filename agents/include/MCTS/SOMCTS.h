@@ -65,11 +65,14 @@ namespace mcts
 		};
 
 	public:
-		SOMCTS(selection::TreeNode & tree, Statistic<> & statistic, 
+		SOMCTS(selection::TreeNode & tree, selection::TreeMemoryUsage & memory_usage,
+			ThreadStatistic<> & statistic,
 			std::mt19937 & selection_rand, std::mt19937 & simulation_rand,
+			policy::simulation::NeuralNetworkStateValueFunction & state_value_func,
 			Config const& config) :
-			action_cb_(*this), stage_(Stage::kStageSelection),
-			selection_stage_(tree, selection_rand, config), simulation_stage_(simulation_rand, config),
+			action_cb_(*this), stage_(Stage::kStageSelection), state_value_requested_(false),
+			selection_stage_(tree, memory_usage, selection_rand, config, state_value_func.GetPolicy()),
+			simulation_stage_(simulation_rand, config, state_value_func),
 			statistic_(statistic)
 		{}
 
@@ -82,21 +85,41 @@ namespace mcts
 		{
 			selection_stage_.StartIteration();
 			stage_ = kStageSelection;
+			state_value_requested_ = false;
 		}
 
 		void StartActions() {
 		}
 
+		// The tree is not touched until FinishIteration() once in simulation stage
+		bool IsInSimulation() const { return stage_ == kStageSimulation; }
+
+		// True if the last PerformAction() cut off the simulation with 'defer_state_value',
+		// so the caller should estimate the state value of the current board
+		bool IsStateValueRequested() const { return state_value_requested_; }
+
 		// return true if iteration should end (early cutoff, or game ends)
-		bool PerformAction(engine::view::Board const& board, StateValue & state_value)
+		// @param defer_state_value  At an early cutoff, do not estimate the state value; see IsStateValueRequested()
+		bool PerformAction(engine::view::Board const& board, StateValue & state_value, bool defer_state_value = false)
 		{
 			assert(board.GetCurrentPlayer().GetSide() == board.GetViewSide());
 
+			auto timer = statistic_.Measure(
+				(stage_ == kStageSimulation) ? kStatisticStageSimulation : kStatisticStageSelection);
+
 			action_cb_.Initialize(board);
 
 			engine::Result result;
 			if (stage_ == kStageSimulation) {
-				if (simulation_stage_.CutoffCheck(board, state_value)) return true;
+				if (defer_state_value) {
+					if (simulation_stage_.CutoffCheckWithoutStateValue()) {
+						state_value_requested_ = true;
+						return true;
+					}
+				}
+				else {
+					if (simulation_stage_.CutoffCheck(board, state_value)) return true;
+				}
 				
 				simulation_stage_.StartAction(board, action_cb_.GetAnalyzer());
 
@@ -139,16 +162,16 @@ namespace mcts
 			selection_stage_.ApplyOthersActions(board);
 		}
 
-		void FinishIteration(engine::view::Board const& board, StateValue state_value)
+		void FinishIteration(engine::view::Board const& board, StateValue state_value, int repeat_times = 1)
 		{
-			selection_stage_.FinishIteration(board, state_value);
+			selection_stage_.FinishIteration(board, state_value, repeat_times);
 		}
 		
 		int ChooseAction(engine::view::Board const& board, engine::ActionType action_type, engine::ActionChoices & choices) {
 			assert(!choices.Empty());
 
 			if (stage_ == kStageSelection) {
-				int choice = selection_stage_.ChooseAction(action_type, choices);
+				int choice = selection_stage_.ChooseAction(board, action_cb_.GetAnalyzer(), action_type, choices);
 				assert(choice >= 0); // always return a valid choice
 				return choice;
 			}
@@ -166,8 +189,9 @@ namespace mcts
 	private:
 		ActionParameterGetter action_cb_;
 		Stage stage_;
+		bool state_value_requested_;
 		selection::Selection selection_stage_;
 		simulation::Simulation simulation_stage_;
-		Statistic<> & statistic_;
+		ThreadStatistic<> & statistic_;
 	};
 }
@@ -1,98 +1,313 @@
 #pragma once
 
+#include <array>
 #include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
 #include <sstream>
+#include <vector>
 
 #include "MCTS/Config.h"
 
 namespace mcts
 {
-	// Thread safety: Yes
-	template <bool enabled = mcts::StaticConfigs::enable_statistic>
-	class Statistic {
-	public:
-		void ApplyActionSucceeded(bool is_simulation) {}
-		void GetDebugMessage() {}
+	enum StatisticStage {
+		kStatisticStageStateRestore,
+		kStatisticStageSelection,
+		kStatisticStageSimulation,
+		kStatisticStageBackPropagation,
+		kStatisticStageCount
 	};
 
 	namespace detail {
+		// Written by only one thread, and read by any thread
+		// So no atomic read-modify-write is needed
+		class ThreadCounter {
+		public:
+			ThreadCounter() : v_(0) {}
+
+			void Add(uint64_t v) {
+				v_.store(v_.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+			}
+			uint64_t Get() const { return v_.load(std::memory_order_relaxed); }
+
+		private:
+			std::atomic<uint64_t> v_;
+		};
+
 		class SuccessRateRecorder {
 		public:
-			SuccessRateRecorder() : success_(0), total_(0) {}
+			SuccessRateRecorder() : success_(), total_() {}
 
 			void ReportSuccess() {
-				++success_;
-				++total_;
+				success_.Add(1);
+				total_.Add(1);
 			}
 			void ReportFailed() {
-				++total_;
+				total_.Add(1);
 			}
 
-			int GetSuccessCount() const { return success_; }
-			int GetTotalCount() const { return total_; }
+			uint64_t GetSuccessCount() const { return success_.Get(); }
+			uint64_t GetTotalCount() const { return total_.Get(); }
+
+		private:
+			ThreadCounter success_;
+			ThreadCounter total_;
+		};
+
+		// Bucket i counts durations in [2^i, 2^(i+1)) nanoseconds
+		class TimeHistogram {
+		public:
+			static constexpr int kBuckets = 40;
+
+			TimeHistogram() : buckets_(), total_ns_() {}
+
+			void Record(std::chrono::steady_clock::duration duration) {
+				auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+				if (ns < 0) ns = 0;
 
-			double GetSuccessRate() const {
-				if (total_ == 0) return 0.0;
-				return (double)success_ / total_;
+				int bucket = 0;
+				while (bucket < kBuckets - 1 && (ns >> (bucket + 1)) > 0) ++bucket;
+				buckets_[bucket].Add(1);
+				total_ns_.Add((uint64_t)ns);
 			}
 
+			uint64_t GetCount(int bucket) const { return buckets_[bucket].Get(); }
+			uint64_t GetTotalNanoseconds() const { return total_ns_.Get(); }
+
 		private:
-			std::atomic<int> success_;
-			std::atomic<int> total_;
+			std::array<ThreadCounter, kBuckets> buckets_;
+			ThreadCounter total_ns_;
 		};
 	}
 
-	// Thread safety: Yes
-	template <> class Statistic<true>
-	{
+	// Statistic of one search thread. Each thread writes to its own instance,
+	// which is cache-line aligned, so no contention happens on the hot path.
+	// Thread safety: Only one writer. Readers can read from any thread.
+	template <bool enabled = mcts::StaticConfigs::enable_statistic>
+	class alignas(64) ThreadStatistic {
+	public:
+		struct StageTimer {
+			~StageTimer() {}
+		};
+
+		ThreadStatistic() : iterate_() {}
+
+		// The iteration count is always recorded, since it is used as a budget
+		void IterateSucceeded() { iterate_.Add(1); }
+		void IterateFailed() {}
+		uint64_t GetSuccededIterates() const { return iterate_.Get(); }
+
+		void ApplyActionSucceeded(bool is_simulation) {}
+
+		StageTimer Measure(StatisticStage stage) { return StageTimer(); }
+
+		void StartRunning(int cpu) {}
+		void StopRunning() {}
+
+	private:
+		detail::ThreadCounter iterate_;
+	};
+
+	template <>
+	class alignas(64) ThreadStatistic<true> {
 	public:
-		Statistic() : iterate_(), selection_(), simulation_() {}
+		// Record the duration of a stage on destruction
+		class StageTimer {
+		public:
+			StageTimer(detail::TimeHistogram & histogram) :
+				histogram_(&histogram), start_(std::chrono::steady_clock::now())
+			{}
+
+			StageTimer(StageTimer const&) = delete;
+			StageTimer & operator=(StageTimer const&) = delete;
+
+			StageTimer(StageTimer && rhs) : histogram_(rhs.histogram_), start_(rhs.start_) {
+				rhs.histogram_ = nullptr;
+			}
+			StageTimer & operator=(StageTimer &&) = delete;
+
+			~StageTimer() {
+				if (histogram_) histogram_->Record(std::chrono::steady_clock::now() - start_);
+			}
+
+		private:
+			detail::TimeHistogram * histogram_;
+			std::chrono::steady_clock::time_point start_;
+		};
+
+		ThreadStatistic() : iterate_(), selection_(), simulation_(), stages_(),
+			cpu_(-1), running_start_ns_(0), running_ns_()
+		{}
 
 		void IterateSucceeded() { iterate_.ReportSuccess(); }
 		void IterateFailed() { iterate_.ReportFailed(); }
-		auto GetSuccededIterates() const { return iterate_.GetSuccessCount(); }
+		uint64_t GetSuccededIterates() const { return iterate_.GetSuccessCount(); }
 
 		void ApplyActionSucceeded(bool is_simulation) {
 			if (is_simulation) return simulation_.ReportSuccess();
 			else return selection_.ReportSuccess();
 		}
 
-		void ApplySelectionActionSucceeded() {
-			selection_.ReportSuccess();
+		StageTimer Measure(StatisticStage stage) { return StageTimer(stages_[stage]); }
+
+		// Called by the worker thread when it starts/stops searching
+		// @param cpu  The CPU the thread is pinned to; or -1 if not pinned
+		void StartRunning(int cpu) {
+			cpu_.store(cpu, std::memory_order_relaxed);
+			running_start_ns_.store(GetNowNanoseconds(), std::memory_order_relaxed);
+		}
+		void StopRunning() {
+			auto start = running_start_ns_.exchange(0, std::memory_order_relaxed);
+			if (start > 0) running_ns_.Add((uint64_t)(GetNowNanoseconds() - start));
 		}
 
-		void ApplySimulationActionSucceeded() {
-			simulation_.ReportSuccess();
+		int GetCpu() const { return cpu_.load(std::memory_order_relaxed); }
+
+		// Including the current run, if the thread is still running
+		uint64_t GetRunningNanoseconds() const {
+			uint64_t ret = running_ns_.Get();
+			auto start = running_start_ns_.load(std::memory_order_relaxed);
+			if (start > 0) ret += (uint64_t)(GetNowNanoseconds() - start);
+			return ret;
+		}
+
+		auto const& GetIterate() const { return iterate_; }
+		auto const& GetSelection() const { return selection_; }
+		auto const& GetSimulation() const { return simulation_; }
+		auto const& GetStage(StatisticStage stage) const { return stages_[stage]; }
+
+	private:
+		detail::SuccessRateRecorder iterate_;
+		detail::SuccessRateRecorder selection_;
+		detail::SuccessRateRecorder simulation_;
+		std::array<detail::TimeHistogram, kStatisticStageCount> stages_;
+
+		std::atomic<int> cpu_;
+		std::atomic<int64_t> running_start_ns_; // zero if not running
+		detail::ThreadCounter running_ns_;
+
+		static int64_t GetNowNanoseconds() {
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+	};
+
+	// Aggregates the per-thread statistics on read
+	// Thread safety: Yes, after all threads statistics are created
+	template <bool enabled = mcts::StaticConfigs::enable_statistic>
+	class Statistic
+	{
+	public:
+		explicit Statistic(size_t threads = 1) : threads_() {
+			for (size_t i = 0; i < threads; ++i) {
+				threads_.emplace_back(new ThreadStatistic<enabled>());
+			}
+		}
+
+		ThreadStatistic<enabled> & GetThreadStatistic(size_t idx) { return *threads_[idx]; }
+
+		uint64_t GetSuccededIterates() const {
+			uint64_t ret = 0;
+			for (auto const& thread : threads_) ret += thread->GetSuccededIterates();
+			return ret;
 		}
 
 		std::string GetDebugMessage() const {
-			std::stringstream ss;
+			if constexpr (!enabled) {
+				return std::string();
+			}
+			else {
+				std::stringstream ss;
 
-			ss << "Apply selection action success rate: ";
-			PrintRate(ss, selection_);
-			ss << std::endl;
+				ss << "Apply selection action success rate: ";
+				PrintRate(ss, [](auto const& thread) -> auto const& { return thread.GetSelection(); });
+				ss << std::endl;
 
-			ss << "Apply simulation action success rate: ";
-			PrintRate(ss, simulation_);
-			ss << std::endl;
+				ss << "Apply simulation action success rate: ";
+				PrintRate(ss, [](auto const& thread) -> auto const& { return thread.GetSimulation(); });
+				ss << std::endl;
 
-			ss << "Iterate success rate: ";
-			PrintRate(ss, iterate_);
-			ss << std::endl;
+				ss << "Iterate success rate: ";
+				PrintRate(ss, [](auto const& thread) -> auto const& { return thread.GetIterate(); });
+				ss << std::endl;
+
+				PrintStage(ss, "State restore", kStatisticStageStateRestore);
+				PrintStage(ss, "Selection action", kStatisticStageSelection);
+				PrintStage(ss, "Simulation action", kStatisticStageSimulation);
+				PrintStage(ss, "Back propagation", kStatisticStageBackPropagation);
 
-			return ss.str();
+				PrintThreads(ss);
+
+				return ss.str();
+			}
 		}
 
 	private:
-		void PrintRate(std::stringstream & ss, detail::SuccessRateRecorder const& rate) const {
-			ss << rate.GetSuccessCount()
-				<< " / " << rate.GetTotalCount()
-				<< " (" << 100.0 * rate.GetSuccessRate() << "%)";
+		template <class Getter>
+		void PrintRate(std::stringstream & ss, Getter&& getter) const {
+			uint64_t success = 0;
+			uint64_t total = 0;
+			for (auto const& thread : threads_) {
+				success += getter(*thread).GetSuccessCount();
+				total += getter(*thread).GetTotalCount();
+			}
+
+			double rate = 0.0;
+			if (total > 0) rate = (double)success / total;
+
+			ss << success << " / " << total << " (" << 100.0 * rate << "%)";
+		}
+
+		void PrintStage(std::stringstream & ss, char const* name, StatisticStage stage) const {
+			constexpr int kBuckets = detail::TimeHistogram::kBuckets;
+			std::array<uint64_t, kBuckets> buckets{};
+			uint64_t count = 0;
+			uint64_t total_ns = 0;
+			for (auto const& thread : threads_) {
+				auto const& histogram = thread->GetStage(stage);
+				for (int i = 0; i < kBuckets; ++i) {
+					buckets[i] += histogram.GetCount(i);
+					count += histogram.GetCount(i);
+				}
+				total_ns += histogram.GetTotalNanoseconds();
+			}
+
+			ss << name << " time: " << count << " samples";
+			if (count > 0) {
+				// report the upper bound of the bucket
+				auto percentile = [&](double p) {
+					uint64_t target = (uint64_t)(p * count);
+					uint64_t accumulated = 0;
+					for (int i = 0; i < kBuckets; ++i) {
+						accumulated += buckets[i];
+						if (accumulated > target) return (uint64_t)1 << (i + 1);
+					}
+					return (uint64_t)1 << kBuckets;
+				};
+				ss << ", mean " << (total_ns / count) << " ns"
+					<< ", p50 < " << percentile(0.5) << " ns"
+					<< ", p99 < " << percentile(0.99) << " ns";
+			}
+			ss << std::endl;
+		}
+
+		void PrintThreads(std::stringstream & ss) const {
+			for (size_t i = 0; i < threads_.size(); ++i) {
+				auto const& thread = *threads_[i];
+				auto iterations = thread.GetSuccededIterates();
+				auto ns = thread.GetRunningNanoseconds();
+
+				ss << "Thread " << i;
+				if (thread.GetCpu() >= 0) ss << " (cpu " << thread.GetCpu() << ")";
+				ss << ": " << iterations << " iterations";
+				if (ns > 0) ss << ", " << (iterations * 1e9 / ns) << " per second";
+				ss << std::endl;
+			}
 		}
 
 	private:
-		detail::SuccessRateRecorder iterate_;
-		detail::SuccessRateRecorder selection_;
-		detail::SuccessRateRecorder simulation_;
+		std::vector<std::unique_ptr<ThreadStatistic<enabled>>> threads_;
 	};
-}
\ No newline at end of file
+}
@@ -1,11 +1,17 @@
 #pragma once
 
+#include <algorithm>
 #include <cmath>
 #include <random>
 
+#include "MCTS/Config.h"
+#include "MCTS/policy/RandomByRand.h"
 #include "MCTS/selection/TreeNode.h"
 #include "MCTS/selection/EdgeAddon.h"
 #include "engine/view/Board.h"
+#include "engine/ValidActionAnalyzer.h"
+#include "neural_net/PolicyNetwork.h"
+#include "neural_net/StateDataBridge.h"
 
 namespace mcts
 {
@@ -74,11 +80,38 @@ namespace mcts
 			public:
 				static constexpr double kExploreWeight = 0.2;
 
+				UCBPolicy(StaticConfigs::SelectionPhaseRandomActionPolicy & random) : random_(random) {}
+
+				// See StaticConfigs::kProgressiveWidening
+				static bool IsProgressivelyWidened(engine::ActionType action_type) {
+					if constexpr (!StaticConfigs::kProgressiveWidening) return false;
+
+					switch (action_type.GetType()) {
+					case engine::ActionType::kChooseMinionPutLocation:
+					case engine::ActionType::kChooseTarget:
+					case engine::ActionType::kChooseOne:
+						return true;
+					default:
+						return false;
+					}
+				}
+
+				// @return  The maximum number of children to expand for a node visited 'visits' times
+				static size_t GetWideningLimit(std::int64_t visits) {
+					if (visits <= 0) return 1;
+					double limit = StaticConfigs::kWideningBase * std::pow((double)visits, StaticConfigs::kWideningExponent);
+					return (size_t)limit + 1;
+				}
+
 				int SelectChoice(engine::ActionType action_type, ChoiceIterator choice_iterator)
 				{
 					constexpr size_t kMaxChoices = engine::IActionParameterGetter::kMaxChoices;
 					std::array<ChoiceIterator::Item, kMaxChoices> choices;
 					size_t choices_size = 0;
+					std::array<int, kMaxChoices> unexpanded;
+					size_t unexpanded_size = 0;
+
+					bool widening = IsProgressivelyWidened(action_type);
 
 					// Phase 1: get total chosen times, and record to 'choices'
 					std::int64_t total_chosen_times = 0;
@@ -89,12 +122,16 @@ namespace mcts
 						int choice = item.choice;
 						auto edge_addon = item.edge_addon;
 
-						if (!edge_addon) return choice; // force select
+						if (!edge_addon || edge_addon->GetChosenTimes() == 0) {
+							if (!widening) return choice; // force select
 
-						auto chosen_times = edge_addon->GetChosenTimes();
-						if (chosen_times == 0) {
-							return choice; // force select
+							assert(unexpanded_size < kMaxChoices);
+							unexpanded[unexpanded_size] = choice;
+							++unexpanded_size;
+							continue;
 						}
+
+						auto chosen_times = edge_addon->GetChosenTimes();
 						if (edge_addon->GetTotal() == 0) {
 							// a node is created (from another thread),
 							// but is not yet updated from that thread
@@ -109,6 +146,14 @@ namespace mcts
 						++choices_size;
 					}
 
+					if (unexpanded_size > 0) {
+						// Expand a new child only if the visits allow
+						// The unexpanded children are in a uniformly random order
+						if (choices_size < GetWideningLimit(total_chosen_times)) {
+							return unexpanded[random_.GetRandom((int)unexpanded_size)];
+						}
+					}
+
 					assert(total_chosen_times > 0);
 
 					// Phase 2: use UCB to make a choice
@@ -154,6 +199,112 @@ namespace mcts
 
 					return (int)choices[best_choice].choice;
 				}
+
+			private:
+				StaticConfigs::SelectionPhaseRandomActionPolicy & random_;
+			};
+
+			// PUCT, as in AlphaZero, for the main actions: the exploration of a choice is weighted by
+			// its prior from the policy network
+			//    score = Q + kPriorWeight * P * sqrt(N) / (1 + n)
+			// The unvisited choices are still visited once first, in the order of their priors.
+			// Falls back to UCBPolicy for the other actions, or if no trained policy network is loaded.
+			class PUCTPolicy {
+			public:
+				static constexpr double kPriorWeight = 1.0;
+
+				// @param policy  Loaded once per search thread; see NeuralNetworkStateValueFunction::GetPolicy()
+				PUCTPolicy(StaticConfigs::SelectionPhaseRandomActionPolicy & random, Config const& config,
+					neural_net::PolicyNetwork const& policy) :
+					ucb_(random), policy_(nullptr), bridge_()
+				{
+					if (config.IsPolicyPriorsEnabled() && !config.IsNeuralNetRandom()) {
+						policy_ = &policy;
+					}
+				}
+
+				PUCTPolicy(PUCTPolicy const&) = delete;
+				PUCTPolicy & operator=(PUCTPolicy const&) = delete;
+
+				bool HasPriors(engine::ActionType action_type) const {
+					return action_type == engine::ActionType::kMainAction && policy_ && policy_->IsTrained();
+				}
+
+				// @param priors  priors[choice] for each main-action choice
+				void ComputePriors(
+					engine::view::Board const& board,
+					engine::ValidActionAnalyzer const& action_analyzer,
+					float (&priors)[engine::kMainOpMax])
+				{
+					// The policy network only reads the hand of the current player, which is visible to it
+					bridge_.Reset(board.RevealHiddenInformationForSimulation());
+
+					std::uint8_t valid_mask = 0;
+					for (int choice = 0; choice < action_analyzer.GetMainActionsCount(); ++choice) {
+						valid_mask |= (std::uint8_t)(1 << action_analyzer.GetMainActions()[choice]);
+					}
+					auto policy = policy_->Predict(bridge_, valid_mask);
+
+					std::fill(std::begin(priors), std::end(priors), 0.0f);
+					for (int choice = 0; choice < action_analyzer.GetMainActionsCount(); ++choice) {
+						priors[choice] = policy.probabilities[action_analyzer.GetMainActions()[choice]];
+					}
+				}
+
+				// @param priors  See ComputePriors(); nullptr if not available
+				int SelectChoice(engine::ActionType action_type, ChoiceIterator choice_iterator, float const* priors)
+				{
+					if (!priors) return ucb_.SelectChoice(action_type, choice_iterator);
+					assert(action_type == engine::ActionType::kMainAction);
+
+					constexpr size_t kMaxChoices = engine::kMainOpMax;
+					std::array<ChoiceIterator::Item, kMaxChoices> choices;
+					size_t choices_size = 0;
+					int unexpanded = -1;
+
+					std::int64_t total_chosen_times = 0;
+					for (choice_iterator.Begin(); !choice_iterator.IsEnd(); choice_iterator.StepNext())
+					{
+						ChoiceIterator::Item item;
+						choice_iterator.Get(item);
+						assert(item.choice >= 0 && item.choice < (int)kMaxChoices);
+
+						if (!item.edge_addon || item.edge_addon->GetChosenTimes() == 0) {
+							if (unexpanded < 0 || priors[item.choice] > priors[unexpanded]) unexpanded = item.choice;
+							continue;
+						}
+						if (item.edge_addon->GetTotal() == 0) {
+							// not yet updated by another thread; see UCBPolicy
+							return item.choice;
+						}
+
+						total_chosen_times += item.edge_addon->GetChosenTimes();
+						choices[choices_size++] = item;
+					}
+					if (unexpanded >= 0) return unexpanded;
+
+					assert(choices_size > 0);
+					double explore_scale = kPriorWeight * std::sqrt((double)total_chosen_times);
+
+					size_t best_choice = 0;
+					double best_score = -std::numeric_limits<double>::infinity();
+					for (size_t idx = 0; idx < choices_size; ++idx) {
+						auto const& item = choices[idx];
+						double exploit_score = item.edge_addon->GetAverageCredit();
+						double explore_score = explore_scale * priors[item.choice] / (1.0 + item.edge_addon->GetChosenTimes());
+						double score = exploit_score + explore_score;
+						if (score > best_score) {
+							best_choice = idx;
+							best_score = score;
+						}
+					}
+					return choices[best_choice].choice;
+				}
+
+			private:
+				UCBPolicy ucb_;
+				neural_net::PolicyNetwork const* policy_; // nullptr if the priors are disabled
+				neural_net::StateDataBridge bridge_;
 			};
 		}
 	}
@@ -44,6 +44,10 @@ namespace mcts {
 				return engine::view::Board(game_, side.GetStateSide());
 			}
 
+			state::State const& GetCurrentState() const {
+				return game_.GetCurrentState();
+			}
+
 		private:
 			engine::Game game_;
 		};
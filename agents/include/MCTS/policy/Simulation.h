@@ -1,10 +1,13 @@
 #pragma once
 
+#include <memory>
 #include <random>
+#include <vector>
 #include "engine/view/Board.h"
 #include "MCTS/Types.h"
 #include "MCTS/policy/RandomByRand.h"
 #include "neural_net/NeuralNetwork.h"
+#include "neural_net/StateDataBridge.h"
 
 namespace mcts
 {
@@ -12,6 +15,8 @@ namespace mcts
 	{
 		namespace simulation
 		{
+			class NeuralNetworkStateValueFunction;
+
 			class ChoiceGetter
 			{
 			public:
@@ -37,7 +42,7 @@ namespace mcts
 			public:
 				static constexpr bool kEnableCutoff = false;
 
-				RandomPlayouts(std::mt19937 & rand, Config const& config) :
+				RandomPlayouts(std::mt19937 & rand, Config const& config, NeuralNetworkStateValueFunction & state_value_func) :
 					rand_(rand)
 				{
 				}
@@ -88,7 +93,7 @@ namespace mcts
 				static constexpr bool kEnableCutoff = true;
 				static constexpr bool kRandomlyPutMinions = true;
 
-				RandomCutoff(std::mt19937 & rand, Config const& config) :
+				RandomCutoff(std::mt19937 & rand, Config const& config, NeuralNetworkStateValueFunction & state_value_func) :
 					rand_(rand)
 				{
 				}
@@ -134,15 +139,25 @@ namespace mcts
 				std::mt19937 & rand_;
 			};
 
+			// Loads the neural net; so construct one per search thread, and share it among the searches
+			// (e.g., the in-flight iterations) in that thread.
+			// Thread safety: No
 			class NeuralNetworkStateValueFunction
 			{
 			public:
 				NeuralNetworkStateValueFunction(Config const& config, std::mt19937 & random)
-					: net_(), current_player_viewer_(), random_(random)
+					: net_(), current_player_viewer_(), random_(random), batch_viewers_(), batch_inputs_(), batch_scores_()
 				{
+					net_.SetPrecision(config.GetNeuralNetPrecision());
 					net_.Load(config.GetNeuralNetPath(), config.IsNeuralNetRandom());
 				}
 
+				NeuralNetworkStateValueFunction(NeuralNetworkStateValueFunction const&) = delete;
+				NeuralNetworkStateValueFunction & operator=(NeuralNetworkStateValueFunction const&) = delete;
+
+				// The policy network loaded with the neural net; see neural_net::NeuralNetwork::GetPolicy()
+				neural_net::PolicyNetwork const& GetPolicy() const { return net_.GetPolicy(); }
+
 				StateValue GetStateValue(engine::view::Board const& board) {
 					return GetStateValue(board.RevealHiddenInformationForSimulation());
 				}
@@ -151,209 +166,48 @@ namespace mcts
 					current_player_viewer_.Reset(state);
 
 					float score = (float)net_.Predict(&current_player_viewer_, random_);
-
-					if (score > 1.0f) score = 1.0f;
-					if (score < -1.0f) score = -1.0f;
-
-					StateValue ret;
-					ret.SetValue(score, state.GetCurrentPlayerId().GetSide());
-					return ret;
+					return MakeStateValue(score, state);
 				}
 
-			private:
-				// TODO: move to nerual_net namespace
-				class StateDataBridge : public neural_net::IInputGetter
-				{
-				public:
-					StateDataBridge() : state_(nullptr), attackable_indices_(),
-						playable_cards_(), hero_power_playable_()
-					{}
-
-					StateDataBridge(StateDataBridge const&) = delete;
-					StateDataBridge & operator=(StateDataBridge const&) = delete;
-
-					void Reset(state::State const& state) {
-						state_ = &state;
-
-						engine::FlowControl::ValidActionGetter valid_action(*state_);
-
-						attackable_indices_.clear();
-						valid_action.ForEachAttacker([this](int encoded_idx) {
-							attackable_indices_.push_back(encoded_idx);
-							return true;
-						});
-
-						playable_cards_.clear();
-						valid_action.ForEachPlayableCard([&](size_t idx) {
-							playable_cards_.push_back((int)idx);
-							return true;
-						});
-
-						hero_power_playable_ = valid_action.CanUseHeroPower();
-					}
-
-					double GetField(
-						neural_net::FieldSide field_side,
-						neural_net::FieldType field_type,
-						int arg1 = 0) const override final
-					{
-						if (field_side == neural_net::FieldSide::kCurrent) {
-							return GetSideField(field_type, arg1, state_->GetCurrentPlayer());
-						}
-						else if (field_side == neural_net::FieldSide::kOpponent) {
-							return GetSideField(field_type, arg1, state_->GetOppositePlayer());
-						}
-						throw std::runtime_error("invalid side");
-					}
-
-				private:
-					double GetSideField(neural_net::FieldType field_type, int arg1, state::board::Player const& player) const {
-						switch (field_type) {
-						case neural_net::FieldType::kResourceCurrent:
-						case neural_net::FieldType::kResourceTotal:
-						case neural_net::FieldType::kResourceOverload:
-						case neural_net::FieldType::kResourceOverloadNext:
-							return GetResourceField(field_type, arg1, player.GetResource());
-
-						case neural_net::FieldType::kHeroHP:
-						case neural_net::FieldType::kHeroArmor:
-							return GetHeroField(field_type, arg1, state_->GetCard(player.GetHeroRef()));
-
-						case neural_net::FieldType::kMinionCount:
-						case neural_net::FieldType::kMinionHP:
-						case neural_net::FieldType::kMinionMaxHP:
-						case neural_net::FieldType::kMinionAttack:
-						case neural_net::FieldType::kMinionAttackable:
-						case neural_net::FieldType::kMinionTaunt:
-						case neural_net::FieldType::kMinionShield:
-						case neural_net::FieldType::kMinionStealth:
-							return GetMinionsField(field_type, arg1, player.minions_);
-
-						case neural_net::FieldType::kHandCount:
-						case neural_net::FieldType::kHandPlayable:
-						case neural_net::FieldType::kHandCost:
-							return GetHandField(field_type, arg1, player.hand_);
-
-						case neural_net::FieldType::kHeroPowerPlayable:
-							return GetHeroPowerField(field_type, arg1);
-
-						default:
-							throw std::runtime_error("unknown field type");
-						}
-					}
-
-					double GetResourceField(neural_net::FieldType field_type, int arg1, state::board::PlayerResource const& resource) const {
-						switch (field_type) {
-						case neural_net::FieldType::kResourceCurrent:
-							return resource.GetCurrent();
-						case neural_net::FieldType::kResourceTotal:
-							return resource.GetTotal();
-						case neural_net::FieldType::kResourceOverload:
-							return resource.GetCurrentOverloaded();
-						case neural_net::FieldType::kResourceOverloadNext:
-							return resource.GetNextOverload();
-						default:
-							throw std::runtime_error("unknown field type");
-						}
-					}
-
-					double GetHeroField(neural_net::FieldType field_type, int arg1, state::Cards::Card const& hero) const {
-						switch (field_type) {
-						case neural_net::FieldType::kHeroHP:
-							return hero.GetHP();
-						case neural_net::FieldType::kHeroArmor:
-							return hero.GetArmor();
-						default:
-							throw std::runtime_error("unknown field type");
-						}
-					}
-
-					double GetMinionsField(neural_net::FieldType field_type, int minion_idx, state::board::Minions const& minions) const {
-						switch (field_type) {
-						case neural_net::FieldType::kMinionCount:
-							return (double)minions.Size();
-						case neural_net::FieldType::kMinionHP:
-						case neural_net::FieldType::kMinionMaxHP:
-						case neural_net::FieldType::kMinionAttack:
-						case neural_net::FieldType::kMinionAttackable:
-						case neural_net::FieldType::kMinionTaunt:
-						case neural_net::FieldType::kMinionShield:
-						case neural_net::FieldType::kMinionStealth:
-							return GetMinionField(field_type, minion_idx, state_->GetCard(minions.Get(minion_idx)));
-						default:
-							throw std::runtime_error("unknown field type");
-						}
+				// Estimate the states in one batch
+				// @param values  values[i] is the estimation of states[i]
+				// The buffers only grow, so no allocation once they fit the largest batch
+				void GetStateValues(std::vector<state::State const*> const& states, std::vector<StateValue> & values) {
+					while (batch_viewers_.size() < states.size()) {
+						batch_viewers_.push_back(std::make_unique<neural_net::StateDataBridge>());
 					}
-
-					double GetMinionField(neural_net::FieldType field_type, int minion_idx, state::Cards::Card const& minion) const {
-						switch (field_type) {
-						case neural_net::FieldType::kMinionHP:
-							return minion.GetHP();
-						case neural_net::FieldType::kMinionMaxHP:
-							return minion.GetMaxHP();
-						case neural_net::FieldType::kMinionAttack:
-							return minion.GetAttack();
-						case neural_net::FieldType::kMinionAttackable:
-							for (auto target_index : attackable_indices_) {
-								if (engine::FlowControl::ActionTargetIndex::ParseMinionIndex(target_index) == minion_idx) {
-									return true;
-								}
-							}
-							return false;
-						case neural_net::FieldType::kMinionTaunt:
-							return minion.HasTaunt();
-						case neural_net::FieldType::kMinionShield:
-							return minion.HasShield();
-						case neural_net::FieldType::kMinionStealth:
-							return minion.HasStealth();
-						default:
-							throw std::runtime_error("unknown field type");
-						}
+					batch_inputs_.resize(states.size());
+					batch_scores_.resize(states.size());
+					for (size_t i = 0; i < states.size(); ++i) {
+						batch_viewers_[i]->Reset(*states[i]);
+						batch_inputs_[i] = batch_viewers_[i].get();
 					}
 
-					double GetHandField(neural_net::FieldType field_type, int hand_idx, state::board::Hand const& hand) const {
-						switch (field_type) {
-						case neural_net::FieldType::kHandCount:
-							return (double)hand.Size();
-						case neural_net::FieldType::kHandPlayable:
-						case neural_net::FieldType::kHandCost:
-							return GetHandCardField(field_type, hand_idx, state_->GetCard(hand.Get(hand_idx)));
-						default:
-							throw std::runtime_error("unknown field type");
-						}
-					}
+					net_.Predict(batch_inputs_.data(), states.size(), batch_scores_.data(), random_);
 
-					double GetHandCardField(neural_net::FieldType field_type, int hand_idx, state::Cards::Card const& card) const {
-						switch (field_type) {
-						case neural_net::FieldType::kHandPlayable:
-							return (std::find(playable_cards_.begin(), playable_cards_.end(), hand_idx) != playable_cards_.end());
-						case neural_net::FieldType::kHandCost:
-							return card.GetCost();
-						default:
-							throw std::runtime_error("unknown field type");
-						}
+					values.clear();
+					for (size_t i = 0; i < states.size(); ++i) {
+						values.push_back(MakeStateValue((float)batch_scores_[i], *states[i]));
 					}
+				}
 
-					double GetHeroPowerField(neural_net::FieldType field_type, int arg1) const {
-						switch (field_type) {
-						case neural_net::FieldType::kHeroPowerPlayable:
-							return hero_power_playable_;
-						default:
-							throw std::runtime_error("unknown field type");
-						}
-					}
+			private:
+				static StateValue MakeStateValue(float score, state::State const& state) {
+					if (score > 1.0f) score = 1.0f;
+					if (score < -1.0f) score = -1.0f;
 
-				private:
-					state::State const* state_;
-					std::vector<int> attackable_indices_;
-					std::vector<int> playable_cards_;
-					bool hero_power_playable_;
-				};
+					StateValue ret;
+					ret.SetValue(score, state.GetCurrentPlayerId().GetSide());
+					return ret;
+				}
 
 			private:
 				neural_net::NeuralNetwork net_;
-				StateDataBridge current_player_viewer_;
+				neural_net::StateDataBridge current_player_viewer_;
 				std::mt19937 & random_;
+				std::vector<std::unique_ptr<neural_net::StateDataBridge>> batch_viewers_;
+				std::vector<neural_net::IInputGetter const*> batch_inputs_;
+				std::vector<double> batch_scores_;
 			};
 
 			class RandomPlayoutWithHeuristicEarlyCutoffPolicy
@@ -369,19 +223,24 @@ namespace mcts
 				static constexpr double kCutoffExpectedRuns = 10;
 				static constexpr double kCutoffProbability = 1.0 / kCutoffExpectedRuns;
 
-				bool GetCutoffResult(engine::view::Board const& board, StateValue & state_value) {
+				// Decide to cut off, without estimating the state value
+				bool ShouldCutoff() {
 					std::uniform_real_distribution<double> rand_gen(0.0, 1.0);
 					double v = rand_gen(rand_);
-					if (v >= kCutoffProbability) return false;
+					return v < kCutoffProbability;
+				}
+
+				bool GetCutoffResult(engine::view::Board const& board, StateValue & state_value) {
+					if (!ShouldCutoff()) return false;
 
 					state_value = state_value_func_.GetStateValue(board);
 					return true;
 				}
 
 			public:
-				RandomPlayoutWithHeuristicEarlyCutoffPolicy(state::PlayerSide side, std::mt19937 & rand, Config & config) :
+				RandomPlayoutWithHeuristicEarlyCutoffPolicy(std::mt19937 & rand, Config const& config, NeuralNetworkStateValueFunction & state_value_func) :
 					rand_(rand),
-					state_value_func_(config, rand_)
+					state_value_func_(state_value_func)
 				{
 				}
 
@@ -404,7 +263,7 @@ namespace mcts
 
 			private:
 				std::mt19937 & rand_;
-				NeuralNetworkStateValueFunction state_value_func_;
+				NeuralNetworkStateValueFunction & state_value_func_;
 			};
 
 			class HeuristicPlayoutWithHeuristicEarlyCutoffPolicy
@@ -421,20 +280,25 @@ namespace mcts
 				static constexpr double kCutoffProbability = 1.0 / kCutoffExpectedRuns;
 				static constexpr bool kRandomlyPutMinions = true;
 
-				bool GetCutoffResult(engine::view::Board const& board, StateValue & state_value) {
+				// Decide to cut off, without estimating the state value
+				bool ShouldCutoff() {
 					std::uniform_real_distribution<double> rand_gen(0.0, 1.0);
 					double v = rand_gen(rand_);
-					if (v >= kCutoffProbability) return false;
+					return v < kCutoffProbability;
+				}
+
+				bool GetCutoffResult(engine::view::Board const& board, StateValue & state_value) {
+					if (!ShouldCutoff()) return false;
 
 					state_value = state_value_func_.GetStateValue(board);
 					return true;
 				}
 
 			public:
-				HeuristicPlayoutWithHeuristicEarlyCutoffPolicy(std::mt19937 & rand, Config const& config) :
+				HeuristicPlayoutWithHeuristicEarlyCutoffPolicy(std::mt19937 & rand, Config const& config, NeuralNetworkStateValueFunction & state_value_func) :
 					rand_(rand),
 					decision_(), decision_idx_(0),
-					state_value_func_(config, rand_)
+					state_value_func_(state_value_func)
 				{
 				}
 
@@ -553,7 +417,7 @@ namespace mcts
 					// Since, some callbacks might depend on a random
 					// For example, choose one card from randomly-chosen three cards
 					UserChoicePolicy cb_user_choice(dfs, dfs_it, rand_());
-					cb_user_choice.Initialize(board.GetCurrentPlayerStateRefView().GetValidActionGetter());
+					cb_user_choice.Initialize(action_analyzer);
 
 					auto side = board.GetCurrentPlayer();
 
@@ -642,7 +506,7 @@ namespace mcts
 
 				std::vector<int> decision_;
 				size_t decision_idx_;
-				NeuralNetworkStateValueFunction state_value_func_;
+				NeuralNetworkStateValueFunction & state_value_func_;
 			};
 		}
 	}
@@ -30,5 +30,16 @@ namespace mcts
 				return item.get();
 			}
 		}
+
+		inline std::unique_ptr<TreeNode> BoardNodeMap::Erase(engine::view::ReducedBoardView const& board_view)
+		{
+			std::lock_guard<Utils::SharedSpinLock> lock(mutex_);
+			assert(map_);
+			auto it = map_->find(board_view);
+			assert(it != map_->end());
+			auto ret = std::move(it->second);
+			map_->erase(it);
+			return ret;
+		}
 	}
 }
\ No newline at end of file
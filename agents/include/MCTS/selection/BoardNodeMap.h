@@ -22,6 +22,9 @@ namespace mcts
 
 			TreeNode* GetOrCreateNode(engine::view::Board const& board, bool * new_node_created = nullptr);
 
+			// @return  The removed node
+			std::unique_ptr<TreeNode> Erase(engine::view::ReducedBoardView const& board_view);
+
 			template <typename Functor>
 			void ForEach(Functor&& functor) const {
 				std::shared_lock<Utils::SharedSpinLock> lock(mutex_);
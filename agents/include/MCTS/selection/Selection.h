@@ -12,9 +12,10 @@ namespace mcts
 		class Selection
 		{
 		public:
-			Selection(TreeNode & tree, std::mt19937 & rand, Config const& config) :
+			Selection(TreeNode & tree, TreeMemoryUsage & memory_usage, std::mt19937 & rand, Config const& config,
+				neural_net::PolicyNetwork const& policy) :
 				root_(tree), board_changed_(false), redirect_node_map_(nullptr),
-				path_(), random_(rand), policy_()
+				path_(memory_usage), random_(rand), policy_(random_, config, policy)
 			{}
 
 			Selection(Selection const&) = delete;
@@ -47,7 +48,11 @@ namespace mcts
 			}
 
 			// @return >= 0 for the chosen action
-			int ChooseAction(engine::ActionType action_type, engine::ActionChoices & choices)
+			int ChooseAction(
+				engine::view::Board const& board,
+				engine::ValidActionAnalyzer const& action_analyzer,
+				engine::ActionType action_type,
+				engine::ActionChoices & choices)
 			{
 				assert(!choices.Empty());
 
@@ -65,9 +70,17 @@ namespace mcts
 				TreeNode* current_node = path_.GetCurrentNode();
 				assert(current_node->addon_.consistency_checker.SetAndCheck(action_type, choices));
 
+				float const* priors = nullptr;
+				if (policy_.HasPriors(action_type)) {
+					priors = current_node->addon_.priors.Get([&](auto & node_priors) {
+						policy_.ComputePriors(board, action_analyzer, node_priors);
+					});
+				}
+
 				int next_choice = policy_.SelectChoice(
 					action_type,
-					mcts::policy::selection::ChoiceIterator(choices, current_node->children_));
+					mcts::policy::selection::ChoiceIterator(choices, current_node->children_),
+					priors);
 
 				assert(next_choice >= 0); // should report a valid action
 				path_.MakeChoiceForCurrentNode(next_choice);
@@ -103,10 +116,10 @@ namespace mcts
 				redirect_node_map_ = nullptr;
 			}
 
-			void FinishIteration(engine::view::Board const& board, StateValue state_value)
+			void FinishIteration(engine::view::Board const& board, StateValue state_value, int repeat_times = 1)
 			{
 				float credit = StaticConfigs::CreditPolicy::GetCredit(board, state_value);
-				path_.Update(credit);
+				path_.Update(credit, repeat_times);
 			}
 
 		private:
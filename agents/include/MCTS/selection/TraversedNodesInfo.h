@@ -1,13 +1,15 @@
 #pragma once
 
 #include "MCTS/selection/TraversedNodeInfo.h"
+#include "MCTS/selection/TreeMemoryUsage.h"
 #include "MCTS/selection/TreeUpdater.h"
 
 namespace mcts {
 	namespace selection {
 		class TraversedNodesInfo {
 		public:
-			TraversedNodesInfo() :
+			TraversedNodesInfo(TreeMemoryUsage & memory_usage) :
+				memory_usage_(memory_usage),
 				path_(),
 				new_node_created_(false),
 				current_node_(nullptr),
@@ -50,7 +52,11 @@ namespace mcts {
 				assert(node);
 
 				AddPathNode(current_node_, pending_choice_,edge_addon, node);
-				if (new_node_created) new_node_created_ = true;
+				if (new_node_created) {
+					new_node_created_ = true;
+					memory_usage_.AddEdge();
+					memory_usage_.AddNode();
+				}
 			}
 
 			void ConstructRedirectNode(BoardNodeMap * redirect_node_map, engine::view::Board const& board, engine::Result result) {
@@ -64,7 +70,10 @@ namespace mcts {
 				(void)node;
 				assert(node == nullptr); // should be a redirect node
 
-				if (new_node_created) new_node_created_ = true;
+				if (new_node_created) {
+					new_node_created_ = true;
+					memory_usage_.AddEdge();
+				}
 
 				if (result != engine::kResultNotDetermined) {
 					// Don't need to construct a node for leaf nodes.
@@ -73,8 +82,13 @@ namespace mcts {
 					AddPathNode(current_node_, pending_choice_, edge_addon, next_node);
 				}
 				else {
-					TreeNode * next_node = redirect_node_map->GetOrCreateNode(board, &new_node_created_);
+					bool new_board_node_created = false;
+					TreeNode * next_node = redirect_node_map->GetOrCreateNode(board, &new_board_node_created);
 					assert(next_node);
+					if (new_board_node_created) {
+						new_node_created_ = true;
+						memory_usage_.AddBoardNode();
+					}
 					assert(next_node->addon_.consistency_checker.CheckActionType(engine::ActionType::kMainAction));
 					AddPathNode(current_node_, pending_choice_, edge_addon, next_node);
 				}
@@ -83,11 +97,14 @@ namespace mcts {
 			void JumpToNode(engine::view::Board const& board) {
 				assert(current_node_);
 				assert(pending_choice_ < 0);
-				TreeNode * next_node = current_node_->addon_.board_node_map.GetOrCreateNode(board);
+				bool new_board_node_created = false;
+				TreeNode * next_node = current_node_->addon_.board_node_map.GetOrCreateNode(board, &new_board_node_created);
+				if (new_board_node_created) memory_usage_.AddBoardNode();
 				AddPathNode(current_node_, -1, nullptr, next_node);
 			}
 
-			void Update(float credit) {
+			// @param repeat_times  The number of simulations the (averaged) credit stands for
+			void Update(float credit, int repeat_times = 1) {
 				for (size_t i = 0; i < path_.size(); ++i) {
 					auto const& item = path_[i];
 
@@ -102,7 +119,7 @@ namespace mcts {
 				}
 
 				TreeUpdater updater;
-				updater.Update(path_, credit);
+				updater.Update(path_, credit, repeat_times);
 			}
 
 			auto const& GetPath() const { return path_; }
@@ -142,6 +159,7 @@ namespace mcts {
 			}
 
 		private:
+			TreeMemoryUsage & memory_usage_;
 			std::vector<TraversedNodeInfo> path_;
 			bool new_node_created_;
 			TreeNode * current_node_;
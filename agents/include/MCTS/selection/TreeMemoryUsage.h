@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "engine/view/ReducedBoardView.h"
+#include "MCTS/selection/TreeNode.h"
+
+namespace mcts
+{
+	namespace selection
+	{
+		// Count the tree nodes, so the tree size can be kept within a budget
+		// Thread safety: Yes
+		class TreeMemoryUsage
+		{
+		public:
+			struct Counts {
+				std::int64_t nodes; // all tree nodes, including the ones in board node maps
+				std::int64_t edges; // entries in child node maps
+				std::int64_t board_nodes; // entries in board node maps
+
+				Counts() : nodes(0), edges(0), board_nodes(0) {}
+
+				// A rough estimation. Heap allocations inside the board views are not counted.
+				std::int64_t GetEstimatedBytes() const {
+					constexpr std::int64_t kHashNodeOverhead = 2 * sizeof(void*);
+					constexpr std::int64_t kNodeBytes = sizeof(TreeNode);
+					constexpr std::int64_t kEdgeBytes = sizeof(int) + sizeof(EdgeAddon) + sizeof(std::unique_ptr<TreeNode>) + kHashNodeOverhead;
+					constexpr std::int64_t kBoardNodeBytes = sizeof(engine::view::ReducedBoardView) + sizeof(std::unique_ptr<TreeNode>) + kHashNodeOverhead;
+					return nodes * kNodeBytes + edges * kEdgeBytes + board_nodes * kBoardNodeBytes;
+				}
+
+				Counts & operator+=(Counts const& rhs) {
+					nodes += rhs.nodes;
+					edges += rhs.edges;
+					board_nodes += rhs.board_nodes;
+					return *this;
+				}
+				Counts & operator-=(Counts const& rhs) {
+					nodes -= rhs.nodes;
+					edges -= rhs.edges;
+					board_nodes -= rhs.board_nodes;
+					return *this;
+				}
+			};
+
+		public:
+			TreeMemoryUsage() : nodes_(0), edges_(0), board_nodes_(0) {}
+
+			void AddNode() { nodes_.fetch_add(1, std::memory_order_relaxed); }
+			void AddEdge() { edges_.fetch_add(1, std::memory_order_relaxed); }
+			void AddBoardNode() {
+				board_nodes_.fetch_add(1, std::memory_order_relaxed);
+				AddNode();
+			}
+
+			Counts Get() const {
+				Counts ret;
+				ret.nodes = nodes_.load(std::memory_order_relaxed);
+				ret.edges = edges_.load(std::memory_order_relaxed);
+				ret.board_nodes = board_nodes_.load(std::memory_order_relaxed);
+				return ret;
+			}
+
+			// Should only be called when no other thread is modifying the trees
+			void Set(Counts const& counts) {
+				nodes_.store(counts.nodes, std::memory_order_relaxed);
+				edges_.store(counts.edges, std::memory_order_relaxed);
+				board_nodes_.store(counts.board_nodes, std::memory_order_relaxed);
+			}
+
+		private:
+			std::atomic<std::int64_t> nodes_;
+			std::atomic<std::int64_t> edges_;
+			std::atomic<std::int64_t> board_nodes_;
+		};
+	}
+}
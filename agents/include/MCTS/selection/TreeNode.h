@@ -97,6 +97,17 @@ namespace mcts
 				});
 			}
 
+			// Replace the child node with 'node'; the edge is kept
+			// @return  The original child node
+			std::unique_ptr<TreeNode> ResetNode(int choice, std::unique_ptr<TreeNode> node) {
+				std::lock_guard<Utils::SharedSpinLock> write_lock(map_mutex_);
+				auto it = map_.find(choice);
+				assert(it != map_.end());
+				assert(it->second.node_);
+				it->second.node_.swap(node);
+				return node;
+			}
+
 		private:
 			mutable Utils::SharedSpinLock map_mutex_;
 
@@ -1,7 +1,11 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <mutex>
 #include "engine/ActionType.h"
+#include "engine/MainOp.h"
 #include "MCTS/selection/BoardNodeMap.h"
 #include "MCTS/selection/EdgeAddon.h"
 #include "engine/view/ReducedBoardView.h"
@@ -166,6 +170,17 @@ namespace mcts
 				items_.push_back(TreeNodeLeadingNodesItem{ node, edge_addon });
 			}
 
+			// Predicate parameters: TreeNode * node, EdgeAddon * edge_addon
+			template <class Predicate>
+			void EraseIf(Predicate&& pred) {
+				std::lock_guard<Utils::SharedSpinLock> lock(mutex_);
+				items_.erase(
+					std::remove_if(items_.begin(), items_.end(), [&](TreeNodeLeadingNodesItem const& item) {
+						return pred(item.node, item.edge_addon);
+					}),
+					items_.end());
+			}
+
 			template <class Functor>
 			void ForEachLeadingNode(Functor&& op) {
 				std::shared_lock<Utils::SharedSpinLock> lock(mutex_);
@@ -179,6 +194,42 @@ namespace mcts
 			std::vector<TreeNodeLeadingNodesItem> items_;
 		};
 
+		// The priors of the choices of a main-action node, from the policy network
+		// Computed once, by the first thread to select at the node; the other threads do without
+		// the priors until they are ready, instead of waiting.
+		class TreeNodePriors
+		{
+		public:
+			using Priors = float[engine::kMainOpMax]; // indexed by choice
+
+			TreeNodePriors() : state_(kNone), priors_() {}
+
+			// @param compute  Invoked as compute(Priors &) if no thread computed the priors yet
+			// @return  nullptr if the priors are being computed by another thread
+			template <class Functor>
+			float const* Get(Functor && compute) {
+				auto state = state_.load(std::memory_order_acquire);
+				if (state == kReady) return priors_;
+				if (state == kComputing) return nullptr;
+
+				std::uint8_t expected = kNone;
+				if (!state_.compare_exchange_strong(expected, kComputing, std::memory_order_relaxed)) {
+					return (expected == kReady) ? priors_ : nullptr;
+				}
+				compute(priors_);
+				state_.store(kReady, std::memory_order_release);
+				return priors_;
+			}
+
+		private:
+			static constexpr std::uint8_t kNone = 0;
+			static constexpr std::uint8_t kComputing = 1;
+			static constexpr std::uint8_t kReady = 2;
+
+			std::atomic<std::uint8_t> state_;
+			Priors priors_;
+		};
+
 		// Add abilities to tree node to use in SO-MCTS
 		// Note: this will live in *every* tree node, so careful about memory footprints
 		// Thread safety: No.
@@ -190,13 +241,15 @@ namespace mcts
 			TreeNodeAddon() :
 				consistency_checker(),
 				board_node_map(),
-				leading_nodes()
+				leading_nodes(),
+				priors()
 			{}
 
 			TreeNodeConsistencyCheckAddons consistency_checker; // TODO: debug only
 			BoardNodeMap board_node_map;
 			std::conditional_t<StaticConfigs::kRecordLeadingNodes,
 				TreeNodeLeadingNodes, Dummy> leading_nodes;
+			TreeNodePriors priors; // only for the main-action nodes
 		};
 	}
 }
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <assert.h>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+#include "MCTS/Config.h"
+#include "MCTS/selection/TreeNode.h"
+#include "MCTS/selection/TreeMemoryUsage.h"
+#include "MCTS/selection/BoardNodeMap-impl.h"
+
+namespace mcts
+{
+	namespace selection
+	{
+		// Evict the least-visited subtrees until the trees fit in a budget
+		//    * A child node is replaced by an empty node. The edge (and its statistics) is kept.
+		//    * A node in a board node map is erased. It is re-created when the board is reached again.
+		// The children of the root nodes are never evicted, since they are read by the agent.
+		// Thread safety: No. No other thread should access the trees during Prune().
+		class TreePruner
+		{
+		private:
+			static constexpr size_t kNoParent = std::numeric_limits<size_t>::max();
+
+			struct Candidate {
+				TreeNode * owner;
+				int choice; // for a child node; or -1 for a node in board node map
+				engine::view::ReducedBoardView const* board_view; // for a node in board node map
+				TreeNode * node;
+				std::int64_t visits;
+				size_t parent; // the nearest ancestor candidate
+				TreeMemoryUsage::Counts freed; // counts to free if this candidate is evicted
+				TreeMemoryUsage::Counts evicted_within; // counts already freed by evicted descendants
+				bool evicted;
+			};
+
+		public:
+			TreePruner() : candidates_(), freed_nodes_() {}
+
+			TreePruner(TreePruner const&) = delete;
+			TreePruner & operator=(TreePruner const&) = delete;
+
+			// Evict until both the node count and the estimated bytes are within the limits
+			// @return  The counts after pruning
+			template <class Roots>
+			TreeMemoryUsage::Counts Prune(Roots const& roots, std::int64_t max_nodes, std::int64_t max_bytes) {
+				candidates_.clear();
+				freed_nodes_.clear();
+
+				TreeMemoryUsage::Counts total;
+				for (TreeNode * root : roots) {
+					total += Collect(root, kNoParent, true);
+				}
+
+				TreeMemoryUsage::Counts remaining = SelectEvictions(total, max_nodes, max_bytes);
+				Evict();
+
+				for (TreeNode * root : roots) {
+					RemoveDanglingLeadingNodes(root);
+				}
+
+				candidates_.clear();
+				freed_nodes_.clear();
+				return remaining;
+			}
+
+		private:
+			// @return  The counts of all the nodes and edges owned by 'node', excluding 'node' itself
+			TreeMemoryUsage::Counts Collect(TreeNode * node, size_t parent, bool is_root) {
+				TreeMemoryUsage::Counts counts;
+
+				node->children_.ForEach([&](int choice, EdgeAddon * edge_addon, TreeNode * child) {
+					counts.edges += 1;
+					if (!child) return true; // redirect node
+
+					counts.nodes += 1;
+					if (is_root) {
+						counts += Collect(child, parent, false);
+						return true;
+					}
+
+					size_t idx = candidates_.size();
+					candidates_.push_back(Candidate{ node, choice, nullptr, child,
+						edge_addon->GetChosenTimes(), parent, {}, {}, false });
+					auto child_counts = Collect(child, idx, false);
+					candidates_[idx].freed = child_counts; // the child itself is replaced, not freed
+					counts += child_counts;
+					return true;
+				});
+
+				node->addon_.board_node_map.ForEach([&](engine::view::ReducedBoardView const& board_view, TreeNode * child) {
+					std::int64_t visits = 0;
+					child->children_.ForEach([&](int, EdgeAddon const* edge_addon, TreeNode *) {
+						visits += edge_addon->GetChosenTimes();
+						return true;
+					});
+
+					size_t idx = candidates_.size();
+					candidates_.push_back(Candidate{ node, -1, &board_view, child,
+						visits, parent, {}, {}, false });
+					auto child_counts = Collect(child, idx, false);
+					child_counts.nodes += 1;
+					child_counts.board_nodes += 1;
+					candidates_[idx].freed = child_counts;
+					counts += child_counts;
+					return true;
+				});
+
+				return counts;
+			}
+
+			// @return  The counts after the selected evictions
+			TreeMemoryUsage::Counts SelectEvictions(TreeMemoryUsage::Counts remaining, std::int64_t max_nodes, std::int64_t max_bytes) {
+				auto within_target = [&]() {
+					return remaining.nodes <= max_nodes && remaining.GetEstimatedBytes() <= max_bytes;
+				};
+
+				std::vector<size_t> order(candidates_.size());
+				for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+				std::stable_sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) {
+					return candidates_[lhs].visits < candidates_[rhs].visits;
+				});
+
+				for (size_t idx : order) {
+					if (within_target()) break;
+					if (HasEvictedAncestor(idx)) continue;
+
+					auto & candidate = candidates_[idx];
+					candidate.evicted = true;
+
+					auto freed = candidate.freed;
+					freed -= candidate.evicted_within;
+					remaining -= freed;
+					for (size_t p = candidate.parent; p != kNoParent; p = candidates_[p].parent) {
+						candidates_[p].evicted_within += freed;
+					}
+				}
+
+				return remaining;
+			}
+
+			bool HasEvictedAncestor(size_t idx) const {
+				for (size_t p = candidates_[idx].parent; p != kNoParent; p = candidates_[p].parent) {
+					if (candidates_[p].evicted) return true;
+				}
+				return false;
+			}
+
+			void Evict() {
+				for (size_t idx = 0; idx < candidates_.size(); ++idx) {
+					auto const& candidate = candidates_[idx];
+					if (!candidate.evicted) continue;
+					if (HasEvictedAncestor(idx)) continue; // freed with its ancestor
+
+					std::unique_ptr<TreeNode> removed;
+					if (candidate.board_view) {
+						removed = candidate.owner->addon_.board_node_map.Erase(*candidate.board_view);
+					}
+					else {
+						removed = candidate.owner->children_.ResetNode(candidate.choice, std::make_unique<TreeNode>());
+					}
+
+					AddFreedNodes(removed.get());
+				}
+			}
+
+			void AddFreedNodes(TreeNode * node) {
+				freed_nodes_.insert(node);
+				node->children_.ForEach([&](int, EdgeAddon const*, TreeNode * child) {
+					if (child) AddFreedNodes(child);
+					return true;
+				});
+				node->addon_.board_node_map.ForEach([&](engine::view::ReducedBoardView const&, TreeNode * child) {
+					AddFreedNodes(child);
+					return true;
+				});
+			}
+
+			// A kept node might be led from an evicted node
+			void RemoveDanglingLeadingNodes(TreeNode * node) {
+				if constexpr (StaticConfigs::kRecordLeadingNodes) {
+					node->addon_.leading_nodes.EraseIf([&](TreeNode * leading_node, EdgeAddon *) {
+						return freed_nodes_.find(leading_node) != freed_nodes_.end();
+					});
+				}
+
+				node->children_.ForEach([&](int, EdgeAddon const*, TreeNode * child) {
+					if (child) RemoveDanglingLeadingNodes(child);
+					return true;
+				});
+				node->addon_.board_node_map.ForEach([&](engine::view::ReducedBoardView const&, TreeNode * child) {
+					RemoveDanglingLeadingNodes(child);
+					return true;
+				});
+			}
+
+		private:
+			std::vector<Candidate> candidates_;
+			std::unordered_set<TreeNode const*> freed_nodes_;
+		};
+	}
+}
@@ -22,18 +22,18 @@ namespace mcts
 			TreeUpdater & operator=(TreeUpdater const&) = delete;
 
 			template <class RetType = void>
-			auto Update(std::vector<selection::TraversedNodeInfo> const& nodes, float credit)
+			auto Update(std::vector<selection::TraversedNodeInfo> const& nodes, float credit, int repeat_times = 1)
 				-> std::enable_if_t<std::is_same_v<StaticConfigs::UpdaterPolicy, StaticConfigs::updater_policy::LinearUpdate>, RetType>
 			{
 				for (auto const& item : nodes) {
 					auto * edge_addon = item.edge_addon_;
 					if (!edge_addon) continue;
-					edge_addon->AddCredit(credit);
+					edge_addon->AddCredit(credit, repeat_times);
 				}
 			}
 
 			template <class RetType = void>
-			auto Update(std::vector<selection::TraversedNodeInfo> const& nodes, float credit)
+			auto Update(std::vector<selection::TraversedNodeInfo> const& nodes, float credit, int repeat_times = 1)
 				-> std::enable_if_t<std::is_same_v<StaticConfigs::UpdaterPolicy, StaticConfigs::updater_policy::TreeUpdate>, RetType>
 			{
 				if (nodes.empty()) return;
@@ -50,7 +50,7 @@ namespace mcts
 
 				for (auto it = nodes.crbegin(); it != nodes.crend(); ++it) {
 					if (!it->edge_addon_) continue;
-					TreeLikeUpdateWinRate(it->node_, it->edge_addon_, credit);
+					TreeLikeUpdateWinRate(it->node_, it->edge_addon_, credit, repeat_times);
 					break;
 				}
 
@@ -59,7 +59,7 @@ namespace mcts
 
 		private:
 			template <class RetType = void>
-			auto TreeLikeUpdateWinRate(selection::TreeNode * start_node, EdgeAddon * start_edge, float credit)
+			auto TreeLikeUpdateWinRate(selection::TreeNode * start_node, EdgeAddon * start_edge, float credit, int repeat_times)
 				-> std::enable_if_t<std::is_same_v<StaticConfigs::UpdaterPolicy, StaticConfigs::updater_policy::TreeUpdate>, RetType>
 			{
 				assert(start_node);
@@ -77,7 +77,7 @@ namespace mcts
 							should_visits_.erase(edge_addon);
 							return true;
 						}());
-						edge_addon->AddCredit(credit);
+						edge_addon->AddCredit(credit, repeat_times);
 					}
 
 					// use BFS to reduce the lock time
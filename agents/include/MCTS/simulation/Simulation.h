@@ -10,8 +10,8 @@ namespace mcts
 		class Simulation
 		{
 		public:
-			Simulation(std::mt19937 & rand, Config const& config) :
-				random_(rand), select_(rand, config)
+			Simulation(std::mt19937 & rand, Config const& config, policy::simulation::NeuralNetworkStateValueFunction & state_value_func) :
+				random_(rand), select_(rand, config, state_value_func)
 			{}
 
 			bool CutoffCheck(engine::view::Board const& board, StateValue & state_value)
@@ -25,6 +25,19 @@ namespace mcts
 					return false;
 				}
 			}
+
+			// Like CutoffCheck(), but the state value is left to the caller; e.g., to estimate in a batch
+			bool CutoffCheckWithoutStateValue()
+			{
+				using Policy = std::decay_t<decltype(select_)>;
+
+				if constexpr (Policy::kEnableCutoff) {
+					return select_.ShouldCutoff();
+				}
+				else {
+					return false;
+				}
+			}
 			
 			void StartAction(engine::view::Board const& board, engine::ValidActionAnalyzer const& action_analyzer) {
 				select_.StartAction(board, action_analyzer);
@@ -1,7 +1,11 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <limits>
+#include <map>
+#include <stdexcept>
 #include <thread>
 
 #include "state/State.h"
@@ -11,6 +15,7 @@
 #include "judge/IAgent.h"
 #include "agents/MCTSRunner.h"
 #include "agents/MCTSConfig.h"
+#include "agents/OpeningBook.h"
 
 namespace agents
 {
@@ -29,8 +34,8 @@ namespace agents
 	public:
 		MCTSAgent(MCTSAgentConfig const& config, AgentCallback cb = AgentCallback()) :
 			config_(config),
-			root_node_(nullptr), node_(nullptr), controller_(),
-			cb_(cb)
+			root_node_(nullptr), root_side_(), node_(nullptr), controller_(),
+			cb_(cb), choice_visits_()
 		{}
 
 		MCTSAgent(MCTSAgent const&) = delete;
@@ -40,24 +45,102 @@ namespace agents
 			cb_.BeforeThink(game_state);
 
 			controller_.reset(new MCTSRunner(config_, random));
+
+			using Clock = std::chrono::steady_clock;
+			auto start = Clock::now();
+			auto soft_deadline = Clock::time_point::max();
+			auto hard_deadline = Clock::time_point::max();
+			if (config_.time_budget_ms > 0) {
+				soft_deadline = start + std::chrono::milliseconds(config_.time_budget_ms);
+				hard_deadline = soft_deadline;
+			}
+			if (config_.time_budget_hard_ms > 0) {
+				hard_deadline = start + std::chrono::milliseconds(config_.time_budget_hard_ms);
+				if (soft_deadline > hard_deadline) soft_deadline = hard_deadline;
+			}
+
+			uint64_t max_iterations = std::numeric_limits<uint64_t>::max();
+			if (config_.iterations_per_action > 0) max_iterations = (uint64_t)config_.iterations_per_action;
+
+			if (max_iterations == std::numeric_limits<uint64_t>::max() && hard_deadline == Clock::time_point::max()) {
+				throw std::runtime_error("No budget is set for thinking.");
+			}
+
+			bool use_opening_book = config_.opening_book && game_state.GetTurn() <= config_.opening_book_max_turn;
+			OpeningBook::Position opening_book_position;
+			OpeningBook::Entry seeded;
+			if (use_opening_book) {
+				opening_book_position = OpeningBook::GetPosition(game_state);
+				OpeningBook::Entry entry;
+				if (config_.opening_book->Find(opening_book_position, entry)) {
+					seeded = controller_->SeedRootNode(game_state.GetSide(), entry, config_.opening_book_prior_visits);
+					if (OpeningBook::GetConfidentChoice(entry,
+						config_.opening_book_confident_visits, config_.opening_book_confident_share) >= 0)
+					{
+						max_iterations = std::min(max_iterations,
+							(uint64_t)std::max(1, config_.opening_book_confident_iterations));
+					}
+				}
+			}
+
 			controller_->Run(game_state);
 
+			auto side = game_state.GetSide();
+			uint64_t iterations = 0;
 			while (true) {
-				uint64_t iterations = controller_->GetStatistic().GetSuccededIterates();
+				auto wake_time = std::min(hard_deadline, Clock::now() + std::chrono::milliseconds(config_.callback_interval_ms));
+				uint64_t wake_iterations = max_iterations;
+				if (config_.early_stop) {
+					wake_iterations = std::min(wake_iterations,
+						iterations + (uint64_t)std::max(1, config_.early_stop_check_iterations));
+				}
+
+				iterations = controller_->WaitForIterations(wake_iterations, wake_time);
 				cb_.Thinking(game_state, iterations);
-				if (iterations >= (uint64_t)config_.iterations_per_action) break;
 
-				std::this_thread::sleep_for(std::chrono::milliseconds(config_.callback_interval_ms));
+				if (iterations >= max_iterations) break;
+
+				auto now = Clock::now();
+				if (now >= hard_deadline) break;
+				if (now >= soft_deadline && IsBestChoiceStable(controller_->GetRootChoices(side))) break;
+
+				if (config_.early_stop) {
+					// After the soft deadline, we only continue until the hard deadline
+					auto deadline = (now < soft_deadline) ? soft_deadline : hard_deadline;
+					uint64_t remaining = max_iterations - iterations;
+					if (deadline != Clock::time_point::max()) {
+						double elapsed = std::chrono::duration<double>(now - start).count();
+						double rest = std::chrono::duration<double>(deadline - now).count();
+						double estimated = (elapsed > 0.0) ? (iterations / elapsed * rest) : (double)remaining;
+						if (estimated < (double)remaining) remaining = (uint64_t)estimated;
+					}
+					if (IsBestChoiceDecided(controller_->GetRootChoices(side), seeded, remaining)) break;
+				}
 			}
 			controller_->WaitUntilStopped();
 
+			if (use_opening_book && config_.opening_book_record) {
+				OpeningBook::Entry searched;
+				searched.turn = game_state.GetTurn();
+				for (auto const& kv : controller_->GetRootChoices(side)) {
+					auto & item = searched.choices[kv.first];
+					item.chosen_times = kv.second.chosen_times;
+					item.credit = kv.second.credit;
+					item.total = kv.second.total;
+					item.has_node = (kv.second.node != nullptr);
+				}
+				config_.opening_book->Add(opening_book_position, searched, seeded);
+			}
+
 			cb_.AfterThink(controller_->GetStatistic().GetSuccededIterates());
 
-			node_ = controller_->GetRootNode(game_state.GetSide());
+			node_ = controller_->GetRootNode(side);
 			root_node_ = node_;
+			root_side_ = side;
 		}
 
 		int GetAction(engine::ActionType::Types action_type, engine::ActionChoices action_choices, std::mt19937 & random) {
+			choice_visits_.clear();
 			if (action_type != engine::ActionType::kMainAction)
 			{
 				assert(action_choices.Size() > 0);
@@ -89,16 +172,30 @@ namespace agents
 			double temperature = config_.action_follow_temperature;
 			if (temperature < 0.1) temperature = 0.1;
 
-			node_->children_.ForEach([&](int choice, mcts::selection::EdgeAddon const* edge_addon, mcts::selection::TreeNode * child) {
-				if (!CanBeChosen(choice)) return true;
+			if (action_type == engine::ActionType::kMainAction) choice_visits_.assign(action_choices.Size(), 0);
+
+			auto add_item = [&](int choice, std::int64_t chosen_times, mcts::selection::TreeNode const* child) {
+				if (!CanBeChosen(choice)) return;
+				if ((size_t)choice < choice_visits_.size()) choice_visits_[choice] = chosen_times;
 
-				double choice_value = (double)edge_addon->GetChosenTimes();
+				double choice_value = (double)chosen_times;
 				choice_value = pow(choice_value, 1.0 / temperature);
 				total_value += choice_value;
 
 				items.push_back({ choice_value, choice, child });
-				return true;
-			});
+			};
+			if (node_ == root_node_ && controller_->GetTreeCount() > 1) {
+				// merge the root statistics of all the trees, and then follow the tree which chose the action most
+				for (auto const& kv : controller_->GetRootChoices(root_side_)) {
+					add_item(kv.first, kv.second.chosen_times, kv.second.node);
+				}
+			}
+			else {
+				node_->children_.ForEach([&](int choice, mcts::selection::EdgeAddon const* edge_addon, mcts::selection::TreeNode * child) {
+					add_item(choice, edge_addon->GetChosenTimes(), child);
+					return true;
+				});
+			}
 
 			// normalize
 			double accumulated = 0.0;
@@ -121,11 +218,66 @@ namespace agents
 			return random() % action_choices.Size();
 		}
 
+		// The visits of the search to each choice of the last main action, indexed by choice
+		// Empty if the last action is not a main action.
+		std::vector<std::int64_t> const& GetLastChoiceVisits() const { return choice_visits_; }
+
+	private:
+		// The most-visited choice is also the one with the best average credit
+		static bool IsBestChoiceStable(std::map<int, MCTSRunner::RootChoice> const& choices) {
+			int most_visited_choice = -1;
+			int best_credit_choice = -1;
+			int64_t most_visited = -1;
+			float best_credit = 0.0f;
+			for (auto const& kv : choices) {
+				if (kv.second.total <= 0) continue;
+
+				auto visited = kv.second.chosen_times;
+				if (visited > most_visited) {
+					most_visited = visited;
+					most_visited_choice = kv.first;
+				}
+
+				float credit = (float)kv.second.credit / kv.second.total;
+				if (best_credit_choice < 0 || credit > best_credit) {
+					best_credit = credit;
+					best_credit_choice = kv.first;
+				}
+			}
+			return most_visited_choice == best_credit_choice;
+		}
+
+		// The lead of the most-visited choice is larger than the remaining iterations,
+		// so no other choice can overtake it
+		// Only the searched visits count; the visits seeded from the opening book are not a lead.
+		static bool IsBestChoiceDecided(std::map<int, MCTSRunner::RootChoice> const& choices,
+			OpeningBook::Entry const& seeded, uint64_t remaining_iterations)
+		{
+			int64_t first = 0;
+			int64_t second = 0;
+			for (auto const& kv : choices) {
+				auto visited = kv.second.chosen_times;
+				auto seeded_it = seeded.choices.find(kv.first);
+				if (seeded_it != seeded.choices.end()) visited -= seeded_it->second.chosen_times;
+				if (visited > first) {
+					second = first;
+					first = visited;
+				}
+				else if (visited > second) {
+					second = visited;
+				}
+			}
+			if (choices.size() < 2) return false; // other choices might not be expanded yet
+			return (uint64_t)(first - second) > remaining_iterations;
+		}
+
 	private:
 		MCTSAgentConfig config_;
 		mcts::selection::TreeNode const* root_node_;
+		state::PlayerIdentifier root_side_;
 		mcts::selection::TreeNode const* node_;
 		std::unique_ptr<MCTSRunner> controller_;
 		AgentCallback cb_;
+		std::vector<std::int64_t> choice_visits_;
 	};
 }
@@ -1,17 +1,75 @@
 #pragma once
 
+#include <cstdint>
+
+#include "agents/ThreadPlacement.h"
 #include "MCTS/Config.h"
 
 namespace agents
 {
+	class OpeningBook;
+
 	class MCTSAgentConfig {
 	public:
 		int threads;
 		int tree_samples;
 
+		// Number of private trees. Threads are assigned to the trees round-robin,
+		// and each tree samples its own subset of the 'tree_samples' determinizations.
+		//    1: tree parallelization; all threads share one tree
+		//    'threads': root parallelization; no tree is shared between threads
+		// The root statistics are merged when making a decision.
+		int root_parallel_trees;
+
+		// Pin the search threads to CPUs
+		ThreadPlacementPolicy thread_placement;
+		// The search threads take the CPUs from this position in the placement order
+		// E.g., leave the first CPUs to the other threads in the process.
+		int thread_placement_first_cpu;
+		// One tree per NUMA node used by the threads; overrides 'root_parallel_trees'
+		// Threads only share the tree with the threads on the same node, so no cross-node traffic on the hot path.
+		bool tree_per_numa_node;
+		// Merge the root statistics of the per-node trees into each other, every this many iterations
+		// So each tree selects with the visits of all the nodes, not only its own.
+		//    Zero or negative value to merge only when making a decision
+		int tree_merge_iterations;
+
+		// Iterations interleaved in each search thread
+		// An iteration suspends when its leaf needs the value network, and the leaves of all the
+		// suspended iterations are estimated in one batch; so the batch fills without more threads.
+		//    1: run each iteration to completion
+		int inflight_iterations;
+
+		// Stop thinking when any of the budgets is reached
+		//    Zero or negative value to disable a budget
 		int iterations_per_action;
+		int time_budget_ms; // soft target: stop here, unless the best action is still unstable
+		int time_budget_hard_ms; // hard deadline: never think longer than this
+
+		// Stop thinking once the most-visited root action cannot be overtaken in the remaining budget
+		// Off by default: the root visit counts are cut short, so they are no use as policy targets
+		bool early_stop;
+		int early_stop_check_iterations;
+
 		int callback_interval_ms;
 
+		// Evict the least-visited subtrees when the trees grow beyond any of the budgets
+		//    Zero or negative value to disable a budget
+		std::int64_t tree_max_nodes;
+		std::int64_t tree_max_bytes; // estimated
+		double tree_prune_ratio; // evict until the trees are within this ratio of the budgets
+
+		// Opening book: root statistics of the previous searches. Not owned; nullptr to disable.
+		OpeningBook * opening_book;
+		int opening_book_max_turn; // only consult/record the book up to this turn
+		bool opening_book_record; // add the root statistics to the book after thinking
+		int opening_book_prior_visits; // seed at most this many visits to each root action
+		// If the most-chosen action in the book has enough visits and share of visits,
+		// think only 'opening_book_confident_iterations' iterations to resolve its sub-choices
+		int opening_book_confident_visits;
+		double opening_book_confident_share;
+		int opening_book_confident_iterations;
+
 		mcts::Config mcts;
 
 	public: // action policy
@@ -21,10 +79,34 @@ namespace agents
 		MCTSAgentConfig() :
 			threads(1),
 			tree_samples(10),
+			root_parallel_trees(1),
+			thread_placement(ThreadPlacementPolicy::kNone),
+			thread_placement_first_cpu(0),
+			tree_per_numa_node(false),
+			tree_merge_iterations(1000),
+			inflight_iterations(1),
 			iterations_per_action(10000),
+			time_budget_ms(0),
+			time_budget_hard_ms(0),
+			early_stop(false),
+			early_stop_check_iterations(100),
 			callback_interval_ms(1000),
+			tree_max_nodes(0),
+			tree_max_bytes(0),
+			tree_prune_ratio(0.75),
+			opening_book(nullptr),
+			opening_book_max_turn(6),
+			opening_book_record(false),
+			opening_book_prior_visits(1000),
+			opening_book_confident_visits(5000),
+			opening_book_confident_share(0.8),
+			opening_book_confident_iterations(200),
 			mcts(),
 			action_follow_temperature(0.0)
 		{}
+
+		// Copies share the opening book; it is not owned
+		MCTSAgentConfig(MCTSAgentConfig const&) = default;
+		MCTSAgentConfig & operator=(MCTSAgentConfig const&) = default;
 	};
 }
\ No newline at end of file
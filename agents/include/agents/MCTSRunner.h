@@ -1,33 +1,89 @@
 #pragma once
 
+#include <chrono>
+#include <algorithm>
+#include <condition_variable>
 #include <functional>
+#include <limits>
+#include <map>
+#include <mutex>
 #include <random>
 
 #include "engine/view/BoardView.h"
 #include "engine/view/board_view/StateRestorer.h"
 #include "state/State.h"
+#include "agents/ThreadPlacement.h"
 #include "MCTS/MOMCTS.h"
+#include "MCTS/selection/TreeMemoryUsage.h"
+#include "MCTS/selection/TreePruner.h"
 #include "judge/Judger.h"
 #include "agents/MCTSConfig.h"
+#include "agents/OpeningBook.h"
 
 namespace agents
 {
 	class MCTSRunner
 	{
+	public:
+		// Statistics of a root action, merged from all the trees
+		struct RootChoice {
+			std::int64_t chosen_times;
+			std::int64_t credit;
+			std::int64_t total;
+
+			// The child node in the tree which chose this action most
+			mcts::selection::TreeNode const* node;
+			std::int64_t node_chosen_times;
+
+			RootChoice() : chosen_times(0), credit(0), total(0), node(nullptr), node_chosen_times(-1) {}
+		};
+
 	public:
 		MCTSRunner(MCTSAgentConfig const& config, std::mt19937 & rand) :
 			config_(config),
+			placement_(config.thread_placement, (size_t)std::max(0, config.thread_placement_first_cpu)),
 			threads_(),
 			rand_(rand),
-			first_tree_(),
-			second_tree_(),
-			statistic_(),
+			trees_(),
+			thread_trees_(),
+			tree_memory_(),
+			statistic_((size_t)config.threads),
 			stop_flag_(false),
-			tree_sample_randoms_()
+			tree_sample_randoms_(),
+			progress_mutex_(),
+			progress_cv_(),
+			wake_at_iterations_(kNeverWake),
+			prune_mutex_(),
+			prune_cv_(),
+			prune_requested_(false),
+			running_threads_(0),
+			paused_threads_(0),
+			prune_generation_(0),
+			pruned_nodes_(0),
+			merge_mutex_()
 		{
 			for (int i = 0; i < config_.tree_samples; ++i) {
 				tree_sample_randoms_.push_back(rand());
 			}
+
+			int trees = std::max(1, std::min(config_.root_parallel_trees, config_.threads));
+			if (config_.tree_per_numa_node) {
+				auto nodes = placement_.GetNodes((size_t)config_.threads);
+				trees = (int)nodes.size();
+				for (int i = 0; i < config_.threads; ++i) {
+					auto it = std::lower_bound(nodes.begin(), nodes.end(), placement_.GetNode((size_t)i));
+					thread_trees_.push_back((size_t)(it - nodes.begin()));
+				}
+			}
+			else {
+				for (int i = 0; i < config_.threads; ++i) {
+					thread_trees_.push_back((size_t)(i % trees));
+				}
+			}
+
+			for (int i = 0; i < trees; ++i) {
+				trees_.emplace_back(new Trees());
+			}
 		}
 
 		~MCTSRunner()
@@ -39,9 +95,19 @@ namespace agents
 		{
 			assert(threads_.empty());
 			stop_flag_ = false;
+			running_threads_ = config_.threads;
+			int merge_interval = GetMergeInterval();
 			for (int i = 0; i < config_.threads; ++i) {
 				int thread_seed = rand_();
-				threads_.emplace_back([this, thread_seed, game_state]() {
+				auto & statistic = statistic_.GetThreadStatistic((size_t)i);
+				size_t tree_idx = thread_trees_[i];
+				int cpu = placement_.GetCpu((size_t)i);
+				threads_.emplace_back([this, thread_seed, game_state, &statistic, tree_idx, cpu, merge_interval]() {
+					// The tree nodes are allocated by the search threads, so they are placed
+					// on the NUMA node of the threads using the tree (first-touch policy)
+					bool pinned = ThreadPlacement::PinCurrentThread(cpu);
+					statistic.StartRunning(pinned ? cpu : -1);
+
 					engine::view::BoardView board_view;
 					engine::view::board_view::UnknownCardsInfo first_unknown;
 					engine::view::board_view::UnknownCardsInfo second_unknown;
@@ -59,33 +125,125 @@ namespace agents
 					};
 
 
-					std::mt19937 selection_rand;
 					std::mt19937 simulation_rand(thread_seed);
-					mcts::MOMCTS mcts(first_tree_, second_tree_, statistic_, selection_rand, simulation_rand, config_.mcts);
+					auto & trees = *trees_[tree_idx];
 
-					size_t tree_sample_random_idx = 0;
+					// Each tree samples its own subset of the determinizations
+					size_t tree_sample_random_idx = tree_idx % tree_sample_randoms_.size();
 					auto get_next_selection_seed = [tree_sample_random_idx, this]() mutable {
 						int v = tree_sample_randoms_[tree_sample_random_idx];
-						++tree_sample_random_idx;
-						if (tree_sample_random_idx >= tree_sample_randoms_.size()) {
-							tree_sample_random_idx = 0;
-						}
+						tree_sample_random_idx = (tree_sample_random_idx + trees_.size()) % tree_sample_randoms_.size();
 						return v;
 					};
 
-					while (!stop_flag_.load()) {
-						int sample_seed = get_next_selection_seed();
-						selection_rand.seed(sample_seed);
-						mcts.Iterate([&]() {
-							return state_getter(selection_rand);
-						});
+					int merge_countdown = merge_interval;
+					auto iterate_succeeded = [&]() {
+						statistic.IterateSucceeded();
+						NotifyProgress(statistic.GetSuccededIterates());
+						if (merge_interval > 0 && --merge_countdown <= 0) {
+							merge_countdown = merge_interval;
+							MergeRootStatistics();
+						}
+					};
 
-						statistic_.IterateSucceeded();
+					auto check_prune = [&]() {
+						if (IsOverMemoryBudget()) prune_requested_ = true;
+						if (prune_requested_.load()) WaitForPrune();
+					};
+
+					// Loads the neural net; shared by all the iterations in this thread
+					mcts::policy::simulation::NeuralNetworkStateValueFunction state_value_func(config_.mcts, simulation_rand);
+
+					if (config_.inflight_iterations <= 1) {
+						std::mt19937 selection_rand;
+						mcts::MOMCTS mcts(trees.first, trees.second, tree_memory_, statistic,
+							selection_rand, simulation_rand, state_value_func, config_.mcts);
+
+						while (!stop_flag_.load()) {
+							int sample_seed = get_next_selection_seed();
+							selection_rand.seed(sample_seed);
+							mcts.Iterate([&]() {
+								return state_getter(selection_rand);
+							});
+
+							iterate_succeeded();
+							check_prune();
+						}
 					}
+					else {
+						// Interleave several iterations in this thread. Each of them suspends when its leaf
+						// needs a state value, and the suspended leaves are estimated in one batch.
+						std::vector<std::unique_ptr<InflightIteration>> inflights;
+						for (int j = 0; j < config_.inflight_iterations; ++j) {
+							inflights.emplace_back(new InflightIteration(
+								trees, tree_memory_, statistic, simulation_rand, state_value_func, config_.mcts));
+						}
+
+						std::vector<InflightIteration *> suspended;
+						std::vector<state::State const*> pending_states;
+						std::vector<mcts::StateValue> state_values;
+						while (!stop_flag_.load()) {
+							suspended.clear();
+							pending_states.clear();
+							for (auto & inflight : inflights) {
+								inflight->selection_rand.seed(get_next_selection_seed());
+								bool finished = inflight->mcts.StartIterate([&]() {
+									return state_getter(inflight->selection_rand);
+								});
+
+								if (finished) {
+									iterate_succeeded();
+								}
+								else {
+									suspended.push_back(inflight.get());
+									pending_states.push_back(&inflight->mcts.GetPendingState());
+								}
+							}
+
+							if (!suspended.empty()) {
+								{
+									auto timer = statistic.Measure(mcts::kStatisticStageSimulation);
+									state_value_func.GetStateValues(pending_states, state_values);
+								}
+								for (size_t j = 0; j < suspended.size(); ++j) {
+									suspended[j]->mcts.ResumeIterate(state_values[j]);
+									iterate_succeeded();
+								}
+							}
+
+							// no iteration is in flight here, so the trees can be pruned
+							check_prune();
+						}
+					}
+
+					statistic.StopRunning();
+					ExitWorker();
 				});
 			}
 		}
 
+		// Seed the root actions of every tree by the statistics from an opening book
+		// Thread safety: No. Should be called before Run().
+		// @return  The seeded statistics, summed over the trees
+		OpeningBook::Entry SeedRootNode(state::PlayerIdentifier side, OpeningBook::Entry const& entry, std::int64_t max_visits) {
+			assert(threads_.empty());
+			OpeningBook::Entry ret;
+			ret.turn = entry.turn;
+			for (auto & trees : trees_) {
+				auto & root = (side == state::kPlayerFirst) ? trees->first : trees->second;
+				auto seeded = OpeningBook::Seed(entry, root, tree_memory_, max_visits);
+				GetRootMerge(*trees, side).seeded = seeded.choices;
+				for (auto const& kv : seeded.choices) {
+					auto & item = ret.choices[kv.first];
+					item.chosen_times += kv.second.chosen_times;
+					item.credit += kv.second.credit;
+					item.total += kv.second.total;
+					item.has_node = kv.second.has_node;
+				}
+			}
+			return ret;
+		}
+
 		int NotifyStop() {
 			stop_flag_ = true;
 			return 0;
@@ -106,20 +264,297 @@ namespace agents
 
 		auto const& GetStatistic() const { return statistic_; }
 
+		// Block until the number of succeeded iterations reaches 'iterations',
+		// or until the time point 'until' is reached.
+		// The search threads wake up the caller, so there is no need to poll.
+		// @return  The number of succeeded iterations
+		uint64_t WaitForIterations(uint64_t iterations, std::chrono::steady_clock::time_point until) {
+			auto reached = [&]() {
+				return statistic_.GetSuccededIterates() >= iterations;
+			};
+
+			std::unique_lock<std::mutex> lock(progress_mutex_);
+			wake_at_iterations_ = iterations;
+			progress_cv_.wait_until(lock, until, reached);
+			wake_at_iterations_ = kNeverWake;
+
+			return statistic_.GetSuccededIterates();
+		}
+
+		auto const& GetTreeMemoryUsage() const { return tree_memory_; }
+
+		size_t GetTreeCount() const { return trees_.size(); }
+
+		// The root node of the first tree
 		auto GetRootNode(state::PlayerIdentifier side) const {
-			if (side == state::kPlayerFirst) return &first_tree_;
+			return GetRootNode(side, 0);
+		}
+
+		mcts::selection::TreeNode const* GetRootNode(state::PlayerIdentifier side, size_t tree_idx) const {
+			if (side == state::kPlayerFirst) return &trees_[tree_idx]->first;
 			assert(side == state::kPlayerSecond);
-			return &second_tree_;
+			return &trees_[tree_idx]->second;
+		}
+
+		// Merge the statistics of the root actions from all the trees
+		// Only the atomic edge statistics are read, so the search threads are not blocked
+		// The statistics imported from the other trees (see MergeRootStatistics()) are not counted again.
+		std::map<int, RootChoice> GetRootChoices(state::PlayerIdentifier side) const {
+			std::lock_guard<std::mutex> lock(merge_mutex_);
+			std::map<int, RootChoice> ret;
+			for (size_t i = 0; i < trees_.size(); ++i) {
+				auto const& imported = GetRootMerge(*trees_[i], side).imported;
+				GetRootNode(side, i)->children_.ForEach([&](int choice,
+					mcts::selection::EdgeAddon const* edge_addon, mcts::selection::TreeNode const* child)
+				{
+					auto & item = ret[choice];
+					auto chosen_times = edge_addon->GetChosenTimes();
+					auto credit = edge_addon->GetCredit();
+					auto total = edge_addon->GetTotal();
+					auto it = imported.find(choice);
+					if (it != imported.end()) {
+						chosen_times -= it->second.chosen_times;
+						credit -= it->second.credit;
+						total -= it->second.total;
+					}
+					item.chosen_times += chosen_times;
+					item.credit += credit;
+					item.total += total;
+					if (chosen_times > item.node_chosen_times) {
+						item.node = child;
+						item.node_chosen_times = chosen_times;
+					}
+					return true;
+				});
+			}
+			return ret;
+		}
+
+	private:
+		// Iterations of each search thread between the merges of the root statistics
+		// @return  Zero if the trees are not merged
+		int GetMergeInterval() const {
+			if (!config_.tree_per_numa_node || trees_.size() <= 1) return 0;
+			if (config_.tree_merge_iterations <= 0) return 0;
+			return std::max(1, config_.tree_merge_iterations / config_.threads);
+		}
+
+		// Import into each tree the root statistics searched by the other trees since the last merge
+		// Only the atomic edge statistics are touched, so the search threads are not paused.
+		// The statistics seeded from the opening book, or imported earlier, are not passed on.
+		void MergeRootStatistics() {
+			std::unique_lock<std::mutex> lock(merge_mutex_, std::try_to_lock);
+			if (!lock.owns_lock()) return; // another thread is merging
+			MergeRootStatistics(state::kPlayerFirst);
+			MergeRootStatistics(state::kPlayerSecond);
+		}
+
+		void MergeRootStatistics(state::PlayerIdentifier side) {
+			using Statistic = OpeningBook::ChoiceStatistic;
+			constexpr int kGranularity = mcts::StaticConfigs::kCreditGranularity;
+
+			auto subtract = [](Statistic & item, std::map<int, Statistic> const& from, int choice) {
+				auto it = from.find(choice);
+				if (it == from.end()) return;
+				item.chosen_times -= it->second.chosen_times;
+				item.credit -= it->second.credit;
+				item.total -= it->second.total;
+			};
+
+			// searched[i]: the statistics searched by tree 'i' itself
+			std::vector<std::map<int, Statistic>> searched(trees_.size());
+			std::map<int, Statistic> searched_sum;
+			for (size_t i = 0; i < trees_.size(); ++i) {
+				auto const& merge = GetRootMerge(*trees_[i], side);
+				GetRootNode(side, i)->children_.ForEach([&](int choice,
+					mcts::selection::EdgeAddon const* edge_addon, mcts::selection::TreeNode const*)
+				{
+					auto & item = searched[i][choice];
+					item.chosen_times = edge_addon->GetChosenTimes();
+					item.credit = edge_addon->GetCredit();
+					item.total = edge_addon->GetTotal();
+					subtract(item, merge.seeded, choice);
+					subtract(item, merge.imported, choice);
+
+					auto & sum = searched_sum[choice];
+					sum.chosen_times += item.chosen_times;
+					sum.credit += item.credit;
+					sum.total += item.total;
+					return true;
+				});
+			}
+
+			for (size_t i = 0; i < trees_.size(); ++i) {
+				auto & imported = GetRootMerge(*trees_[i], side).imported;
+				auto & root = (side == state::kPlayerFirst) ? trees_[i]->first : trees_[i]->second;
+				root.children_.ForEach([&](int choice,
+					mcts::selection::EdgeAddon * edge_addon, mcts::selection::TreeNode *)
+				{
+					// not imported yet = searched by the other trees - imported
+					Statistic delta = searched_sum[choice];
+					subtract(delta, searched[i], choice);
+					subtract(delta, imported, choice);
+
+					int repeat_times = (int)(delta.total / kGranularity);
+					if (delta.chosen_times <= 0 || repeat_times <= 0) return true;
+					float score = std::max(-1.0f, std::min(1.0f, (float)delta.credit / delta.total));
+
+					edge_addon->AddChosenTimes((int)delta.chosen_times);
+					edge_addon->AddCredit(score, repeat_times);
+
+					auto & item = imported[choice];
+					item.chosen_times += delta.chosen_times;
+					item.credit += (std::int64_t)(int)(score * kGranularity) * repeat_times; // as added by AddCredit()
+					item.total += (std::int64_t)repeat_times * kGranularity;
+					return true;
+				});
+			}
+		}
+
+		// @param thread_iterations  The succeeded iterations of the calling thread
+		void NotifyProgress(uint64_t thread_iterations) {
+			// Check the cheap conditions first; summing the counters of all the threads reads the
+			// cache lines the other threads are writing.
+			// The sum is at most (the count of the fastest thread) * threads, so the fastest thread
+			// still sums once the target is reached.
+			auto wake_at_iterations = wake_at_iterations_.load(std::memory_order_relaxed);
+			if (wake_at_iterations == kNeverWake) return;
+			if (thread_iterations * (uint64_t)config_.threads < wake_at_iterations) return;
+			if (statistic_.GetSuccededIterates() < wake_at_iterations) return;
+
+			// acquire the lock, so the waiter is either not checked the condition yet, or is already waiting
+			std::lock_guard<std::mutex> lock(progress_mutex_);
+			progress_cv_.notify_all();
+		}
+
+		bool IsOverMemoryBudget() const {
+			if (config_.tree_max_nodes <= 0 && config_.tree_max_bytes <= 0) return false;
+
+			auto counts = tree_memory_.Get();
+
+			// If the last pruning could not reach the target, wait for the trees to grow a bit
+			// before another try; otherwise every iteration triggers a pruning
+			auto pruned_nodes = pruned_nodes_.load(std::memory_order_relaxed);
+			if (counts.nodes <= pruned_nodes + pruned_nodes / 16) return false;
+
+			if (config_.tree_max_nodes > 0 && counts.nodes > config_.tree_max_nodes) return true;
+			if (config_.tree_max_bytes > 0 && counts.GetEstimatedBytes() > config_.tree_max_bytes) return true;
+			return false;
+		}
+
+		// Search threads pause between iterations, so no thread holds a pointer to the tree nodes.
+		// The last thread arriving prunes the trees, and then wakes up the others.
+		void WaitForPrune() {
+			std::unique_lock<std::mutex> lock(prune_mutex_);
+			if (!prune_requested_.load()) return;
+
+			++paused_threads_;
+			if (paused_threads_ == running_threads_) {
+				LockedPrune();
+				return;
+			}
+
+			auto generation = prune_generation_;
+			prune_cv_.wait(lock, [&]() { return prune_generation_ != generation; });
+		}
+
+		void ExitWorker() {
+			std::lock_guard<std::mutex> lock(prune_mutex_);
+			--running_threads_;
+			if (prune_requested_.load() && paused_threads_ == running_threads_) {
+				LockedPrune();
+			}
+		}
+
+		void LockedPrune() {
+			if (running_threads_ > 0) {
+				auto limit = [&](std::int64_t budget) {
+					if (budget <= 0) return std::numeric_limits<std::int64_t>::max();
+					return (std::int64_t)(budget * config_.tree_prune_ratio);
+				};
+
+				std::vector<mcts::selection::TreeNode *> roots;
+				for (auto & trees : trees_) {
+					roots.push_back(&trees->first);
+					roots.push_back(&trees->second);
+				}
+				auto counts = mcts::selection::TreePruner().Prune(
+					roots, limit(config_.tree_max_nodes), limit(config_.tree_max_bytes));
+				tree_memory_.Set(counts);
+				pruned_nodes_ = counts.nodes;
+			}
+
+			prune_requested_ = false;
+			paused_threads_ = 0;
+			++prune_generation_;
+			prune_cv_.notify_all();
 		}
 
 	private:
+		static constexpr uint64_t kNeverWake = std::numeric_limits<uint64_t>::max();
+
+		// The root statistics of a tree, which are not searched by the tree itself
+		struct RootMerge {
+			RootMerge() : seeded(), imported() {}
+
+			std::map<int, OpeningBook::ChoiceStatistic> seeded; // from the opening book
+			std::map<int, OpeningBook::ChoiceStatistic> imported; // from the other trees
+		};
+
+		struct Trees {
+			Trees() : first(), second(), first_merge(), second_merge() {}
+
+			mcts::selection::TreeNode first;
+			mcts::selection::TreeNode second;
+
+			// Guarded by merge_mutex_
+			RootMerge first_merge;
+			RootMerge second_merge;
+		};
+
+		static RootMerge & GetRootMerge(Trees & trees, state::PlayerIdentifier side) {
+			return (side == state::kPlayerFirst) ? trees.first_merge : trees.second_merge;
+		}
+		static RootMerge const& GetRootMerge(Trees const& trees, state::PlayerIdentifier side) {
+			return (side == state::kPlayerFirst) ? trees.first_merge : trees.second_merge;
+		}
+
+		// An iteration which can be suspended in a search thread
+		struct InflightIteration {
+			InflightIteration(Trees & trees, mcts::selection::TreeMemoryUsage & memory_usage,
+				mcts::ThreadStatistic<> & statistic, std::mt19937 & simulation_rand,
+				mcts::policy::simulation::NeuralNetworkStateValueFunction & state_value_func, mcts::Config const& config) :
+				selection_rand(),
+				mcts(trees.first, trees.second, memory_usage, statistic, selection_rand, simulation_rand, state_value_func, config)
+			{}
+
+			std::mt19937 selection_rand;
+			mcts::MOMCTS mcts;
+		};
+
 		MCTSAgentConfig config_;
+		ThreadPlacement placement_;
 		std::vector<std::thread> threads_;
 		std::mt19937 & rand_;
-		mcts::selection::TreeNode first_tree_;
-		mcts::selection::TreeNode second_tree_;
+		std::vector<std::unique_ptr<Trees>> trees_; // one tree for tree parallelization; or one tree per thread group
+		std::vector<size_t> thread_trees_; // the tree index used by each thread
+		mcts::selection::TreeMemoryUsage tree_memory_;
 		mcts::Statistic<> statistic_;
 		std::atomic_bool stop_flag_;
 		std::vector<int> tree_sample_randoms_;
+
+		std::mutex progress_mutex_;
+		std::condition_variable progress_cv_;
+		std::atomic<uint64_t> wake_at_iterations_;
+
+		std::mutex prune_mutex_;
+		std::condition_variable prune_cv_;
+		std::atomic_bool prune_requested_;
+		int running_threads_;
+		int paused_threads_;
+		uint64_t prune_generation_;
+		std::atomic<std::int64_t> pruned_nodes_; // node count right after the last pruning
+
+		mutable std::mutex merge_mutex_;
 	};
 }
@@ -0,0 +1,376 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "json/json.h"
+#include "engine/view/BoardRefView.h"
+#include "engine/view/ReducedBoardView.h"
+#include "MCTS/Config.h"
+#include "MCTS/selection/TreeNode.h"
+#include "MCTS/selection/TreeMemoryUsage.h"
+
+namespace agents
+{
+	// Statistics of the root actions of the MCTS trees, merged across games
+	// Keyed by the reduced board view, so identical game states share an entry.
+	// The view is encoded as a list of integers, which is stored along with the entry; so a hash
+	// collision is detected, and the file can be shared across builds (as long as the card ids agree).
+	// Thread safety: Yes
+	class OpeningBook
+	{
+	public:
+		using Position = std::vector<int>;
+
+		struct ChoiceStatistic {
+			std::int64_t chosen_times;
+			std::int64_t credit; // same unit as mcts::selection::EdgeAddon
+			std::int64_t total; // same unit as mcts::selection::EdgeAddon
+			bool has_node; // false for a redirect node
+
+			ChoiceStatistic() : chosen_times(0), credit(0), total(0), has_node(false) {}
+		};
+
+		struct Entry {
+			int turn;
+			std::map<int, ChoiceStatistic> choices;
+
+			Entry() : turn(0), choices() {}
+		};
+
+		static Position GetPosition(engine::view::BoardRefView const& board) {
+			return Encode(engine::view::ReducedBoardView(board));
+		}
+
+		// FNV-1a over the little-endian bytes of the encoding; independent of the build
+		static std::uint64_t GetKey(Position const& position) {
+			std::uint64_t result = 14695981039346656037ULL;
+			for (int v : position) {
+				std::uint32_t bits = (std::uint32_t)v;
+				for (int i = 0; i < 4; ++i) {
+					result ^= (bits >> (i * 8)) & 0xFF;
+					result *= 1099511628211ULL;
+				}
+			}
+			return result;
+		}
+
+	public:
+		OpeningBook() : mutex_(), entries_() {}
+
+		OpeningBook(OpeningBook const&) = delete;
+		OpeningBook & operator=(OpeningBook const&) = delete;
+
+		// Add the statistics of the root actions
+		// @param excluded  Statistics to subtract; e.g., the seeded ones
+		void Add(Position const& position, Entry const& searched, Entry const& excluded) {
+			Entry entry;
+			entry.turn = searched.turn;
+			for (auto const& kv : searched.choices) {
+				ChoiceStatistic item = kv.second;
+
+				auto it = excluded.choices.find(kv.first);
+				if (it != excluded.choices.end()) {
+					item.chosen_times -= it->second.chosen_times;
+					item.credit -= it->second.credit;
+					item.total -= it->second.total;
+				}
+				if (item.chosen_times <= 0 || item.total <= 0) continue;
+
+				entry.choices[kv.first] = item;
+			}
+			if (entry.choices.empty()) return;
+
+			std::lock_guard<std::mutex> lock(mutex_);
+			LockedMerge(position, entry);
+		}
+
+		bool Find(Position const& position, Entry & entry) const {
+			std::lock_guard<std::mutex> lock(mutex_);
+			auto it = entries_.find(position);
+			if (it == entries_.end()) return false;
+			entry = it->second;
+			return true;
+		}
+
+		size_t Size() const {
+			std::lock_guard<std::mutex> lock(mutex_);
+			return entries_.size();
+		}
+
+		// The most-chosen action, if it has at least 'min_visits' visits and 'min_share' of all visits
+		// @return  The choice; or -1 if not confident
+		static int GetConfidentChoice(Entry const& entry, std::int64_t min_visits, double min_share) {
+			int best_choice = -1;
+			std::int64_t best = 0;
+			std::int64_t sum = 0;
+			for (auto const& kv : entry.choices) {
+				sum += kv.second.chosen_times;
+				if (kv.second.chosen_times > best) {
+					best = kv.second.chosen_times;
+					best_choice = kv.first;
+				}
+			}
+			if (best_choice < 0) return -1;
+			if (best < min_visits) return -1;
+			if ((double)best < min_share * sum) return -1;
+			return best_choice;
+		}
+
+		// Seed the root edges with the book statistics, keeping the average credits
+		// Thread safety: No. No other thread should access the tree.
+		// @param max_visits  The visits seeded to an edge are capped by this
+		// @return  The seeded statistics
+		static Entry Seed(Entry const& entry, mcts::selection::TreeNode & root,
+			mcts::selection::TreeMemoryUsage & memory_usage, std::int64_t max_visits)
+		{
+			constexpr int kGranularity = mcts::StaticConfigs::kCreditGranularity;
+
+			Entry seeded;
+			seeded.turn = entry.turn;
+			for (auto const& kv : entry.choices) {
+				auto const& item = kv.second;
+				if (root.children_.HasChild(kv.first)) continue;
+
+				std::int64_t simulations = item.total / kGranularity;
+				if (item.chosen_times <= 0 || simulations <= 0) continue;
+
+				double ratio = std::min(1.0, (double)max_visits / item.chosen_times);
+				int chosen_times = (int)(item.chosen_times * ratio);
+				int repeat_times = (int)(simulations * ratio);
+				if (chosen_times <= 0 || repeat_times <= 0) continue;
+
+				std::tuple<bool, mcts::selection::EdgeAddon*, mcts::selection::TreeNode*> result;
+				if (item.has_node) {
+					result = root.children_.GetOrCreateNewNode(kv.first, std::make_unique<mcts::selection::TreeNode>());
+					memory_usage.AddNode();
+				}
+				else {
+					result = root.children_.GetOrCreatRedirectNode(kv.first);
+				}
+				memory_usage.AddEdge();
+
+				auto * edge_addon = std::get<1>(result);
+				float score = (float)item.credit / item.total;
+				edge_addon->AddChosenTimes(chosen_times);
+				edge_addon->AddCredit(score, repeat_times);
+
+				ChoiceStatistic seeded_item;
+				seeded_item.chosen_times = chosen_times;
+				seeded_item.credit = edge_addon->GetCredit();
+				seeded_item.total = edge_addon->GetTotal();
+				seeded_item.has_node = item.has_node;
+				seeded.choices[kv.first] = seeded_item;
+			}
+			return seeded;
+		}
+
+	public: // persistence
+		// Merge the entries in the file to this book
+		bool Load(std::string const& filename) {
+			std::ifstream fs(filename);
+			if (!fs) return false;
+
+			Json::Reader reader;
+			Json::Value json;
+			if (!reader.parse(fs, json, false)) return false;
+			if (json["version"].asInt() != kVersion) return false;
+
+			std::lock_guard<std::mutex> lock(mutex_);
+			Json::Value const& entries = json["entries"];
+			for (auto it = entries.begin(); it != entries.end(); ++it) {
+				Position position;
+				for (auto const& v : (*it)["position"]) position.push_back(v.asInt());
+				if (std::to_string(GetKey(position)) != (*it)["key"].asString()) continue; // corrupted
+
+				Entry entry;
+				entry.turn = (*it)["turn"].asInt();
+
+				Json::Value const& choices = (*it)["choices"];
+				for (auto choice_it = choices.begin(); choice_it != choices.end(); ++choice_it) {
+					ChoiceStatistic item;
+					item.chosen_times = (*choice_it)["chosen_times"].asInt64();
+					item.credit = (*choice_it)["credit"].asInt64();
+					item.total = (*choice_it)["total"].asInt64();
+					item.has_node = (*choice_it)["has_node"].asBool();
+					entry.choices[std::stoi(choice_it.name())] = item;
+				}
+				LockedMerge(position, entry);
+			}
+			return true;
+		}
+
+		bool Save(std::string const& filename) const {
+			Json::Value json;
+			json["version"] = kVersion;
+
+			Json::Value entries(Json::arrayValue);
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				for (auto const& kv : entries_) {
+					Json::Value entry;
+					entry["key"] = std::to_string(GetKey(kv.first));
+					entry["position"] = Json::Value(Json::arrayValue);
+					for (int v : kv.first) entry["position"].append(v);
+					entry["turn"] = kv.second.turn;
+					for (auto const& choice_kv : kv.second.choices) {
+						Json::Value item;
+						item["chosen_times"] = (Json::Int64)choice_kv.second.chosen_times;
+						item["credit"] = (Json::Int64)choice_kv.second.credit;
+						item["total"] = (Json::Int64)choice_kv.second.total;
+						item["has_node"] = choice_kv.second.has_node;
+						entry["choices"][std::to_string(choice_kv.first)] = item;
+					}
+					entries.append(entry);
+				}
+			}
+			json["entries"] = entries;
+
+			std::ofstream fs(filename, std::ofstream::trunc);
+			if (!fs) return false;
+			Json::StyledStreamWriter json_writer;
+			json_writer.write(fs, json);
+			return (bool)fs;
+		}
+
+	private:
+		struct PositionHasher {
+			std::size_t operator()(Position const& position) const {
+				return (std::size_t)GetKey(position);
+			}
+		};
+
+		static void Append(Position & position, bool v) { position.push_back(v ? 1 : 0); }
+		static void Append(Position & position, int v) { position.push_back(v); }
+		static void Append(Position & position, Cards::CardId v) { position.push_back((int)v); }
+
+		static void Append(Position & position, engine::view::reduced_board_view::Hero const& v) {
+			static_assert(engine::view::reduced_board_view::Hero::change_id == 2);
+			Append(position, v.attack);
+			Append(position, v.hp);
+			Append(position, v.max_hp);
+			Append(position, v.armor);
+			Append(position, v.stealth);
+			Append(position, v.immune);
+		}
+
+		static void Append(Position & position, engine::view::reduced_board_view::SelfHero const& v) {
+			static_assert(engine::view::reduced_board_view::SelfHero::change_id == 1);
+			Append(position, static_cast<engine::view::reduced_board_view::Hero const&>(v));
+			Append(position, v.attackable);
+		}
+
+		static void Append(Position & position, engine::view::reduced_board_view::Crystal const& v) {
+			static_assert(engine::view::reduced_board_view::Crystal::change_id == 1);
+			Append(position, v.current);
+			Append(position, v.total);
+			Append(position, v.overload);
+			Append(position, v.overload_next_turn);
+		}
+
+		static void Append(Position & position, engine::view::reduced_board_view::HeroPower const& v) {
+			static_assert(engine::view::reduced_board_view::HeroPower::change_id == 1);
+			Append(position, v.card_id);
+			Append(position, v.usable);
+		}
+
+		static void Append(Position & position, engine::view::reduced_board_view::Weapon const& v) {
+			static_assert(engine::view::reduced_board_view::Weapon::change_id == 1);
+			Append(position, v.equipped);
+			if (!v.equipped) return;
+			Append(position, v.card_id);
+			Append(position, v.attack);
+			Append(position, v.durability);
+		}
+
+		static void Append(Position & position, engine::view::reduced_board_view::Minion const& v) {
+			static_assert(engine::view::reduced_board_view::Minion::change_id == 3);
+			Append(position, v.card_id);
+			Append(position, v.attack);
+			Append(position, v.hp);
+			Append(position, v.max_hp);
+			Append(position, v.silenced);
+			Append(position, v.taunt);
+			Append(position, v.cant_attack_hero);
+			Append(position, v.stealth);
+			Append(position, v.immune);
+		}
+
+		static void Append(Position & position, engine::view::reduced_board_view::SelfMinion const& v) {
+			static_assert(engine::view::reduced_board_view::SelfMinion::change_id == 1);
+			Append(position, static_cast<engine::view::reduced_board_view::Minion const&>(v));
+			Append(position, v.attackable);
+		}
+
+		static void Append(Position & position, engine::view::reduced_board_view::SelfHandCard const& v) {
+			static_assert(engine::view::reduced_board_view::SelfHandCard::change_id == 1);
+			Append(position, v.card_id);
+			Append(position, v.cost);
+			Append(position, v.attack);
+			Append(position, v.hp);
+		}
+
+		static void Append(Position & position, engine::view::reduced_board_view::OpponentHandCard const&) {
+			static_assert(engine::view::reduced_board_view::OpponentHandCard::change_id == 1);
+		}
+
+		// Length-prefixed, so the encoding of the next field cannot be taken as an item
+		template <class Item>
+		static void Append(Position & position, std::vector<Item> const& items) {
+			Append(position, (int)items.size());
+			for (auto const& item : items) Append(position, item);
+		}
+
+		static Position Encode(engine::view::ReducedBoardView const& view) {
+			static_assert(engine::view::reduced_board_view::SelfDeck::change_id == 1);
+			static_assert(engine::view::reduced_board_view::OpponentDeck::change_id == 1);
+
+			Position position;
+			Append(position, view.GetTurn());
+			Append(position, (int)view.GetSide());
+
+			Append(position, view.GetSelfHero());
+			Append(position, view.GetSelfCrystal());
+			Append(position, view.GetHeroPower());
+			Append(position, view.GetSelfMinions());
+			Append(position, view.GetSelfWeapon());
+			Append(position, view.GetSelfHand());
+			Append(position, view.GetSelfDeck().count);
+
+			Append(position, view.GetOpponentHero());
+			Append(position, view.GetOpponentCrystal());
+			Append(position, view.GetOpponentHeroPower());
+			Append(position, view.GetOpponentMinions());
+			Append(position, view.GetOpponentWeapon());
+			Append(position, view.GetOpponentHand());
+			Append(position, (int)view.GetOpponentDeck().count);
+			return position;
+		}
+
+		void LockedMerge(Position const& position, Entry const& entry) {
+			auto & target = entries_[position];
+			target.turn = entry.turn;
+			for (auto const& kv : entry.choices) {
+				auto & item = target.choices[kv.first];
+				item.chosen_times += kv.second.chosen_times;
+				item.credit += kv.second.credit;
+				item.total += kv.second.total;
+				item.has_node = kv.second.has_node;
+			}
+		}
+
+	private:
+		static constexpr int kVersion = 2;
+
+		mutable std::mutex mutex_;
+		std::unordered_map<Position, Entry, PositionHasher> entries_;
+	};
+}
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace agents
+{
+	enum class ThreadPlacementPolicy {
+		kNone, // leave it to the OS scheduler
+		kCompact, // fill the NUMA nodes one by one; use the physical cores first, then the SMT siblings
+		kScatter // spread the workers round-robin over the NUMA nodes
+	};
+
+	// Decide which CPU each worker thread runs on
+	// The topology is read from sysfs on Linux, once per process. On other platforms, all the CPUs are
+	// assumed to be physical cores on one NUMA node, and the threads are not pinned.
+	// Thread safety: Yes, after constructed
+	class ThreadPlacement
+	{
+	public:
+		struct Cpu {
+			int id;
+			int node; // NUMA node
+			int core; // physical core; SMT siblings share the same value
+			int smt; // index among the SMT siblings
+		};
+
+	public:
+		// @param first_cpu  The workers take the CPUs from this position in the placement order,
+		//                   so several thread pools in one process do not pin to the same CPUs
+		explicit ThreadPlacement(ThreadPlacementPolicy policy = ThreadPlacementPolicy::kNone, size_t first_cpu = 0) :
+			policy_(policy), first_cpu_(first_cpu), order_()
+		{
+			if (policy_ != ThreadPlacementPolicy::kNone) {
+				order_ = MakeOrder(GetCpus(), policy_);
+			}
+		}
+
+		ThreadPlacementPolicy GetPolicy() const { return policy_; }
+
+		// @return  The CPU for the 'idx'-th worker; or -1 if the worker should not be pinned
+		//          Wraps around if there are more workers than CPUs.
+		int GetCpu(size_t idx) const {
+			if (order_.empty()) return -1;
+			return order_[(first_cpu_ + idx) % order_.size()].id;
+		}
+
+		// @return  The NUMA node of the 'idx'-th worker; or 0 if the worker is not pinned
+		int GetNode(size_t idx) const {
+			if (order_.empty()) return 0;
+			return order_[(first_cpu_ + idx) % order_.size()].node;
+		}
+
+		// @return  The distinct NUMA nodes used by the first 'workers' workers, in ascending order
+		std::vector<int> GetNodes(size_t workers) const {
+			std::set<int> nodes;
+			for (size_t i = 0; i < workers; ++i) nodes.insert(GetNode(i));
+			return std::vector<int>(nodes.begin(), nodes.end());
+		}
+
+		// Pin the calling thread to 'cpu'
+		// @return  false if 'cpu' is negative, or pinning is not supported
+		static bool PinCurrentThread(int cpu) {
+			if (cpu < 0) return false;
+#ifdef __linux__
+			if (cpu >= CPU_SETSIZE) return false;
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			CPU_SET(cpu, &set);
+			return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+			return false;
+#endif
+		}
+
+		// The CPUs this process is allowed to run on, when first called
+		static std::vector<Cpu> const& GetCpus() {
+			static std::vector<Cpu> const cpus = DetectCpus();
+			return cpus;
+		}
+
+	private:
+		static std::vector<Cpu> DetectCpus() {
+			std::vector<Cpu> cpus;
+#ifdef __linux__
+			cpu_set_t allowed;
+			CPU_ZERO(&allowed);
+			bool has_allowed = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+
+			std::map<int, int> cpu_nodes;
+			for (int node : ParseList(ReadLine("/sys/devices/system/node/possible"))) {
+				auto path = "/sys/devices/system/node/node" + std::to_string(node) + "/cpulist";
+				for (int cpu : ParseList(ReadLine(path))) cpu_nodes[cpu] = node;
+			}
+
+			std::map<std::tuple<int, int, int>, int> siblings; // (node, package, core_id) -> count
+			for (int id : ParseList(ReadLine("/sys/devices/system/cpu/online"))) {
+				if (id >= CPU_SETSIZE) continue;
+				if (has_allowed && !CPU_ISSET(id, &allowed)) continue;
+
+				auto path = "/sys/devices/system/cpu/cpu" + std::to_string(id) + "/topology/";
+				int package = ReadInt(path + "physical_package_id", 0);
+				int core_id = ReadInt(path + "core_id", id);
+
+				Cpu cpu;
+				cpu.id = id;
+				cpu.node = cpu_nodes.count(id) ? cpu_nodes[id] : 0;
+				cpu.smt = siblings[std::make_tuple(cpu.node, package, core_id)]++;
+				cpu.core = (package << 16) + core_id;
+				cpus.push_back(cpu);
+			}
+#endif
+			if (cpus.empty()) {
+				int count = std::max(1, (int)std::thread::hardware_concurrency());
+				for (int id = 0; id < count; ++id) cpus.push_back(Cpu{ id, 0, id, 0 });
+			}
+			return cpus;
+		}
+
+		static std::vector<Cpu> MakeOrder(std::vector<Cpu> cpus, ThreadPlacementPolicy policy) {
+			std::stable_sort(cpus.begin(), cpus.end(), [](Cpu const& lhs, Cpu const& rhs) {
+				return std::tie(lhs.node, lhs.smt, lhs.core, lhs.id) < std::tie(rhs.node, rhs.smt, rhs.core, rhs.id);
+			});
+			if (policy == ThreadPlacementPolicy::kCompact) return cpus;
+
+			// kScatter: take one CPU from each node in turn
+			std::map<int, std::vector<Cpu>> nodes;
+			for (auto const& cpu : cpus) nodes[cpu.node].push_back(cpu);
+
+			std::vector<Cpu> ret;
+			for (size_t i = 0; ret.size() < cpus.size(); ++i) {
+				for (auto const& kv : nodes) {
+					if (i < kv.second.size()) ret.push_back(kv.second[i]);
+				}
+			}
+			return ret;
+		}
+
+		static std::string ReadLine(std::string const& path) {
+			std::ifstream fs(path);
+			std::string line;
+			std::getline(fs, line);
+			return line;
+		}
+
+		static int ReadInt(std::string const& path, int default_value) {
+			std::ifstream fs(path);
+			int v = default_value;
+			if (!(fs >> v)) return default_value;
+			return v;
+		}
+
+		// Parse a sysfs list, e.g., "0-3,8,10-11"
+		static std::vector<int> ParseList(std::string const& str) {
+			std::vector<int> ret;
+			std::stringstream ss(str);
+			std::string range;
+			while (std::getline(ss, range, ',')) {
+				if (range.empty()) continue;
+				auto dash = range.find('-');
+				try {
+					int first = std::stoi(range.substr(0, dash));
+					int last = (dash == std::string::npos) ? first : std::stoi(range.substr(dash + 1));
+					for (int v = first; v <= last; ++v) ret.push_back(v);
+				}
+				catch (std::exception const&) {
+					return std::vector<int>();
+				}
+			}
+			return ret;
+		}
+
+	private:
+		ThreadPlacementPolicy policy_;
+		size_t first_cpu_;
+		std::vector<Cpu> order_;
+	};
+}
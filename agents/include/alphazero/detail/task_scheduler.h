@@ -0,0 +1,279 @@
+#pragma once
+
+#include <assert.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "agents/ThreadPlacement.h"
+
+namespace alphazero
+{
+	namespace detail {
+		// In decreasing priority
+		enum class TaskPriority {
+			kTraining,
+			kEvaluation,
+			kSelfPlay,
+			kMax
+		};
+
+		// Counts the pending tasks submitted under it, so the submitter can wait for all of them
+		// A task may submit more tasks to its own group; the group is done only when all of them are.
+		class TaskGroup
+		{
+			friend class TaskScheduler;
+
+		public:
+			TaskGroup() : pending_(0), mutex_(), cv_() {}
+
+			TaskGroup(TaskGroup const&) = delete;
+			TaskGroup & operator=(TaskGroup const&) = delete;
+
+			bool IsDone() const { return pending_.load() == 0; }
+
+			// Thread safety: should not be called in a worker thread
+			void Wait() {
+				std::unique_lock<std::mutex> lock(mutex_);
+				cv_.wait(lock, [this]() { return pending_.load() == 0; });
+			}
+
+		private:
+			void Add() { ++pending_; }
+
+			void Done() {
+				// under the lock, so a waiter cannot return (and destroy the group) before notified
+				std::lock_guard<std::mutex> lock(mutex_);
+				if (--pending_ == 0) cv_.notify_all();
+			}
+
+		private:
+			std::atomic<size_t> pending_;
+			std::mutex mutex_;
+			std::condition_variable cv_;
+		};
+
+		// Runs the tasks of all the training phases on a fixed set of worker threads
+		// Each worker has a deque per priority. A task submitted from a worker goes to the back of
+		// its own deque, otherwise to the workers round-robin. A worker takes the highest-priority task
+		// available: from the back of its own deque (the most recent one; likely still in cache),
+		// or else stolen from the front of another worker's deque. So a worker never idles while any
+		// task is queued, and the tasks of a phase are not bound to the worker they are submitted to.
+		// Tasks are not preempted; keep each task short (e.g., one game) so a higher-priority task
+		// can start soon.
+		class TaskScheduler
+		{
+		public:
+			using ConditionCallback = std::function<bool()>;
+
+			struct WorkerStats {
+				int cpu; // -1 if not pinned
+				std::chrono::steady_clock::duration busy; // running tasks
+				std::chrono::steady_clock::duration idle; // waiting for tasks
+				std::uint64_t tasks;
+				std::uint64_t stolen; // tasks taken from other workers
+			};
+
+		private:
+			static constexpr size_t kPriorities = (size_t)TaskPriority::kMax;
+
+			struct Task {
+				Task() : func(), group(nullptr) {}
+				Task(std::function<void()> task_func, TaskGroup * task_group) : func(std::move(task_func)), group(task_group) {}
+
+				Task(Task const&) = delete;
+				Task & operator=(Task const&) = delete;
+				Task(Task &&) = default;
+				Task & operator=(Task &&) = default;
+
+				std::function<void()> func;
+				TaskGroup * group;
+			};
+
+			struct Worker {
+				Worker() :
+					mutex(), tasks(), thread(), cpu(-1),
+					busy_ns(0), idle_ns(0), tasks_run(0), tasks_stolen(0)
+				{}
+
+				std::mutex mutex; // guards 'tasks'
+				std::array<std::deque<Task>, kPriorities> tasks;
+				std::thread thread;
+				std::atomic<int> cpu;
+
+				std::atomic<std::int64_t> busy_ns;
+				std::atomic<std::int64_t> idle_ns;
+				std::atomic<std::uint64_t> tasks_run;
+				std::atomic<std::uint64_t> tasks_stolen;
+			};
+
+		public:
+			TaskScheduler() :
+				workers_(), next_worker_(0), queued_(0), stop_(false), sleep_mutex_(), sleep_cv_()
+			{}
+
+			~TaskScheduler() { Release(); }
+
+			TaskScheduler(TaskScheduler const&) = delete;
+			TaskScheduler & operator=(TaskScheduler const&) = delete;
+
+			// Thread safety: should be called in main thread
+			void Initialize(int threads, agents::ThreadPlacementPolicy placement_policy = agents::ThreadPlacementPolicy::kNone) {
+				assert(workers_.empty());
+				assert(threads > 0);
+				stop_ = false;
+				for (int i = 0; i < threads; ++i) {
+					workers_.emplace_back(new Worker());
+				}
+				agents::ThreadPlacement placement(placement_policy);
+				for (size_t i = 0; i < workers_.size(); ++i) {
+					workers_[i]->thread = std::thread(WorkerMain, this, i, placement.GetCpu(i));
+				}
+			}
+
+			// Thread safety: should be called in main thread, after all the task groups are done
+			void Release() {
+				if (workers_.empty()) return;
+				{
+					std::lock_guard<std::mutex> lock(sleep_mutex_);
+					stop_ = true;
+				}
+				sleep_cv_.notify_all();
+				for (auto & worker : workers_) worker->thread.join();
+				workers_.clear();
+			}
+
+			size_t GetWorkerCount() const { return workers_.size(); }
+
+			// Thread safety: Yes
+			void Submit(TaskPriority priority, TaskGroup & group, std::function<void()> func) {
+				assert(func);
+				assert(!workers_.empty());
+				group.Add();
+
+				size_t idx;
+				if (current_scheduler_ == this) idx = current_worker_;
+				else idx = next_worker_.fetch_add(1) % workers_.size();
+
+				Worker & worker = *workers_[idx];
+				{
+					std::lock_guard<std::mutex> lock(worker.mutex);
+					worker.tasks[(size_t)priority].emplace_back(std::move(func), &group);
+					++queued_;
+				}
+				{
+					// pairs with the check in WorkerLoop(), so the wake-up is not lost
+					std::lock_guard<std::mutex> lock(sleep_mutex_);
+				}
+				sleep_cv_.notify_one();
+			}
+
+			// Thread safety: Yes; the stats are updated after each task, and after each wait
+			WorkerStats GetWorkerStats(size_t idx) const {
+				auto const& worker = *workers_[idx];
+				WorkerStats stats;
+				stats.cpu = worker.cpu.load();
+				stats.busy = std::chrono::nanoseconds(worker.busy_ns.load());
+				stats.idle = std::chrono::nanoseconds(worker.idle_ns.load());
+				stats.tasks = worker.tasks_run.load();
+				stats.stolen = worker.tasks_stolen.load();
+				return stats;
+			}
+
+			void ResetStats() {
+				for (auto & worker : workers_) {
+					worker->busy_ns = 0;
+					worker->idle_ns = 0;
+					worker->tasks_run = 0;
+					worker->tasks_stolen = 0;
+				}
+			}
+
+		private:
+			static void WorkerMain(TaskScheduler * scheduler, size_t idx, int cpu) {
+				if (agents::ThreadPlacement::PinCurrentThread(cpu)) scheduler->workers_[idx]->cpu = cpu;
+				current_scheduler_ = scheduler;
+				current_worker_ = idx;
+				scheduler->WorkerLoop(idx);
+			}
+
+			void WorkerLoop(size_t idx) {
+				using Clock = std::chrono::steady_clock;
+				Worker & worker = *workers_[idx];
+
+				while (true) {
+					Task task;
+					bool stolen = false;
+					if (TryPop(idx, task, stolen)) {
+						auto start = Clock::now();
+						task.func();
+						task.group->Done();
+						auto duration = Clock::now() - start;
+
+						worker.busy_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+						++worker.tasks_run;
+						if (stolen) ++worker.tasks_stolen;
+						continue;
+					}
+
+					auto start = Clock::now();
+					{
+						std::unique_lock<std::mutex> lock(sleep_mutex_);
+						sleep_cv_.wait(lock, [this]() { return stop_ || queued_.load() > 0; });
+						if (stop_ && queued_.load() == 0) return;
+					}
+					auto duration = Clock::now() - start;
+					worker.idle_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+				}
+			}
+
+			// Own deque first, then steal; for each priority in turn
+			bool TryPop(size_t idx, Task & task, bool & stolen) {
+				size_t workers = workers_.size();
+				for (size_t priority = 0; priority < kPriorities; ++priority) {
+					for (size_t k = 0; k < workers; ++k) {
+						Worker & worker = *workers_[(idx + k) % workers];
+						std::lock_guard<std::mutex> lock(worker.mutex);
+						auto & tasks = worker.tasks[priority];
+						if (tasks.empty()) continue;
+
+						if (k == 0) {
+							task = std::move(tasks.back());
+							tasks.pop_back();
+						}
+						else {
+							task = std::move(tasks.front());
+							tasks.pop_front();
+						}
+						--queued_;
+						stolen = (k != 0);
+						return true;
+					}
+				}
+				return false;
+			}
+
+		private:
+			static thread_local TaskScheduler * current_scheduler_;
+			static thread_local size_t current_worker_;
+
+			std::vector<std::unique_ptr<Worker>> workers_;
+			std::atomic<size_t> next_worker_;
+			std::atomic<size_t> queued_;
+			bool stop_; // guarded by sleep_mutex_
+			std::mutex sleep_mutex_;
+			std::condition_variable sleep_cv_;
+		};
+
+		inline thread_local TaskScheduler * TaskScheduler::current_scheduler_ = nullptr;
+		inline thread_local size_t TaskScheduler::current_worker_ = 0;
+	}
+}
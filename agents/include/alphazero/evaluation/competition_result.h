@@ -1,34 +1,116 @@
 #pragma once
 
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+
 namespace alphazero
 {
 	namespace evaluation
 	{
+		// Sequential probability ratio test on the competitor's win rate
+		//   H0: win rate = win_rate_h0 (competitor is not better)
+		//   H1: win rate = win_rate_h1 (competitor is better)
+		// The test stops as soon as the log-likelihood ratio leaves (lower, upper).
+		struct SPRTOptions
+		{
+			SPRTOptions() :
+				enabled(true),
+				win_rate_h0(0.5),
+				win_rate_h1(0.6),
+				alpha(0.05),
+				beta(0.05)
+			{}
+
+			bool enabled;
+			double win_rate_h0;
+			double win_rate_h1;
+			double alpha; // probability to accept a competitor which is not better
+			double beta; // probability to reject a competitor which is better
+		};
+
+		enum class SPRTDecision {
+			kUndecided,
+			kAccepted, // H1
+			kRejected // H0
+		};
+
 		class CompetitionResult
 		{
+		private:
+			// Word layout: bits [0, 32) wins; bits [32, 64) games
+			// so a game result is recorded by one atomic add, and a reader always sees a consistent pair.
+			static constexpr int kGamesShift = 32;
+			static constexpr std::uint64_t kWinsMask = ((std::uint64_t)1 << kGamesShift) - 1;
+
 		public:
 			CompetitionResult() :
-				total_games(0),
-				competitor_wins(0)
+				games_and_wins_(0),
+				decision_(SPRTDecision::kUndecided),
+				sprt_(),
+				llr_win_(0.0), llr_loss_(0.0), llr_lower_(0.0), llr_upper_(0.0)
 			{}
 
-			void Clear() {
-				total_games = 0;
-				competitor_wins = 0;
+			// Not thread safe
+			void Clear(SPRTOptions const& sprt = SPRTOptions()) {
+				games_and_wins_ = 0;
+				decision_ = SPRTDecision::kUndecided;
+				sprt_ = sprt;
+
+				llr_win_ = std::log(sprt_.win_rate_h1 / sprt_.win_rate_h0);
+				llr_loss_ = std::log((1.0 - sprt_.win_rate_h1) / (1.0 - sprt_.win_rate_h0));
+				llr_lower_ = std::log(sprt_.beta / (1.0 - sprt_.alpha));
+				llr_upper_ = std::log((1.0 - sprt_.beta) / sprt_.alpha);
 			}
 
 			// Thread safe
 			void AddResult(bool win) {
-				++total_games;
-				if (win) ++competitor_wins;
+				std::uint64_t increment = ((std::uint64_t)1 << kGamesShift) + (win ? 1 : 0);
+				std::uint64_t word = games_and_wins_.fetch_add(increment) + increment;
+
+				if (!sprt_.enabled) return;
+				if (decision_.load(std::memory_order_relaxed) != SPRTDecision::kUndecided) return;
+
+				double llr = GetLLR(word);
+				SPRTDecision decision = SPRTDecision::kUndecided;
+				if (llr >= llr_upper_) decision = SPRTDecision::kAccepted;
+				else if (llr <= llr_lower_) decision = SPRTDecision::kRejected;
+				else return;
+
+				// the first decision made sticks; the games still running are counted but do not change it
+				SPRTDecision expected = SPRTDecision::kUndecided;
+				decision_.compare_exchange_strong(expected, decision);
 			}
 
-			int GetTotal() const { return total_games.load(); }
-			int GetWin() const { return competitor_wins.load(); }
+			int GetTotal() const { return GetTotal(games_and_wins_.load()); }
+			int GetWin() const { return GetWin(games_and_wins_.load()); }
+
+			// Thread safe
+			SPRTDecision GetDecision() const { return decision_.load(); }
+			bool IsDecided() const { return GetDecision() != SPRTDecision::kUndecided; }
+
+			// Log-likelihood ratio of H1 over H0
+			double GetLLR() const { return GetLLR(games_and_wins_.load()); }
 
 		private:
-			std::atomic<int> total_games;
-			std::atomic<int> competitor_wins;
+			static int GetTotal(std::uint64_t word) { return (int)(word >> kGamesShift); }
+			static int GetWin(std::uint64_t word) { return (int)(word & kWinsMask); }
+
+			double GetLLR(std::uint64_t word) const {
+				int wins = GetWin(word);
+				int losses = GetTotal(word) - wins;
+				return wins * llr_win_ + losses * llr_loss_;
+			}
+
+		private:
+			std::atomic<std::uint64_t> games_and_wins_;
+			std::atomic<SPRTDecision> decision_;
+
+			SPRTOptions sprt_;
+			double llr_win_;
+			double llr_loss_;
+			double llr_lower_;
+			double llr_upper_;
 		};
 	}
-}
\ No newline at end of file
+}
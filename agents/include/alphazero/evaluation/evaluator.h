@@ -31,45 +31,42 @@ namespace alphazero
 				competitor_net_path_ = competitor_net_path;
 			}
 
-			template <class Callback>
-			void Run(RunOptions const& options, Callback&& callback) {
+			// Play one game, and add its result
+			void PlayGame(RunOptions const& options) {
 				agents::MCTSAgentConfig best_agent_config = options.agent_config;
 				best_agent_config.mcts.SetNeuralNetPath(best_net_path_);
 
 				agents::MCTSAgentConfig competitor_agent_config = options.agent_config;
 				competitor_agent_config.mcts.SetNeuralNetPath(competitor_net_path_);
 
-				while (callback()) {
-					auto hand_card_seed = random_();
-					state::State start_state =
-						TestStateBuilder().GetStateWithRandomStartCard(hand_card_seed, random_);
+				auto hand_card_seed = random_();
+				state::State start_state =
+					TestStateBuilder().GetStateWithRandomStartCard(hand_card_seed, random_);
 
-					using MCTSAgent = agents::MCTSAgent<>;
-					judge::NullRecorder recorder;
-					judge::Judger<MCTSAgent> judger(random_, recorder);
-					MCTSAgent best_agent(best_agent_config);
-					MCTSAgent competitor_agent(competitor_agent_config);
+				using MCTSAgent = agents::MCTSAgent<>;
+				judge::NullRecorder recorder;
+				judge::Judger<MCTSAgent> judger(random_, recorder);
+				MCTSAgent best_agent(best_agent_config);
+				MCTSAgent competitor_agent(competitor_agent_config);
 
-					bool competitor_go_first = ((random_() % 2) == 0);
-					engine::Result competitor_win_result;
+				bool competitor_go_first = ((random_() % 2) == 0);
+				engine::Result competitor_win_result;
 
-					if (competitor_go_first) {
-						judger.SetFirstAgent(&competitor_agent);
-						judger.SetSecondAgent(&best_agent);
-						competitor_win_result = engine::kResultFirstPlayerWin;
-					}
-					else {
-						judger.SetFirstAgent(&best_agent);
-						judger.SetSecondAgent(&competitor_agent);
-						competitor_win_result = engine::kResultSecondPlayerWin;
-					}
+				if (competitor_go_first) {
+					judger.SetFirstAgent(&competitor_agent);
+					judger.SetSecondAgent(&best_agent);
+					competitor_win_result = engine::kResultFirstPlayerWin;
+				}
+				else {
+					judger.SetFirstAgent(&best_agent);
+					judger.SetSecondAgent(&competitor_agent);
+					competitor_win_result = engine::kResultSecondPlayerWin;
+				}
 
-					engine::Result result = judger.Start(start_state, random_);
-					bool competitor_win = (result == competitor_win_result);
+				engine::Result result = judger.Start(start_state, random_);
+				bool competitor_win = (result == competitor_win_result);
 
-					result_->AddResult(competitor_win);
-					std::this_thread::sleep_for(std::chrono::milliseconds(100));
-				}
+				result_->AddResult(competitor_win);
 			}
 
 			void AfterRun()
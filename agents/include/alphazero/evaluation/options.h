@@ -1,19 +1,52 @@
 #pragma once
 
+#include "alphazero/evaluation/competition_result.h"
+
 namespace alphazero
 {
 	namespace evaluation
 	{
+		// Cheap checks before the full MCTS gating
+		// A competitor failing any of them is rejected without playing the expensive games.
+		//   Tier 1: value-net loss and accuracy on the held-out replay slice, versus the best net
+		//   Tier 2: a few games with low-iteration MCTS agents
+		struct ScreeningOptions
+		{
+			ScreeningOptions() :
+				enabled(true),
+				max_accuracy_drop(0.02),
+				max_loss_increase(0.05),
+				runs(40),
+				min_win_rate(0.4),
+				agent_config()
+			{
+				agent_config.tree_samples = 1;
+				agent_config.iterations_per_action = 100;
+				agent_config.callback_interval_ms = 10;
+			}
+
+			bool enabled;
+			double max_accuracy_drop; // tier 1: competitor's accuracy can be at most this lower than the best net's
+			double max_loss_increase; // tier 1: competitor's loss can be at most this higher than the best net's
+			int runs; // tier 2: games to play; 0 to skip
+			double min_win_rate; // tier 2: the competitor needs to win at least this rate
+			agents::MCTSAgentConfig agent_config; // tier 2
+		};
+
 		struct RunOptions
 		{
 			RunOptions() :
 				runs(1000),
 				show_interval_ms(1000),
+				sprt(),
+				screening(),
 				agent_config()
 			{}
 
-			int runs;
+			int runs; // maximum games; fewer if SPRT decides early
 			int show_interval_ms;
+			SPRTOptions sprt;
+			ScreeningOptions screening;
 			agents::MCTSAgentConfig agent_config;
 		};
 	}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "alphazero/detail/task_scheduler.h"
 #include "alphazero/evaluation/evaluator.h"
 
 #include <vector>
@@ -18,7 +19,7 @@ namespace alphazero
 				result_(),
 				next_show_mutex_(),
 				next_show_(),
-				running_evaluators_(0)
+				condition_()
 			{}
 
 			Runner(Runner const&) = delete;
@@ -32,44 +33,51 @@ namespace alphazero
 
 			void BeforeRun(
 				RunOptions const& run_options,
-				std::vector<detail::ThreadRunner*> const& threads,
+				detail::TaskScheduler & scheduler,
+				detail::TaskGroup & group,
 				std::string const& best_net_path,
 				std::string const& competitor_net_path)
 			{
-				assert(threads.size() <= evaluators_.size());
-
-				result_.Clear();
+				result_.Clear(run_options.sprt);
 				next_show_ = std::chrono::steady_clock::now();
-				auto cond = [&run_options, this] () {
+				condition_ = [&run_options, this] () {
 					std::lock_guard<std::mutex> lock(next_show_mutex_);
 					auto now = std::chrono::steady_clock::now();
 					if (now > next_show_) {
 						next_show_ = now + std::chrono::milliseconds(run_options.show_interval_ms);
 						logger_.Info([&](auto& s) {
 							s << "Run " << result_.GetTotal() << " trials. Competitor wins " << result_.GetWin() << " times.";
+							if (run_options.sprt.enabled) s << " (LLR: " << result_.GetLLR() << ")";
 						});
 					}
+					if (result_.IsDecided()) return false;
 					return result_.GetTotal() < run_options.runs;
 				};
 
-				for (size_t i = 0; i < threads.size(); ++i) {
-					evaluators_[i].BeforeRun(best_net_path, competitor_net_path, result_);
+				for (auto & evaluator : evaluators_) {
+					evaluator.BeforeRun(best_net_path, competitor_net_path, result_);
 				}
 
-				for (size_t i = 0; i < threads.size(); ++i) {
-					auto & evaluator = evaluators_[i];
-					threads[i]->AsyncRunUnderCondition(cond, [&evaluator, &run_options, this](auto&& cb) {
-						evaluator.Run(run_options, cb);
-					});
+				for (size_t i = 0; i < evaluators_.size(); ++i) {
+					SubmitGame(run_options, scheduler, group, i);
 				}
-
-				running_evaluators_ = threads.size();
 			}
 
+			// The caller should wait for the group first
 			evaluation::CompetitionResult const& AfterRun() {
 				return result_;
 			}
 
+		private:
+			// Each evaluator plays one game per task, and submits its next game until the result is decided
+			void SubmitGame(RunOptions const& run_options, detail::TaskScheduler & scheduler, detail::TaskGroup & group, size_t idx) {
+				scheduler.Submit(detail::TaskPriority::kEvaluation, group, [this, &run_options, &scheduler, &group, idx]() {
+					if (!condition_()) return;
+					evaluators_[idx].PlayGame(run_options);
+					SubmitGame(run_options, scheduler, group, idx);
+				});
+			}
+
 		private:
 			ILogger & logger_;
 			std::mt19937 & random_;
@@ -79,7 +87,7 @@ namespace alphazero
 			std::mutex next_show_mutex_;
 			std::chrono::steady_clock::time_point next_show_;
 
-			size_t running_evaluators_;
+			detail::TaskScheduler::ConditionCallback condition_;
 		};
 	}
 }
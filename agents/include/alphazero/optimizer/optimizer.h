@@ -23,12 +23,13 @@ namespace alphazero
 				RunOptions const& options, neural_net::NeuralNetwork & neural_net, Callback cb)
 			{
 				while (cb()) {
-					// TODO: Train tiny_dnn in multiple threads
 					neural_net.Train(
 						input,
 						output,
 						options.batch_size,
-						options.epoches_per_run);
+						options.epoches_per_run,
+						options.threads,
+						options.epoches_per_sync);
 				}
 			}
 
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "alphazero/shared_data/training_data.h"
+
 namespace alphazero
 {
 	namespace optimizer
@@ -11,14 +13,28 @@ namespace alphazero
 				batches(100),
 				epoches(10000),
 				epoches_per_run(100),
-				maximum_fetch_failure_rate(0.1)
+				threads(1),
+				epoches_per_sync(10),
+				holdout(0),
+				sampling(),
+				maximum_fetch_failure_rate(0.1),
+				policy_epoches(10),
+				policy_learning_rate(0.01f)
 			{}
 
 			int batch_size;
 			int batches; // how many batches for training
 			int epoches;
 			int epoches_per_run;
-			double maximum_fetch_failure_rate; // maximum failure rate to fetch training data
+			int threads; // data-parallel training threads; each trains a replica on a shard of the data
+			int epoches_per_sync; // average the replicas' parameters every this many epochs
+			int holdout; // hold out this many records from training; to report the accuracy of int8 inference, and to screen the competitor
+			shared_data::SamplingOptions sampling;
+			double maximum_fetch_failure_rate; // fail if fewer than (1 - rate) of the wanted items can be sampled
+
+			// The policy network is trained after the value network, on the items with a recorded policy
+			int policy_epoches; // zero to not train the policy network
+			float policy_learning_rate;
 		};
 	}
 }
\ No newline at end of file
@@ -1,12 +1,15 @@
 #pragma once
 
 #include <assert.h>
+#include <algorithm>
 #include <chrono>
+#include <memory>
 #include <vector>
 
 #include "alphazero/logger.h"
-#include "alphazero/detail/thread_runner.h"
+#include "alphazero/detail/task_scheduler.h"
 #include "alphazero/optimizer/optimizer.h"
+#include "neural_net/PolicyNetwork.h"
 #include "alphazero/shared_data/training_data.h"
 
 namespace alphazero
@@ -17,7 +20,8 @@ namespace alphazero
 		{
 		public:
 			Runner(ILogger & logger) :
-				logger_(logger), optimizer_(), input_(), output_()
+				logger_(logger), optimizer_(), batch_(), input_(), output_(), holdout_input_(), holdout_output_(),
+				policy_inputs_(), policy_targets_(), holdout_policy_inputs_(), holdout_policy_targets_()
 			{}
 
 			void Initialize()
@@ -27,7 +31,8 @@ namespace alphazero
 
 			void BeforeRun(
 				RunOptions const& options,
-				detail::ThreadRunner* thread,
+				detail::TaskScheduler & scheduler,
+				detail::TaskGroup & group,
 				neural_net::NeuralNetwork & neural_net,
 				shared_data::TrainingData & training_data,
 				std::mt19937 & random)
@@ -36,24 +41,45 @@ namespace alphazero
 
 				input_.Clear();
 				output_.Clear();
+				holdout_input_.Clear();
+				holdout_output_.Clear();
+				policy_inputs_.clear();
+				policy_targets_.clear();
+				holdout_policy_inputs_.clear();
+				holdout_policy_targets_.clear();
 
-				int fetched = 0;
-				int rest_tries = options.batches * options.batch_size;
-				int allowed_fetch_failures = (int)(options.maximum_fetch_failure_rate * rest_tries);
-
-				while (--rest_tries >= 0) {
-					bool success = training_data.RandomGet(random, [&](shared_data::TrainingDataItem const& item) {
-						input_.AddData(&item.GetInput());
-						output_.AddData(item.GetLabel());
-						++fetched;
-					});
-					if (!success) {
-						if (--allowed_fetch_failures < 0) {
-							logger_.Info() << "Failed to fetch training data. (Too high failure rate).";
-							return;
-						}
+				size_t wanted = (size_t)(options.batches * options.batch_size + options.holdout);
+				size_t sampled = training_data.SampleBatch(random, wanted, options.sampling, batch_);
+				if (sampled < wanted * (1.0 - options.maximum_fetch_failure_rate)) {
+					logger_.Info() << "Failed to fetch training data. (Only " << sampled << " of " << wanted << " sampled).";
+					return;
+				}
+
+				// the holdout comes first, so the training items are at the tail of batch_
+				int held_out = std::min(options.holdout, (int)sampled);
+				for (size_t i = 0; i < sampled; ++i) {
+					auto const& input = batch_.inputs[i];
+					auto const& record = input.GetRecord();
+					if (i < (size_t)held_out) {
+						holdout_input_.AddData(&input);
+						holdout_output_.AddData(record.label);
+					}
+					else {
+						input_.AddData(&input);
+						output_.AddData(record.label);
+					}
+
+					if (record.policy.IsEmpty()) continue;
+					if (i < (size_t)held_out) {
+						holdout_policy_inputs_.push_back(&input);
+						holdout_policy_targets_.push_back(record.policy);
+					}
+					else {
+						policy_inputs_.push_back(&input);
+						policy_targets_.push_back(record.policy);
 					}
 				}
+				int fetched = (int)sampled - held_out;
 
 				if (fetched < options.batch_size) {
 					logger_.Info() << "Not enough training data for batch.";
@@ -62,7 +88,8 @@ namespace alphazero
 
 				logger_.Info() << "Training neural network... (fetched " << fetched << " data)";
 				optimizer_.BeforeRun();
-				thread->AsyncRun([&]() {
+				std::mt19937 predict_random(random());
+				scheduler.Submit(detail::TaskPriority::kTraining, group, [&, held_out, predict_random]() mutable {
 					int epoch = 0;
 					auto cb2 = [&]() {
 						epoch += options.epoches_per_run;
@@ -70,6 +97,9 @@ namespace alphazero
 						return epoch < options.epoches;
 					};
 					optimizer_.Run(input_, output_, options, neural_net, cb2);
+					if (options.sampling.prioritized) UpdatePriorities(neural_net, training_data, held_out, predict_random);
+					if (held_out > 0) ReportQuantization(neural_net);
+					TrainPolicy(options, neural_net, predict_random);
 				});
 			}
 
@@ -77,11 +107,65 @@ namespace alphazero
 				optimizer_.AfterRun();
 			}
 
+			// The records held out from the last training
+			neural_net::NeuralNetworkInput const& GetHoldoutInput() const { return holdout_input_; }
+			neural_net::NeuralNetworkOutput const& GetHoldoutOutput() const { return holdout_output_; }
+
+		private:
+			// Record the errors of the trained net to the trained items, for prioritized sampling
+			void UpdatePriorities(
+				neural_net::NeuralNetwork & neural_net, shared_data::TrainingData & training_data,
+				int held_out, std::mt19937 & random)
+			{
+				std::vector<double> predictions;
+				neural_net.Predict(input_, predictions, random);
+				assert(predictions.size() + held_out == batch_.Size());
+				for (size_t i = 0; i < predictions.size(); ++i) {
+					size_t idx = held_out + i;
+					training_data.SetError(batch_.indices[idx], predictions[i] - batch_.inputs[idx].GetRecord().label);
+				}
+			}
+
+			void ReportQuantization(neural_net::NeuralNetwork & neural_net) {
+				auto report = neural_net.MeasureQuantization(
+					holdout_input_, holdout_output_, neural_net::InferencePrecision::kInt8);
+				if (!report.available) return;
+				logger_.Info([&](auto& s) {
+					s << "Int8 inference on " << report.total << " held-out records: accuracy "
+						<< report.quantized_correct << " (float: " << report.float_correct << ")"
+						<< ", mean error " << report.mean_abs_error
+						<< ", max error " << report.max_abs_error << ".";
+				});
+			}
+
+			// batch_ keeps the inputs alive until the next BeforeRun()
+			void TrainPolicy(RunOptions const& options, neural_net::NeuralNetwork & neural_net, std::mt19937 & random) {
+				if (options.policy_epoches <= 0 || policy_inputs_.empty()) return;
+
+				auto & policy = neural_net.GetPolicy();
+				policy.Train(policy_inputs_, policy_targets_, options.policy_epoches, options.policy_learning_rate, random);
+				logger_.Info() << "Trained policy network on " << policy_inputs_.size() << " data.";
+
+				if (holdout_policy_inputs_.empty()) return;
+				auto report = policy.Evaluate(holdout_policy_inputs_, holdout_policy_targets_);
+				logger_.Info([&](auto& s) {
+					s << "Policy on " << report.total << " held-out records: top-1 accuracy "
+						<< report.correct << ", cross entropy " << report.cross_entropy << ".";
+				});
+			}
+
 		private:
 			ILogger & logger_;
 			Optimizer optimizer_;
+			shared_data::SampledBatch batch_;
 			neural_net::NeuralNetworkInput input_;
 			neural_net::NeuralNetworkOutput output_;
+			neural_net::NeuralNetworkInput holdout_input_;
+			neural_net::NeuralNetworkOutput holdout_output_;
+			std::vector<neural_net::IInputGetter const*> policy_inputs_;
+			std::vector<neural_net::MainOpPolicy> policy_targets_;
+			std::vector<neural_net::IInputGetter const*> holdout_policy_inputs_;
+			std::vector<neural_net::MainOpPolicy> holdout_policy_targets_;
 		};
 	}
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include <string>
 
 #include "agents/MCTSConfig.h"
+#include "alphazero/shared_data/record_augmenter.h"
 
 namespace alphazero
 {
@@ -12,7 +13,8 @@ namespace alphazero
 		{
 			RunOptions() :
 				save_dir(),
-				agent_config()
+				agent_config(),
+				augmentation()
 			{
 				agent_config.threads = 4;
 				agent_config.tree_samples = 10;
@@ -20,6 +22,7 @@ namespace alphazero
 
 			std::string save_dir;
 			agents::MCTSAgentConfig agent_config;
+			shared_data::AugmentationOptions augmentation;
 		};
 	}
 }
\ No newline at end of file
@@ -1,8 +1,11 @@
 #pragma once
 
+#include <algorithm>
+#include <limits>
+
 #include "alphazero/self_play/self_player.h"
 #include "alphazero/self_play/options.h"
-#include "alphazero/detail/thread_runner.h"
+#include "alphazero/detail/task_scheduler.h"
 
 namespace alphazero
 {
@@ -16,7 +19,9 @@ namespace alphazero
 				run_options_(),
 				training_data_(nullptr),
 				players_(),
-				running_players_(0)
+				running_players_(0),
+				condition_(),
+				start_()
 			{}
 
 			Runner(Runner const&) = delete;
@@ -30,29 +35,30 @@ namespace alphazero
 				run_options_ = options;
 			}
 
-			void BeforeRun(int milliseconds, std::vector<detail::ThreadRunner*> const& threads, neural_net::NeuralNetwork const& neural_net) {
+			void BeforeRun(int milliseconds, detail::TaskScheduler & scheduler, detail::TaskGroup & group, neural_net::NeuralNetwork const& neural_net) {
 				auto start = std::chrono::steady_clock::now();
 				auto until = start + std::chrono::milliseconds(milliseconds);
 				return BeforeRun([until]() {
 					return std::chrono::steady_clock::now() < until;
-				}, threads, neural_net);
+				}, scheduler, group, neural_net);
 			}
-			
-			void BeforeRun(detail::ThreadRunner::ConditionCallback condition, std::vector<detail::ThreadRunner*> const& threads, neural_net::NeuralNetwork const& neural_net) {
-				assert(threads.size() <= players_.size());
 
-				for (size_t i = 0; i < threads.size(); ++i) {
+			// Each player plays one game per task, and submits its next game while the condition holds
+			// The caller should wait for the group before AfterRun().
+			// @param max_players  Run at most this number of players, i.e., of games at a time
+			void BeforeRun(detail::TaskScheduler::ConditionCallback condition, detail::TaskScheduler & scheduler, detail::TaskGroup & group, neural_net::NeuralNetwork const& neural_net,
+				size_t max_players = std::numeric_limits<size_t>::max())
+			{
+				running_players_ = std::min(players_.size(), max_players);
+				for (size_t i = 0; i < running_players_; ++i) {
 					players_[i].BeforeRun(*training_data_, neural_net, run_options_);
 				}
 
-				for (size_t i = 0; i < threads.size(); ++i) {
-					auto & player = players_[i];
-					threads[i]->AsyncRunUnderCondition(condition, [&](auto&& cb) {
-						player.Run(cb);
-					});
+				condition_ = std::move(condition);
+				start_ = std::chrono::steady_clock::now();
+				for (size_t i = 0; i < running_players_; ++i) {
+					SubmitGame(scheduler, group, i);
 				}
-
-				running_players_ = threads.size();
 			}
 
 			RunResult AfterRun() {
@@ -60,16 +66,37 @@ namespace alphazero
 				for (size_t i = 0; i < running_players_; ++i) {
 					result += players_[i].AfterRun();
 				}
+				LogRate(result);
 				return result;
 			}
 
+		private:
+			void SubmitGame(detail::TaskScheduler & scheduler, detail::TaskGroup & group, size_t idx) {
+				scheduler.Submit(detail::TaskPriority::kSelfPlay, group, [this, &scheduler, &group, idx]() {
+					if (!condition_()) return;
+					players_[idx].PlayGame();
+					SubmitGame(scheduler, group, idx);
+				});
+			}
+
+			void LogRate(RunResult const& result) {
+				auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_).count();
+				logger_.Info([&](auto& s) {
+					s << "Self-play: " << result.generated_count_ << " records by " << running_players_ << " players";
+					if (ms > 0) s << ", " << (result.generated_count_ * 1000.0 / ms) << " per second";
+					s << ".";
+				});
+			}
+
 		private:
 			ILogger & logger_;
 			RunOptions run_options_;
 			shared_data::TrainingData * training_data_;
 			std::vector<self_play::SelfPlayer> players_;
-
 			size_t running_players_;
+
+			detail::TaskScheduler::ConditionCallback condition_;
+			std::chrono::steady_clock::time_point start_;
 		};
 	}
 }
@@ -59,7 +59,7 @@ namespace alphazero
 		public:
 			SelfPlayer(ILogger & logger, int rand_seed) :
 				logger_(logger), random_(rand_seed),
-				data_(nullptr), config_(), tmp_file_(),
+				data_(nullptr), config_(), augmenter_(), tmp_file_(),
 				result_()
 			{}
 			~SelfPlayer() { RemoveTempFile(); }
@@ -81,11 +81,13 @@ namespace alphazero
 
 				config_ = config;
 				config_.agent_config.mcts.SetNeuralNetPath(tmp_file_, neural_net.IsRandom());
+				config_.agent_config.early_stop = false; // the visit counts are recorded as policy targets
+				augmenter_.Initialize(config_.augmentation);
 			}
 
+			// Play one game
 			// Thread safety: No
-			template <class Callback>
-			void Run(Callback && callback) {
+			void PlayGame() {
 				// TODO: Choose actions proportions to its visit counts.
 				// TODO: Add Dirchlet distribution to root node. This further ensures the variety.
 
@@ -93,30 +95,32 @@ namespace alphazero
 					mcts::StaticConfigs::SimulationPhaseSelectActionPolicy,
 					mcts::policy::simulation::HeuristicPlayoutWithHeuristicEarlyCutoffPolicy>);
 
-				while (callback()) {
-					auto hand_card_seed = random_();
-					state::State start_state =
-						TestStateBuilder().GetStateWithRandomStartCard(hand_card_seed, random_);
+				auto hand_card_seed = random_();
+				state::State start_state =
+					TestStateBuilder().GetStateWithRandomStartCard(hand_card_seed, random_);
 
-					using MCTSAgent = agents::MCTSAgent<AgentCallback>;
-					judge::json::Recorder recorder(random_);
-					judge::Judger<MCTSAgent, judge::json::Recorder> judger(random_, recorder);
-					MCTSAgent first(config_.agent_config, AgentCallback(logger_));
-					MCTSAgent second(config_.agent_config, AgentCallback(logger_));
+				using MCTSAgent = agents::MCTSAgent<AgentCallback>;
+				judge::json::Recorder recorder(random_);
+				judge::Judger<MCTSAgent, judge::json::Recorder> judger(random_, recorder);
+				MCTSAgent first(config_.agent_config, AgentCallback(logger_));
+				MCTSAgent second(config_.agent_config, AgentCallback(logger_));
 
-					judger.SetFirstAgent(&first);
-					judger.SetSecondAgent(&second);
+				judger.SetFirstAgent(&first);
+				judger.SetSecondAgent(&second);
 
-					judger.Start(start_state, random_);
+				judger.Start(start_state, random_);
 
-					SaveJson(recorder.GetJson());
+				SaveJson(recorder.GetJson());
 
-					judge::json::Reader reader;
-					reader.Parse(recorder.GetJson(), [&](judge::json::NeuralNetInputGetter const& input, int label) {
-						data_->Push(std::make_shared<shared_data::TrainingDataItem>(input, label));
+				augmenter_.StartGame();
+				judge::json::Reader reader;
+				reader.Parse(recorder.GetJson(), [&](judge::json::NeuralNetInputGetter const& input, int label, neural_net::MainOpPolicy const& policy) {
+					auto record = shared_data::TrainingRecord::Pack(input, label, policy);
+					augmenter_.Augment(record, random_, [&](shared_data::TrainingRecord const& variant) {
+						data_->Push(std::make_shared<shared_data::TrainingDataItem>(variant));
 						++result_.generated_count_;
 					});
-				}
+				});
 			}
 
 			RunResult AfterRun() {
@@ -164,6 +168,7 @@ namespace alphazero
 			std::mt19937 random_;
 			shared_data::TrainingData * data_;
 			RunOptions config_;
+			shared_data::RecordAugmenter augmenter_;
 
 			std::string tmp_file_;
 
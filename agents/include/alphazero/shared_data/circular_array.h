@@ -45,13 +45,19 @@ namespace alphazero
 				return ret;
 			}
 
-			T const& Get(size_t idx) const {
-				idx += head_.load();
-				return items_[GetIndex(idx)];
+			// Like AllocateNext(), but returns the ever-increasing index of the allocated item
+			// Use At() to access the item.
+			size_t AllocateNextIndex() {
+				return head_.fetch_add(1);
 			}
+			T & At(size_t idx) { return items_[GetIndex(idx)]; }
+			T const& At(size_t idx) const { return items_[GetIndex(idx)]; }
 
-			// don't need to fetch head index, since we're fetching a random item
-			T const& RandomGet(size_t idx) const {
+			// Number of items ever allocated
+			size_t GetHead() const { return head_.load(); }
+
+			T const& Get(size_t idx) const {
+				idx += head_.load();
 				return items_[GetIndex(idx)];
 			}
 
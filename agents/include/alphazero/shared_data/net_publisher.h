@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include "neural_net/NeuralNetwork.h"
+#include "neural_net/PolicyNetwork.h"
+
+namespace alphazero
+{
+	namespace shared_data
+	{
+		// Publishes versioned neural nets to a directory, for other processes on the same host
+		//   <dir>/net.<version>  the neural net of each version (and its policy network beside it)
+		//   <dir>/net.version    the latest version; replaced atomically (by rename) after the net is written
+		// The last kKeptVersions versions are kept, so a reader who just saw an older version can still load it.
+		// A reader using a version for long (e.g., over a game) should load it once and keep its own copy.
+		class NetPublisher
+		{
+		public:
+			static constexpr int kKeptVersions = 4;
+
+			NetPublisher() : dir_(), version_(0) {}
+
+			// Continue the versions already in 'dir', if any
+			void Initialize(std::string const& dir) {
+				dir_ = dir;
+				version_ = ReadVersion(dir_);
+			}
+
+			// Thread safety: No
+			// @return  The published version
+			int Publish(neural_net::NeuralNetwork const& neural_net) {
+				int version = version_ + 1;
+				neural_net.Save(GetNetPath(dir_, version));
+
+				std::string tmp_path = GetVersionPath(dir_) + ".tmp";
+				{
+					std::ofstream fs(tmp_path, std::ofstream::trunc);
+					fs << version << std::endl;
+				}
+				std::rename(tmp_path.c_str(), GetVersionPath(dir_).c_str());
+
+				if (version > kKeptVersions) {
+					auto old_path = GetNetPath(dir_, version - kKeptVersions);
+					std::remove(old_path.c_str());
+					std::remove(neural_net::PolicyNetwork::GetPath(old_path).c_str());
+				}
+				version_ = version;
+				return version;
+			}
+
+			// @return  The latest version published to 'dir'; 0 if none
+			static int ReadVersion(std::string const& dir) {
+				std::ifstream fs(GetVersionPath(dir));
+				int version = 0;
+				if (!(fs >> version)) return 0;
+				return version;
+			}
+
+			static std::string GetNetPath(std::string const& dir, int version) {
+				return dir + "/net." + std::to_string(version);
+			}
+
+		private:
+			static std::string GetVersionPath(std::string const& dir) {
+				return dir + "/net.version";
+			}
+
+		private:
+			std::string dir_;
+			int version_;
+		};
+	}
+}
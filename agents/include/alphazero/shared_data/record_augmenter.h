@@ -0,0 +1,123 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <unordered_set>
+
+#include "alphazero/shared_data/training_record.h"
+
+namespace alphazero
+{
+	namespace shared_data
+	{
+		struct AugmentationOptions
+		{
+			AugmentationOptions() :
+				canonical_hand(true),
+				hand_permutations(2),
+				minion_permutations(0),
+				dedupe(true)
+			{}
+
+			// The neural network sees the hand cards by slot, but their order carries no information
+			// (state::kOrderHandCardsByCardId is false). So any order of the hand is the same position.
+
+			// Also emit the record with the hand sorted by (cost, playable)
+			bool canonical_hand;
+
+			// Number of variants with the hand shuffled
+			int hand_permutations;
+
+			// Number of variants with the minions of both sides shuffled
+			// Not an exact symmetry: the minion order matters for adjacency effects.
+			int minion_permutations;
+
+			// Drop a record the value network cannot tell from one already emitted in this game
+			// (by TrainingRecord::GetFingerprint())
+			// Only within a game, since the same position may have another outcome in another game.
+			bool dedupe;
+		};
+
+		// Turns each recorded board to a few equivalent training records
+		// Thread safety: No. Use one augmenter per self-player.
+		class RecordAugmenter
+		{
+		public:
+			RecordAugmenter() : options_(), fingerprints_(), emitted_(0), dropped_(0) {}
+
+			void Initialize(AugmentationOptions const& options) {
+				options_ = options;
+				StartGame();
+			}
+
+			void StartGame() {
+				fingerprints_.clear();
+			}
+
+			// @param cb  Invoked as cb(TrainingRecord const&) for the record itself, and for each new variant
+			template <class Callback>
+			void Augment(TrainingRecord const& record, std::mt19937 & random, Callback && cb) {
+				Emit(record, cb);
+
+				auto const& current = record.sides[(int)neural_net::FieldSide::kCurrent];
+				if (current.hand_count > 1) {
+					if (options_.canonical_hand) {
+						TrainingRecord variant = record;
+						SortHand(variant);
+						Emit(variant, cb);
+					}
+					for (int i = 0; i < options_.hand_permutations; ++i) {
+						TrainingRecord variant = record;
+						ShuffleHand(variant, random);
+						Emit(variant, cb);
+					}
+				}
+
+				for (int i = 0; i < options_.minion_permutations; ++i) {
+					TrainingRecord variant = record;
+					for (auto & side : variant.sides) {
+						std::shuffle(side.minions, side.minions + side.minion_count, random);
+					}
+					Emit(variant, cb);
+				}
+			}
+
+			size_t GetEmitted() const { return emitted_; }
+
+			// Number of records dropped as duplicates
+			size_t GetDropped() const { return dropped_; }
+
+		private:
+			template <class Callback>
+			void Emit(TrainingRecord const& record, Callback && cb) {
+				if (options_.dedupe && !fingerprints_.insert(record.GetFingerprint()).second) {
+					++dropped_;
+					return;
+				}
+				cb(record);
+				++emitted_;
+			}
+
+			static void SortHand(TrainingRecord & record) {
+				auto & side = record.sides[(int)neural_net::FieldSide::kCurrent];
+				std::sort(side.hand, side.hand + side.hand_count,
+					[](TrainingRecord::HandCard const& lhs, TrainingRecord::HandCard const& rhs) {
+					if (lhs.cost != rhs.cost) return lhs.cost < rhs.cost;
+					return lhs.playable < rhs.playable;
+				});
+			}
+
+			static void ShuffleHand(TrainingRecord & record, std::mt19937 & random) {
+				auto & side = record.sides[(int)neural_net::FieldSide::kCurrent];
+				std::shuffle(side.hand, side.hand + side.hand_count, random);
+			}
+
+		private:
+			AugmentationOptions options_;
+			std::unordered_set<std::uint64_t> fingerprints_;
+			size_t emitted_;
+			size_t dropped_;
+		};
+	}
+}
@@ -0,0 +1,255 @@
+#pragma once
+
+#include <assert.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "alphazero/shared_data/training_record.h"
+
+namespace alphazero
+{
+	namespace shared_data
+	{
+		// Training records are sent between processes on the same host as Unix datagrams
+		// A datagram is delivered whole or not at all, so a self-play process crashing halfway
+		// cannot leave a torn record behind; and the collector does not need to track connections.
+		// Only supported on Linux; Open() fails on other platforms.
+		namespace record_socket
+		{
+			struct Header {
+				std::uint32_t magic;
+				std::uint16_t version;
+				std::uint16_t count;
+			};
+
+			// keep a datagram well below the default socket buffer size
+			static constexpr size_t kMaxRecordsPerDatagram = 64;
+			static constexpr size_t kMaxDatagramSize = sizeof(Header) + kMaxRecordsPerDatagram * sizeof(TrainingRecord);
+
+			// datagrams handled in one RecordCollector::Receive() call, so a busy socket cannot starve the caller
+			static constexpr size_t kMaxDatagramsPerReceive = 1024;
+
+			// datagrams a RecordSender holds while the collector is not receiving (e.g., the trainer is training)
+			static constexpr size_t kMaxSpooledDatagrams = 256;
+		}
+
+		// Never blocks: while the collector's receive buffer is full, the datagrams are spooled in memory,
+		// and sent by the next Send() or Flush(). If the spool is full, the oldest datagrams are dropped,
+		// since the newest records are from the strongest neural net.
+		// Thread safety: No
+		class RecordSender
+		{
+		public:
+			RecordSender() : fd_(-1), path_(), spool_(), dropped_(0) {}
+			~RecordSender() { Close(); }
+
+			RecordSender(RecordSender const&) = delete;
+			RecordSender & operator=(RecordSender const&) = delete;
+
+			bool Open(std::string const& path) {
+				Close();
+#ifdef __linux__
+				if (path.size() >= sizeof(sockaddr_un::sun_path)) return false;
+				fd_ = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+				if (fd_ < 0) return false;
+				path_ = path;
+				return true;
+#else
+				(void)path;
+				return false;
+#endif
+			}
+
+			void Close() {
+#ifdef __linux__
+				if (fd_ >= 0) close(fd_);
+#endif
+				fd_ = -1;
+			}
+
+			// @return  false if the collector is not running, or on other errors; the spooled records are kept
+			bool Send(std::vector<TrainingRecord> const& records) {
+				for (size_t start = 0; start < records.size(); start += record_socket::kMaxRecordsPerDatagram) {
+					size_t count = std::min(records.size() - start, record_socket::kMaxRecordsPerDatagram);
+
+					record_socket::Header header;
+					header.magic = TrainingRecord::kMagic;
+					header.version = TrainingRecord::kVersion;
+					header.count = (std::uint16_t)count;
+
+					if (spool_.size() >= record_socket::kMaxSpooledDatagrams) {
+						dropped_ += (spool_.front().size() - sizeof(header)) / sizeof(TrainingRecord);
+						spool_.pop_front();
+					}
+					spool_.emplace_back(sizeof(header) + count * sizeof(TrainingRecord));
+					auto & buffer = spool_.back();
+					std::memcpy(buffer.data(), &header, sizeof(header));
+					std::memcpy(buffer.data() + sizeof(header), &records[start], count * sizeof(TrainingRecord));
+				}
+				return Flush();
+			}
+
+			// Send the spooled datagrams, until the collector's receive buffer is full
+			// @return  false if the collector is not running, or on other errors
+			bool Flush() {
+#ifdef __linux__
+				if (fd_ < 0) return false;
+
+				sockaddr_un addr;
+				std::memset(&addr, 0, sizeof(addr));
+				addr.sun_family = AF_UNIX;
+				std::strncpy(addr.sun_path, path_.c_str(), sizeof(addr.sun_path) - 1);
+
+				while (!spool_.empty()) {
+					auto const& buffer = spool_.front();
+					ssize_t sent;
+					do {
+						sent = sendto(fd_, buffer.data(), buffer.size(), MSG_DONTWAIT, (sockaddr const*)&addr, sizeof(addr));
+					} while (sent < 0 && errno == EINTR);
+					if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true; // collector is behind
+					if (sent != (ssize_t)buffer.size()) return false;
+					spool_.pop_front();
+				}
+				return true;
+#else
+				return false;
+#endif
+			}
+
+			// Number of records waiting in the spool
+			size_t GetSpooled() const {
+				size_t records = 0;
+				for (auto const& buffer : spool_) {
+					records += (buffer.size() - sizeof(record_socket::Header)) / sizeof(TrainingRecord);
+				}
+				return records;
+			}
+
+			// Number of records dropped since the spool is full
+			size_t GetDropped() const { return dropped_; }
+
+		private:
+			int fd_;
+			std::string path_;
+			std::deque<std::vector<char>> spool_; // datagrams not sent yet
+			size_t dropped_;
+		};
+
+		// Receives the records from any number of RecordSenders
+		// Thread safety: No
+		class RecordCollector
+		{
+		public:
+			RecordCollector() : fd_(-1), path_(), buffer_(record_socket::kMaxDatagramSize), dropped_(0) {}
+			~RecordCollector() { Close(); }
+
+			RecordCollector(RecordCollector const&) = delete;
+			RecordCollector & operator=(RecordCollector const&) = delete;
+
+			// A stale socket file at 'path' (e.g., left by a crashed collector) is replaced
+			bool Open(std::string const& path) {
+				Close();
+#ifdef __linux__
+				if (path.size() >= sizeof(sockaddr_un::sun_path)) return false;
+				fd_ = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+				if (fd_ < 0) return false;
+
+				sockaddr_un addr;
+				std::memset(&addr, 0, sizeof(addr));
+				addr.sun_family = AF_UNIX;
+				std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+				unlink(path.c_str());
+				if (bind(fd_, (sockaddr const*)&addr, sizeof(addr)) != 0) {
+					Close();
+					return false;
+				}
+				path_ = path;
+				return true;
+#else
+				(void)path;
+				return false;
+#endif
+			}
+
+			void Close() {
+#ifdef __linux__
+				if (fd_ >= 0) {
+					close(fd_);
+					if (!path_.empty()) unlink(path_.c_str());
+				}
+#endif
+				fd_ = -1;
+				path_.clear();
+			}
+
+			// Receive the pending records, waiting at most 'timeout_ms' for the first datagram
+			// @param callback  Invoked as callback(TrainingRecord const&) for each record
+			// @return  The number of records received
+			template <class Callback>
+			size_t Receive(int timeout_ms, Callback && callback) {
+				size_t received = 0;
+#ifdef __linux__
+				if (fd_ < 0) return 0;
+
+				pollfd pfd;
+				pfd.fd = fd_;
+				pfd.events = POLLIN;
+				pfd.revents = 0;
+				if (poll(&pfd, 1, timeout_ms) <= 0) return 0;
+
+				for (size_t datagrams = 0; datagrams < record_socket::kMaxDatagramsPerReceive; ++datagrams) {
+					ssize_t size = recv(fd_, buffer_.data(), buffer_.size(), MSG_DONTWAIT);
+					if (size < 0) {
+						if (errno == EINTR) continue;
+						break; // EAGAIN: drained
+					}
+
+					record_socket::Header header;
+					if ((size_t)size < sizeof(header)) { ++dropped_; continue; }
+					std::memcpy(&header, buffer_.data(), sizeof(header));
+					if (header.magic != TrainingRecord::kMagic ||
+						header.version != TrainingRecord::kVersion ||
+						(size_t)size != sizeof(header) + header.count * sizeof(TrainingRecord))
+					{
+						++dropped_;
+						continue;
+					}
+
+					for (size_t i = 0; i < header.count; ++i) {
+						TrainingRecord record;
+						std::memcpy(&record, buffer_.data() + sizeof(header) + i * sizeof(TrainingRecord), sizeof(record));
+						callback(record);
+						++received;
+					}
+				}
+#else
+				(void)timeout_ms;
+				(void)callback;
+#endif
+				return received;
+			}
+
+			// Number of malformed datagrams dropped
+			size_t GetDropped() const { return dropped_; }
+
+		private:
+			int fd_;
+			std::string path_;
+			std::vector<char> buffer_;
+			size_t dropped_;
+		};
+	}
+}
@@ -22,7 +22,7 @@ namespace alphazero
 			}
 
 			std::shared_ptr<T> Get() const {
-				return item_;
+				return std::atomic_load(&item_);
 			}
 
 		private:
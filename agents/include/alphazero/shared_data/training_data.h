@@ -1,13 +1,18 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <memory>
 #include <random>
 #include <mutex>
-
-#include "json/value.h"
+#include <unordered_set>
+#include <vector>
 
 #include "alphazero/shared_data/circular_array.h"
 #include "alphazero/shared_data/shared_ptr_item.h"
-#include "judge/json/Reader.h"
+#include "alphazero/shared_data/training_record.h"
 
 namespace alphazero
 {
@@ -15,25 +20,94 @@ namespace alphazero
 	{
 		class TrainingDataItem {
 		public:
-			TrainingDataItem(judge::json::NeuralNetInputGetter input, int label) :
-				input_(input), label_(label)
+			// Priorities are the absolute errors of the value net, in [0, 2]; plus a small floor,
+			// so an item never becomes unreachable.
+			static constexpr float kMinPriority = 0.01f;
+			static constexpr float kMaxPriority = 2.0f + kMinPriority;
+
+			TrainingDataItem(
+				neural_net::IInputGetter const& input, int label,
+				neural_net::MainOpPolicy const& policy = neural_net::MainOpPolicy::Empty()) :
+				TrainingDataItem(TrainingRecord::Pack(input, label, policy))
+			{}
+
+			explicit TrainingDataItem(TrainingRecord const& record) :
+				input_(record), label_(record.label), fingerprint_(record.GetFingerprint()), priority_(kMaxPriority)
 			{}
 
 			auto const& GetInput() const { return input_; }
 			auto GetLabel() const { return label_; }
 
+			// The target of the policy network; empty if not recorded
+			auto const& GetPolicy() const { return input_.GetRecord().policy; }
+
+			// See TrainingRecord::GetFingerprint()
+			std::uint64_t GetFingerprint() const { return fingerprint_; }
+
+			// Thread safe
+			float GetPriority() const { return priority_.load(std::memory_order_relaxed); }
+			void SetError(double error) {
+				float priority = std::min(kMaxPriority, (float)std::abs(error) + kMinPriority);
+				priority_.store(priority, std::memory_order_relaxed);
+			}
+
 		private:
-			judge::json::NeuralNetInputGetter input_;
+			TrainingRecordInputGetter input_;
 			int label_;
+			std::uint64_t fingerprint_;
+			std::atomic<float> priority_;
+		};
+
+		struct SamplingOptions
+		{
+			SamplingOptions() :
+				recency_exponent(1.0),
+				prioritized(false),
+				dedupe(false)
+			{}
+
+			// The age of a sampled item (0 for the newest) is window * u^recency_exponent,
+			// for u uniform in [0, 1). 1.0 for uniform sampling; larger values favor recent items.
+			double recency_exponent;
+
+			// Favor the items the value net predicts badly; see TrainingDataItem::SetError()
+			bool prioritized;
+
+			// Do not sample two items with the same board fingerprint into one batch
+			bool dedupe;
+		};
+
+		// The sampled items, copied out of the replay
+		// The records are contiguous and owned by the batch, so they stay valid even if rotated out;
+		// and no reference is held to the items.
+		struct SampledBatch
+		{
+			SampledBatch() : inputs(), indices() {}
+
+			void Clear() {
+				inputs.clear();
+				indices.clear();
+			}
+
+			size_t Size() const { return inputs.size(); }
+
+			std::vector<TrainingRecordInputGetter> inputs; // the label and the policy are in the records
+			std::vector<size_t> indices; // of the items in the replay; see TrainingData::SetError()
 		};
 
 		class TrainingData
 		{
+		private:
+			static constexpr int kPrioritizedCandidates = 8;
+			static constexpr int kMaxDrawsPerItem = 4;
+
 		public:
-			TrainingData() : data_(), size_() {}
+			TrainingData() : data_(), sequences_(), size_() {}
 
 			void Initialize(size_t capacity_power_two) {
 				data_.Initialize(capacity_power_two);
+				sequences_.reset(new std::atomic<std::uint64_t>[data_.GetCapacity()]);
+				for (size_t i = 0; i < data_.GetCapacity(); ++i) sequences_[i] = 0;
 				size_ = 0;
 			}
 
@@ -44,30 +118,98 @@ namespace alphazero
 			size_t GetSize() const { return size_.load(); }
 
 			void Push(std::shared_ptr<TrainingDataItem> item) {
-				data_.AllocateNext().Write(std::move(item));
+				size_t idx = data_.AllocateNextIndex();
+				data_.At(idx).Write(std::move(item));
+
+				// publish the slot; a reader sees sequence (idx + 1) only after the item is written
+				sequences_[idx & (data_.GetCapacity() - 1)].store(idx + 1, std::memory_order_release);
 				++size_;
 			}
 
-			template <class Callback>
-			bool RandomGet(std::mt19937 & random, Callback&& callback) {
-				// Fetch the item according to the size. This increase the probability to actually
-				// fetch an item which is already written by a writer. But noted that we still has
-				// a chance to get an empty (or very old data) if the writer is slow.
-				int idx = random() % size_.load();
-
-				// acquire ownership, so it will not be rotated out.
-				auto shared_ptr_item = data_.RandomGet(idx).Get();
-				
-				// We still has a chance to read an empty data.
-				if (!shared_ptr_item) return false;
-
-				callback(*shared_ptr_item);
-				return true;
+			// Sample up to 'count' items into 'batch', in one call
+			// Slots still being written are skipped (by their sequence numbers) in favor of the next older item.
+			// Each item is held only while its record is copied; the copy is what the optimizer reads.
+			// @return  The number of sampled items; fewer than 'count' only if there are not enough
+			//          (distinct, if options.dedupe) items
+			size_t SampleBatch(std::mt19937 & random, size_t count, SamplingOptions const& options, SampledBatch & batch) const {
+				batch.Clear();
+				batch.inputs.reserve(count);
+				batch.indices.reserve(count);
+
+				size_t head = data_.GetHead();
+				size_t window = std::min(head, data_.GetCapacity());
+				if (window == 0) return 0;
+
+				std::unordered_set<std::uint64_t> fingerprints;
+				if (options.dedupe) fingerprints.reserve(count * 2);
+
+				size_t draws = count * kMaxDrawsPerItem;
+				while (batch.Size() < count && draws > 0) {
+					--draws;
+					size_t idx = 0;
+					auto item = options.prioritized ?
+						SamplePrioritized(random, head, window, options, idx) :
+						Sample(random, head, window, options, idx);
+					if (!item) continue;
+
+					if (options.dedupe && !fingerprints.insert(item->GetFingerprint()).second) continue;
+					batch.inputs.push_back(item->GetInput());
+					batch.indices.push_back(idx);
+				}
+				return batch.Size();
+			}
+
+			// Record the error of the value net on a sampled item, for prioritized sampling
+			// Ignored if the item is rotated out since.
+			void SetError(size_t idx, double error) const {
+				auto sequence = sequences_[idx & (data_.GetCapacity() - 1)].load(std::memory_order_acquire);
+				if (sequence != idx + 1) return;
+
+				// might be overwritten by a newer item at this point, which is fine
+				auto item = data_.At(idx).Get();
+				if (item) item->SetError(error);
+			}
+
+		private:
+			std::shared_ptr<TrainingDataItem> Sample(
+				std::mt19937 & random, size_t head, size_t window, SamplingOptions const& options, size_t & idx) const
+			{
+				double u = std::uniform_real_distribution<double>(0.0, 1.0)(random);
+				if (options.recency_exponent != 1.0) u = std::pow(u, options.recency_exponent);
+				size_t age = std::min((size_t)(u * window), window - 1);
+
+				// walk to older items if the slot is not written yet
+				for (; age < window; ++age) {
+					idx = head - 1 - age;
+					auto sequence = sequences_[idx & (data_.GetCapacity() - 1)].load(std::memory_order_acquire);
+					if (sequence < idx + 1) continue; // being written
+
+					// might be overwritten by a newer item at this point, which is fine
+					auto item = data_.At(idx).Get();
+					if (item) return item;
+				}
+				return nullptr;
+			}
+
+			// Draw a few candidates, and accept each with probability proportional to its priority
+			std::shared_ptr<TrainingDataItem> SamplePrioritized(
+				std::mt19937 & random, size_t head, size_t window, SamplingOptions const& options, size_t & idx) const
+			{
+				std::shared_ptr<TrainingDataItem> item;
+				for (int i = 0; i < kPrioritizedCandidates; ++i) {
+					item = Sample(random, head, window, options, idx);
+					if (!item) return nullptr;
+
+					float accept = item->GetPriority() / TrainingDataItem::kMaxPriority;
+					if (std::uniform_real_distribution<float>(0.0f, 1.0f)(random) < accept) break;
+				}
+				return item;
 			}
 
 		private:
 			CircularArray<SharedPtrItem<TrainingDataItem>> data_;
+			std::unique_ptr<std::atomic<std::uint64_t>[]> sequences_; // (index + 1) of the item last published to each slot
 			std::atomic<size_t> size_;
 		};
 	}
-}
\ No newline at end of file
+}
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <assert.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+
+#include "neural_net/NeuralNetwork.h"
+#include "neural_net/PolicyNetwork.h"
+
+namespace alphazero
+{
+	namespace shared_data
+	{
+		// A fixed-size, trivially-copyable snapshot of all the fields seen by the neural network
+		// Used to store the replay compactly, and to send it between processes.
+		struct TrainingRecord
+		{
+			static constexpr std::uint32_t kMagic = 0x48535452; // "HSTR"
+			static constexpr std::uint16_t kVersion = 2;
+
+			static constexpr int kMaxMinions = 7;
+			static constexpr int kMaxHandCards = 10;
+
+			struct Minion {
+				std::int16_t hp;
+				std::int16_t max_hp;
+				std::int16_t attack;
+				std::uint8_t attackable;
+				std::uint8_t taunt;
+				std::uint8_t shield;
+				std::uint8_t stealth;
+			};
+
+			struct HandCard {
+				std::int16_t cost;
+				std::uint8_t playable;
+			};
+
+			struct Side {
+				std::int16_t resource_current;
+				std::int16_t resource_total;
+				std::int16_t resource_overload;
+				std::int16_t resource_overload_next;
+				std::int16_t hero_hp;
+				std::int16_t hero_armor;
+				std::uint8_t hero_power_playable;
+				std::uint8_t minion_count;
+				std::uint8_t hand_count;
+				Minion minions[kMaxMinions];
+				HandCard hand[kMaxHandCards];
+			};
+
+			Side sides[2]; // indexed by neural_net::FieldSide
+			std::int8_t label; // 1 if the current player wins; -1 otherwise
+			neural_net::MainOpPolicy policy; // the visit distribution of the search; empty if not recorded
+
+			static TrainingRecord Pack(
+				neural_net::IInputGetter const& input, int label,
+				neural_net::MainOpPolicy const& policy = neural_net::MainOpPolicy::Empty())
+			{
+				using neural_net::FieldSide;
+				using neural_net::FieldType;
+
+				TrainingRecord record;
+				std::memset(&record, 0, sizeof(record)); // also the paddings, so equal records are equal bytes
+				record.label = (std::int8_t)label;
+				record.policy.valid_mask = policy.valid_mask; // field by field, to keep the paddings zero
+				std::copy(std::begin(policy.probabilities), std::end(policy.probabilities), record.policy.probabilities);
+				for (auto field_side : { FieldSide::kCurrent, FieldSide::kOpponent }) {
+					auto get = [&](FieldType type, int arg1 = 0) { return input.GetField(field_side, type, arg1); };
+					Side & side = record.sides[(int)field_side];
+
+					side.resource_current = (std::int16_t)get(FieldType::kResourceCurrent);
+					side.resource_total = (std::int16_t)get(FieldType::kResourceTotal);
+					side.resource_overload = (std::int16_t)get(FieldType::kResourceOverload);
+					side.resource_overload_next = (std::int16_t)get(FieldType::kResourceOverloadNext);
+					side.hero_hp = (std::int16_t)get(FieldType::kHeroHP);
+					side.hero_armor = (std::int16_t)get(FieldType::kHeroArmor);
+					side.hero_power_playable = get(FieldType::kHeroPowerPlayable) != 0.0;
+
+					side.minion_count = (std::uint8_t)std::min((int)get(FieldType::kMinionCount), kMaxMinions);
+					for (int i = 0; i < side.minion_count; ++i) {
+						Minion & minion = side.minions[i];
+						minion.hp = (std::int16_t)get(FieldType::kMinionHP, i);
+						minion.max_hp = (std::int16_t)get(FieldType::kMinionMaxHP, i);
+						minion.attack = (std::int16_t)get(FieldType::kMinionAttack, i);
+						minion.attackable = get(FieldType::kMinionAttackable, i) != 0.0;
+						minion.taunt = get(FieldType::kMinionTaunt, i) != 0.0;
+						minion.shield = get(FieldType::kMinionShield, i) != 0.0;
+						minion.stealth = get(FieldType::kMinionStealth, i) != 0.0;
+					}
+
+					side.hand_count = (std::uint8_t)std::min((int)get(FieldType::kHandCount), kMaxHandCards);
+					if (field_side != FieldSide::kCurrent) continue; // only the count is known for the opponent
+					for (int i = 0; i < side.hand_count; ++i) {
+						side.hand[i].cost = (std::int16_t)get(FieldType::kHandCost, i);
+						side.hand[i].playable = get(FieldType::kHandPlayable, i) != 0.0;
+					}
+				}
+				return record;
+			}
+
+			// See neural_net::NeuralNetwork::GetInputFingerprint(); the label and the policy are not included
+			// E.g., records that differ only in which hand cards are playable (not in how many) have the same fingerprint.
+			std::uint64_t GetFingerprint() const;
+		};
+		static_assert(std::is_trivially_copyable<TrainingRecord>::value, "TrainingRecord is sent as raw bytes");
+
+		class TrainingRecordInputGetter : public neural_net::IInputGetter
+		{
+		public:
+			explicit TrainingRecordInputGetter(TrainingRecord const& record) : record_(record) {}
+
+			TrainingRecord const& GetRecord() const { return record_; }
+
+			double GetField(
+				neural_net::FieldSide field_side,
+				neural_net::FieldType field_type,
+				int arg1 = 0) const override final
+			{
+				using neural_net::FieldType;
+				assert(field_side == neural_net::FieldSide::kCurrent || field_side == neural_net::FieldSide::kOpponent);
+				auto const& side = record_.sides[(int)field_side];
+
+				switch (field_type) {
+				case FieldType::kResourceCurrent: return side.resource_current;
+				case FieldType::kResourceTotal: return side.resource_total;
+				case FieldType::kResourceOverload: return side.resource_overload;
+				case FieldType::kResourceOverloadNext: return side.resource_overload_next;
+				case FieldType::kHeroHP: return side.hero_hp;
+				case FieldType::kHeroArmor: return side.hero_armor;
+				case FieldType::kHeroPowerPlayable: return side.hero_power_playable;
+
+				case FieldType::kMinionCount: return side.minion_count;
+				case FieldType::kMinionHP: return GetMinion(side, arg1).hp;
+				case FieldType::kMinionMaxHP: return GetMinion(side, arg1).max_hp;
+				case FieldType::kMinionAttack: return GetMinion(side, arg1).attack;
+				case FieldType::kMinionAttackable: return GetMinion(side, arg1).attackable;
+				case FieldType::kMinionTaunt: return GetMinion(side, arg1).taunt;
+				case FieldType::kMinionShield: return GetMinion(side, arg1).shield;
+				case FieldType::kMinionStealth: return GetMinion(side, arg1).stealth;
+
+				case FieldType::kHandCount: return side.hand_count;
+				case FieldType::kHandPlayable: return GetHandCard(side, arg1).playable;
+				case FieldType::kHandCost: return GetHandCard(side, arg1).cost;
+
+				default:
+					throw std::runtime_error("Unknown field type");
+				}
+			}
+
+		private:
+			static TrainingRecord::Minion const& GetMinion(TrainingRecord::Side const& side, int idx) {
+				assert(idx >= 0 && idx < side.minion_count);
+				return side.minions[idx];
+			}
+			static TrainingRecord::HandCard const& GetHandCard(TrainingRecord::Side const& side, int idx) {
+				assert(idx >= 0 && idx < side.hand_count);
+				return side.hand[idx];
+			}
+
+		private:
+			TrainingRecord record_;
+		};
+
+		inline std::uint64_t TrainingRecord::GetFingerprint() const {
+			return neural_net::NeuralNetwork::GetInputFingerprint(TrainingRecordInputGetter(*this));
+		}
+	}
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "alphazero/shared_data/training_record.h"
+
+namespace alphazero
+{
+	namespace shared_data
+	{
+		// A packed dataset of games, loaded in one read instead of parsing the json game logs
+		// Layout:
+		//   Header
+		//   std::uint32_t records of each game [games]
+		//   TrainingRecord [records]
+		// Only readable on the same platform (byte order and struct layout) that wrote it.
+		class TrainingRecordFile
+		{
+		public:
+			using Game = std::vector<TrainingRecord>;
+
+			static bool Save(std::string const& path, std::vector<Game> const& games) {
+				Header header;
+				header.magic = TrainingRecord::kMagic;
+				header.version = TrainingRecord::kVersion;
+				header.record_size = (std::uint16_t)sizeof(TrainingRecord);
+				header.games = games.size();
+				header.records = 0;
+
+				std::vector<std::uint32_t> counts;
+				counts.reserve(games.size());
+				for (auto const& game : games) {
+					counts.push_back((std::uint32_t)game.size());
+					header.records += game.size();
+				}
+
+				std::ofstream fs(path, std::ofstream::binary | std::ofstream::trunc);
+				fs.write((char const*)&header, sizeof(header));
+				fs.write((char const*)counts.data(), counts.size() * sizeof(std::uint32_t));
+				for (auto const& game : games) {
+					fs.write((char const*)game.data(), game.size() * sizeof(TrainingRecord));
+				}
+				return (bool)fs;
+			}
+
+			// @return  false if the file is missing, or is written by an incompatible version
+			static bool Load(std::string const& path, std::vector<Game> & games) {
+				games.clear();
+
+				std::ifstream fs(path, std::ifstream::binary);
+				Header header;
+				if (!fs.read((char*)&header, sizeof(header))) return false;
+				if (header.magic != TrainingRecord::kMagic) return false;
+				if (header.version != TrainingRecord::kVersion) return false;
+				if (header.record_size != sizeof(TrainingRecord)) return false;
+
+				std::vector<std::uint32_t> counts(header.games);
+				if (!fs.read((char*)counts.data(), counts.size() * sizeof(std::uint32_t))) return false;
+
+				games.resize(counts.size());
+				for (size_t i = 0; i < counts.size(); ++i) {
+					games[i].resize(counts[i]);
+					if (!fs.read((char*)games[i].data(), counts[i] * sizeof(TrainingRecord))) {
+						games.clear();
+						return false;
+					}
+				}
+				return true;
+			}
+
+		private:
+			struct Header {
+				std::uint32_t magic;
+				std::uint16_t version;
+				std::uint16_t record_size;
+				std::uint64_t games;
+				std::uint64_t records;
+			};
+		};
+	}
+}
@@ -1,9 +1,16 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <sstream>
+#include <stdexcept>
 
-#include "alphazero/detail/thread_pool.h"
+#include "alphazero/detail/task_scheduler.h"
 #include "alphazero/shared_data/training_data.h"
+#include "alphazero/shared_data/record_socket.h"
+#include "alphazero/shared_data/net_publisher.h"
 #include "alphazero/optimizer/runner.h"
 #include "alphazero/self_play/runner.h"
 #include "alphazero/evaluation/runner.h"
@@ -15,9 +22,13 @@ namespace alphazero
 	struct TrainerConfigs {
 		TrainerConfigs() :
 			threads_(2),
+			thread_placement_(agents::ThreadPlacementPolicy::kNone),
+			background_self_play_(true),
 			best_net_path_(),
 			best_net_is_random_(false),
 			competitor_net_path_(),
+			remote_record_socket_(),
+			remote_net_dir_(),
 			kTrainingDataCapacityPowerOfTwo(10),
 			kMinimumTraningData(0),
 			self_play(),
@@ -27,12 +38,25 @@ namespace alphazero
 		{}
 
 		int threads_;
+		agents::ThreadPlacementPolicy thread_placement_;
+
+		// Fill the workers left idle by training and evaluation with self-play games
+		// E.g., the training runs as one task, and the last evaluation games leave the other workers idle.
+		// The cores used by the training (optimizer.threads) are reserved, so at most
+		// threads_ - optimizer.threads games are played in background while training.
+		bool background_self_play_;
 
 		std::string best_net_path_;
 		bool best_net_is_random_;
 
 		std::string competitor_net_path_;
 
+		// If set, self-play is done by separate processes (see GenerateTrainData --self-play-worker)
+		// The training records are collected from this Unix socket, and the best neural net is
+		// published to remote_net_dir_ whenever it changes.
+		std::string remote_record_socket_;
+		std::string remote_net_dir_;
+
 		size_t kTrainingDataCapacityPowerOfTwo;
 
 		// Need at least this number of training data to start training
@@ -43,12 +67,14 @@ namespace alphazero
 		evaluation::RunOptions evaluation;
 
 		// if new competitor's win rate larger than this one, use it to replace the best neural net so far
+		// Only used if the SPRT (see evaluation.sprt) is disabled, or is undecided after evaluation.runs games
 		float kEvaluationWinRate;
 	};
 
 	// Target to end-user devices. Eliminate context switch as much as possible.
-	// Don't rely on threads and OS scheduling.
-	// Not targeting for distributed environments.
+	// Don't rely on threads and OS scheduling: all phases run as tasks on one set of worker threads.
+	// Not targeting for distributed environments. Self-play can be moved to other processes on the
+	// same host, however; see TrainerConfigs::remote_record_socket_.
 	class EndDeviceTrainer {
 	private:
 		struct Schedule {
@@ -62,22 +88,29 @@ namespace alphazero
 			configs_(),
 			random_(random),
 			schedule_(),
-			threads_(),
+			scheduler_(),
+			phase_start_(),
 			training_data_(),
 			best_neural_net_(),
 			neural_net_(),
 			optimizer_(logger),
 			evaluators_(logger, random_),
-			self_players_(logger)
+			self_players_(logger),
+			record_collector_(),
+			net_publisher_()
 		{}
 
 		void Initialize(TrainerConfigs const& configs, std::mt19937 & random) {
 			configs_ = configs;
 
+			// The data-parallel training runs its shards beside the workers; size it against
+			// the workers, so it never competes with the background self-play for the cores.
+			configs_.optimizer.threads = std::max(1, std::min(configs_.optimizer.threads, configs_.threads_));
+
 			schedule_.self_play_milliseconds = 3000;
 			schedule_.train_epochs = 1000;
 
-			threads_.Initialize(configs_.threads_);
+			scheduler_.Initialize(configs_.threads_, configs_.thread_placement_);
 			training_data_.Initialize(configs.kTrainingDataCapacityPowerOfTwo);
 
 			best_neural_net_.Load(configs.best_net_path_, configs.best_net_is_random_);
@@ -86,10 +119,19 @@ namespace alphazero
 			optimizer_.Initialize();
 			evaluators_.Initialize(configs_.threads_);
 			self_players_.Initialize(configs_.threads_, training_data_, random, configs_.self_play);
+
+			if (IsRemoteSelfPlay()) {
+				if (!record_collector_.Open(configs_.remote_record_socket_)) {
+					throw std::runtime_error("Failed to open record socket: " + configs_.remote_record_socket_);
+				}
+				net_publisher_.Initialize(configs_.remote_net_dir_);
+				PublishBestNeuralNet();
+			}
 		}
 
 		void Release() {
-			threads_.Release();
+			record_collector_.Close();
+			scheduler_.Release();
 		}
 
 		void Train() {
@@ -153,60 +195,130 @@ namespace alphazero
 			logger_.Info() << "Generated " << result.generated_count_ << " records.";
 		}
 
-		self_play::RunResult InternalSelfPlay(detail::ThreadRunner::ConditionCallback condition) {
-			std::vector<detail::ThreadRunner*> threads;
-			size_t threads_use = threads_.Size();
-			for (size_t i = 0; i < threads_use; ++i) {
-				threads.push_back(&threads_.Get(i));
-			}
+		self_play::RunResult InternalSelfPlay(detail::TaskScheduler::ConditionCallback condition) {
+			if (IsRemoteSelfPlay()) return CollectRemoteSelfPlay(condition);
+
+			StartPhase();
+			detail::TaskGroup group;
 			self_players_.BeforeRun(
 				condition,
-				threads,
+				scheduler_,
+				group,
 				best_neural_net_);
 
-			for (auto thread : threads) thread->Wait();
+			group.Wait();
 
-			return self_players_.AfterRun();
+			auto result = self_players_.AfterRun();
+			LogWorkerStats("Self-play");
+			return result;
 		}
 
-		void TrainNeuralNetwork() {
-			logger_.Info() << "Start training neural network.";
+		// Run the tasks the phase submits to the group, and fill the idle workers with self-play games until
+		// they are done. The phase tasks are of higher priority, so a self-play game is only picked up when
+		// no phase task is queued; but a game already started is finished, which may delay the next phase.
+		// @param reserved_workers  Workers (cores) the phase uses besides its tasks; e.g., for the data-parallel
+		//                          training. Self-play plays at most (workers - reserved_workers) games at a time.
+		//                          The phase tasks and the self-play games share the workers, so together they
+		//                          never run more games than the workers.
+		template <class Phase>
+		void RunWithBackgroundSelfPlay(char const* name, size_t reserved_workers, Phase && phase) {
+			StartPhase();
+
+			size_t workers = scheduler_.GetWorkerCount();
+			size_t players = (workers > reserved_workers) ? (workers - reserved_workers) : 0;
+			bool self_play = configs_.background_self_play_ && !IsRemoteSelfPlay() && players > 0;
+			std::atomic<bool> done(false);
+			detail::TaskGroup self_play_group;
+			if (self_play) {
+				self_players_.BeforeRun(
+					[&done]() { return !done.load(); },
+					scheduler_,
+					self_play_group,
+					best_neural_net_,
+					players);
+			}
 
-			optimizer_.BeforeRun(
-				configs_.optimizer,
-				&threads_.Get(0),
-				best_neural_net_,
-				training_data_,
-				random_);
+			detail::TaskGroup group;
+			phase(group);
+			group.Wait();
 
-			threads_.Get(0).Wait();
+			done = true;
+			self_play_group.Wait();
+			if (self_play) {
+				auto result = self_players_.AfterRun();
+				logger_.Info() << "Generated " << result.generated_count_ << " records in background.";
+			}
+			LogWorkerStats(name);
+		}
 
-			optimizer_.AfterRun();
-			neural_net_.Save(configs_.competitor_net_path_);
-			logger_.Info() << "Saved trained neural net as competitor. "
-				<< "(path=" << configs_.competitor_net_path_ << ")";
+		void StartPhase() {
+			scheduler_.ResetStats();
+			phase_start_ = std::chrono::steady_clock::now();
+		}
+
+		void LogWorkerStats(char const* name) {
+			auto elapsed = std::chrono::steady_clock::now() - phase_start_;
+			if (elapsed.count() <= 0) return;
+
+			std::uint64_t tasks = 0;
+			std::uint64_t stolen = 0;
+			logger_.Info([&](auto& s) {
+				s << name << " workers busy:";
+				for (size_t i = 0; i < scheduler_.GetWorkerCount(); ++i) {
+					auto stats = scheduler_.GetWorkerStats(i);
+					s << " " << (int)(100.0 * stats.busy.count() / elapsed.count()) << "%";
+					if (stats.cpu >= 0) s << " (cpu " << stats.cpu << ")";
+					tasks += stats.tasks;
+					stolen += stats.stolen;
+				}
+				s << "; " << tasks << " tasks (" << stolen << " stolen).";
+			});
+		}
 
-			/*
-			// Utilize the rest threads to generate self-play data
-			std::vector<detail::ThreadRunner*> threads;
-			for (size_t i = 1; i < threads_.Size(); ++i) {
-				threads.push_back(&threads_.Get(i));
+		bool IsRemoteSelfPlay() const { return !configs_.remote_record_socket_.empty(); }
+
+		self_play::RunResult CollectRemoteSelfPlay(detail::TaskScheduler::ConditionCallback const& condition) {
+			self_play::RunResult result;
+			while (condition()) {
+				result.generated_count_ += (int)record_collector_.Receive(100, [&](shared_data::TrainingRecord const& record) {
+					training_data_.Push(std::make_shared<shared_data::TrainingDataItem>(record));
+				});
 			}
-			self_players_.BeforeRun(
-				schedule_.self_play_milliseconds,
-				threads,
-				best_neural_net_);
+			if (record_collector_.GetDropped() > 0) {
+				logger_.Info() << "Dropped " << record_collector_.GetDropped() << " malformed datagrams so far.";
+			}
+			return result;
+		}
+
+		void PublishBestNeuralNet() {
+			int version = net_publisher_.Publish(best_neural_net_);
+			logger_.Info() << "Published the best neural net to self-play workers. "
+				<< "(version=" << version << ")";
+		}
 
-			for (size_t i = 0; i < threads_.Size(); ++i) threads_.Get(i).Wait();
+		void TrainNeuralNetwork() {
+			logger_.Info() << "Start training neural network.";
+
+			// The training task runs on a worker, and the data-parallel training uses the cores of
+			// (optimizer.threads - 1) more workers
+			size_t training_workers = (size_t)std::max(1, configs_.optimizer.threads);
+
+			// train the competitor from the best net; the best net is only replaced if the competitor passes the evaluation
+			neural_net_.CopyFrom(best_neural_net_);
+			RunWithBackgroundSelfPlay("Training", training_workers, [this](detail::TaskGroup & group) {
+				optimizer_.BeforeRun(
+					configs_.optimizer,
+					scheduler_,
+					group,
+					neural_net_,
+					training_data_,
+					random_);
+			});
 
 			optimizer_.AfterRun();
 			neural_net_.Save(configs_.competitor_net_path_);
 			logger_.Info() << "Saved trained neural net as competitor. "
 				<< "(path=" << configs_.competitor_net_path_ << ")";
-
-			auto self_player_result = self_players_.AfterRun();
-			logger_.Info() << "Generated " << self_player_result.generated_count_ << " records.";
-			*/
 		}
 
 		void EvaluateNeuralNetwork() {
@@ -214,40 +326,126 @@ namespace alphazero
 
 			best_neural_net_.Save(configs_.best_net_path_);
 			neural_net_.Save(configs_.competitor_net_path_);
-			
-			evaluation::RunOptions options = configs_.evaluation;
 
-			std::vector<detail::ThreadRunner*> threads;
-			for (size_t i = 0; i < threads_.Size(); ++i) {
-				threads.push_back(&threads_.Get(i));
+			bool replace = false;
+			if (configs_.evaluation.screening.enabled && !PassOfflineCheck()) {
+				replace = false;
+			}
+			else if (configs_.evaluation.screening.enabled && !PassQuickGames()) {
+				replace = false;
+			}
+			else {
+				replace = PassFullGames();
 			}
-			evaluators_.BeforeRun(
-				options,
-				threads,
-				configs_.best_net_path_,
-				configs_.competitor_net_path_);
-
-			for (auto thread : threads) thread->Wait();
-
-			auto const& result = evaluators_.AfterRun();
 
-			int win_threshold = (int)(configs_.kEvaluationWinRate * result.GetTotal());
-			if (result.GetWin() > win_threshold) {
+			if (replace) {
 				logger_.Info() << "Replace the best neural network with the new competitor!";
 				best_neural_net_.CopyFrom(neural_net_);
+				if (IsRemoteSelfPlay()) PublishBestNeuralNet();
 			}
 			else {
 				logger_.Info() << "Competitor not strong enough. Continue to use the best neural network so far.";
 			}
 		}
 
+		// Tier 1: loss and accuracy on the records held out from training
+		bool PassOfflineCheck() {
+			auto start = std::chrono::steady_clock::now();
+			auto const& input = optimizer_.GetHoldoutInput();
+			auto const& output = optimizer_.GetHoldoutOutput();
+
+			auto best_accuracy = best_neural_net_.Verify(input, output);
+			auto competitor_accuracy = neural_net_.Verify(input, output);
+			if (competitor_accuracy.second == 0) {
+				logger_.Info() << "Offline check skipped: no held-out records.";
+				return true;
+			}
+
+			double best_loss = best_neural_net_.GetLoss(input, output);
+			double competitor_loss = neural_net_.GetLoss(input, output);
+			double best_rate = (double)best_accuracy.first / best_accuracy.second;
+			double competitor_rate = (double)competitor_accuracy.first / competitor_accuracy.second;
+
+			auto const& screening = configs_.evaluation.screening;
+			bool pass = (competitor_rate >= best_rate - screening.max_accuracy_drop) &&
+				(competitor_loss <= best_loss + screening.max_loss_increase);
+
+			auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+			logger_.Info([&](auto& s) {
+				s << "Offline check " << (pass ? "passed" : "failed")
+					<< " on " << competitor_accuracy.second << " records in " << ms << " ms: "
+					<< "accuracy " << competitor_rate << " (best: " << best_rate << "), "
+					<< "loss " << competitor_loss << " (best: " << best_loss << ").";
+			});
+			return pass;
+		}
+
+		// Tier 2: a few games between low-iteration agents
+		bool PassQuickGames() {
+			auto const& screening = configs_.evaluation.screening;
+			if (screening.runs <= 0) return true;
+
+			evaluation::RunOptions options = configs_.evaluation;
+			options.runs = screening.runs;
+			options.sprt.enabled = false;
+			options.agent_config = screening.agent_config;
+
+			auto start = std::chrono::steady_clock::now();
+			auto const& result = RunGames(options);
+			bool pass = (result.GetWin() >= screening.min_win_rate * result.GetTotal());
+
+			auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+			logger_.Info([&](auto& s) {
+				s << "Quick games " << (pass ? "passed" : "failed")
+					<< " in " << ms << " ms: competitor wins " << result.GetWin() << " / " << result.GetTotal() << ".";
+			});
+			return pass;
+		}
+
+		// Tier 3: full MCTS games
+		bool PassFullGames() {
+			auto start = std::chrono::steady_clock::now();
+			auto const& result = RunGames(configs_.evaluation);
+			auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+			logger_.Info([&](auto& s) {
+				s << "Full games finished in " << ms << " ms: competitor wins " << result.GetWin() << " / " << result.GetTotal() << ".";
+			});
+
+			switch (result.GetDecision()) {
+			case evaluation::SPRTDecision::kAccepted:
+				logger_.Info() << "SPRT accepted the competitor after " << result.GetTotal() << " games.";
+				return true;
+			case evaluation::SPRTDecision::kRejected:
+				logger_.Info() << "SPRT rejected the competitor after " << result.GetTotal() << " games.";
+				return false;
+			default:
+				// SPRT is disabled or undecided within the maximum games
+				return (result.GetWin() > (int)(configs_.kEvaluationWinRate * result.GetTotal()));
+			}
+		}
+
+		evaluation::CompetitionResult const& RunGames(evaluation::RunOptions const& options) {
+			// The evaluation games are the phase tasks; no other cores are used
+			RunWithBackgroundSelfPlay("Evaluation", 0, [&](detail::TaskGroup & group) {
+				evaluators_.BeforeRun(
+					options,
+					scheduler_,
+					group,
+					configs_.best_net_path_,
+					configs_.competitor_net_path_);
+			});
+
+			return evaluators_.AfterRun();
+		}
+
 	private:
 		ILogger & logger_;
 		TrainerConfigs configs_;
 		std::mt19937 & random_;
 
 		Schedule schedule_;
-		detail::ThreadPool threads_;
+		detail::TaskScheduler scheduler_;
+		std::chrono::steady_clock::time_point phase_start_;
 
 		shared_data::TrainingData training_data_;
 		neural_net::NeuralNetwork best_neural_net_;
@@ -256,5 +454,8 @@ namespace alphazero
 		optimizer::Runner optimizer_;
 		evaluation::Runner evaluators_;
 		self_play::Runner self_players_;
+
+		shared_data::RecordCollector record_collector_;
+		shared_data::NetPublisher net_publisher_;
 	};
 }
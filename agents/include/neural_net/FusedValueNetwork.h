@@ -0,0 +1,355 @@
+#pragma once
+
+#include <assert.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX512F__)
+#define NEURAL_NET_FUSED_AVX512
+#include <immintrin.h>
+#elif defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER))
+#define NEURAL_NET_FUSED_AVX2
+#include <immintrin.h>
+#endif
+
+#if defined(__AVX512BW__)
+#define NEURAL_NET_FUSED_INT8_AVX512
+#include <immintrin.h>
+#elif defined(__AVX2__)
+#define NEURAL_NET_FUSED_INT8_AVX2
+#include <immintrin.h>
+#endif
+
+namespace neural_net {
+	// A hand-written forward pass for the fixed value-network topology
+	// (see NeuralNetworkImpl::CreateWithRandomWeights()):
+	//   hero conv (1 -> 1) + leaky relu, over 2 heroes
+	//   minion conv (7 -> 3) + leaky relu, over 14 minion slots
+	//   concat with the standalone features
+	//   fully connected (61 -> 10) + leaky relu
+	//   fully connected (10 -> 1) + tanh
+	// The weights are kept in flat aligned arrays, laid out so that every layer is a sequence of
+	// broadcast-multiply-adds over 16 lanes. Evaluate() does no allocation.
+	// AVX-512 or AVX2 is used if the compiler targets it; otherwise a scalar fallback.
+	// In quantized mode, the first fully-connected layer (the bulk of the work) runs in int8:
+	// the weights are quantized per output with a static scale, and the input features are quantized
+	// per evaluation with a scale from their maximum magnitude. The other layers stay in float.
+	// Thread safety: Evaluate() is thread-safe
+	class FusedValueNetwork
+	{
+	public:
+		static constexpr int kHeroes = 2;
+		static constexpr int kMinionSlots = 14;
+		static constexpr int kMinionInDim = 7;
+		static constexpr int kMinionOutDim = 3;
+		static constexpr int kStandaloneDim = 17;
+		static constexpr int kHidden = 10;
+
+		static constexpr int kHeroInputSize = kHeroes;
+		static constexpr int kMinionInputSize = kMinionSlots * kMinionInDim;
+		static constexpr int kStandaloneInputSize = kStandaloneDim;
+		static constexpr int kConcatSize = kHeroes + kMinionSlots * kMinionOutDim + kStandaloneDim;
+
+		// The tiny_dnn weight layouts, as extracted from layer::weights()
+		//   conv: W[out_channel * window_size + x], b[out_channel]
+		//   fully connected: W[in * out_size + out], b[out]
+		struct Weights {
+			float const* hero_w; // 1
+			float const* hero_b; // 1
+			float const* minion_w; // kMinionOutDim * kMinionInDim
+			float const* minion_b; // kMinionOutDim
+			float const* fc1_w; // kConcatSize * kHidden
+			float const* fc1_b; // kHidden
+			float const* fc2_w; // kHidden
+			float const* fc2_b; // 1
+		};
+
+	private:
+		static constexpr int kLanes = 16;
+
+		// The padded feature layout fed to the first fully-connected layer
+		//   [minion channel 0: 16 lanes][channel 1: 16][channel 2: 16][heroes: 2, standalone: 17, zeros]
+		// Only the first 14 lanes of each minion channel are real; the rows for the other lanes
+		// are all zeros in fc1_w_.
+		static constexpr int kMinionFeatureOffset = 0;
+		static constexpr int kHeroFeatureOffset = kMinionOutDim * kLanes;
+		static constexpr int kStandaloneFeatureOffset = kHeroFeatureOffset + kHeroes;
+		static constexpr int kFeatures = (kStandaloneFeatureOffset + kStandaloneDim + kLanes - 1) / kLanes * kLanes;
+
+		static_assert(kFeatures % kLanes == 0, "the int8 kernel consumes the features 16 at a time");
+
+		static constexpr float kLeakyReluEpsilon = 0.01f; // tiny_dnn::activation::leaky_relu default
+
+	public:
+		FusedValueNetwork() :
+			loaded_(false), quantized_(false), hero_w_(0.0f), hero_b_(0.0f),
+			minion_w_(), minion_b_(), fc1_w_(), fc1_b_(), fc1_q_(), fc1_q_scale_(), fc2_w_(), fc2_b_(0.0f)
+		{}
+
+		bool IsLoaded() const { return loaded_; }
+		void Unload() { loaded_ = false; }
+
+		bool IsQuantized() const { return quantized_; }
+		void SetQuantized(bool quantized) { quantized_ = quantized; }
+
+		void Load(Weights const& weights) {
+			hero_w_ = weights.hero_w[0];
+			hero_b_ = weights.hero_b[0];
+
+			for (int o = 0; o < kMinionOutDim; ++o) {
+				for (int x = 0; x < kMinionInDim; ++x) {
+					minion_w_[o * kMinionInDim + x] = weights.minion_w[o * kMinionInDim + x];
+				}
+				minion_b_[o] = weights.minion_b[o];
+			}
+
+			fc1_w_.fill(0.0f);
+			fc1_b_.fill(0.0f);
+			for (int i = 0; i < kConcatSize; ++i) {
+				int row = GetFeatureIndex(i);
+				for (int o = 0; o < kHidden; ++o) {
+					fc1_w_[row * kLanes + o] = weights.fc1_w[i * kHidden + o];
+				}
+			}
+			for (int o = 0; o < kHidden; ++o) fc1_b_[o] = weights.fc1_b[o];
+			QuantizeFc1();
+
+			fc2_w_.fill(0.0f);
+			for (int o = 0; o < kHidden; ++o) fc2_w_[o] = weights.fc2_w[o];
+			fc2_b_ = weights.fc2_b[0];
+
+			loaded_ = true;
+		}
+
+		float Evaluate(float const* hero, float const* minions, float const* standalone) const {
+			assert(loaded_);
+
+			alignas(64) float features[kFeatures];
+			ComputeFeatures(hero, minions, standalone, features);
+
+			alignas(64) float hidden[kLanes];
+			if (quantized_) ComputeHiddenInt8(features, hidden);
+			else ComputeHidden(features, hidden);
+
+			float v = fc2_b_;
+			for (int o = 0; o < kHidden; ++o) v += hidden[o] * fc2_w_[o];
+			return std::tanh(v);
+		}
+
+		// Evaluate 'count' boards; the inputs of the boards are laid out one after another in each array
+		// @param results  results[i] is the value of the i-th board
+		void Evaluate(size_t count, float const* heroes, float const* minions, float const* standalones, float * results) const {
+			for (size_t i = 0; i < count; ++i) {
+				results[i] = Evaluate(
+					heroes + i * kHeroInputSize,
+					minions + i * kMinionInputSize,
+					standalones + i * kStandaloneInputSize);
+			}
+		}
+
+	private:
+		// Map an index of the tiny_dnn concat layer to the padded feature layout
+		static int GetFeatureIndex(int concat_idx) {
+			if (concat_idx < kHeroes) return kHeroFeatureOffset + concat_idx;
+			concat_idx -= kHeroes;
+			if (concat_idx < kMinionSlots * kMinionOutDim) {
+				int channel = concat_idx / kMinionSlots;
+				int slot = concat_idx % kMinionSlots;
+				return kMinionFeatureOffset + channel * kLanes + slot;
+			}
+			concat_idx -= kMinionSlots * kMinionOutDim;
+			return kStandaloneFeatureOffset + concat_idx;
+		}
+
+		static float LeakyRelu(float v) { return v > 0.0f ? v : kLeakyReluEpsilon * v; }
+
+		// Symmetric per-output quantization of fc1_w_
+		// fc1_q_ interleaves every two feature rows, so a pair of (feature, weight) products
+		// is one 16-bit multiply-add: fc1_q_[(row / 2 * kLanes + output) * 2 + row % 2]
+		void QuantizeFc1() {
+			for (int o = 0; o < kLanes; ++o) {
+				float max_abs = 0.0f;
+				for (int i = 0; i < kFeatures; ++i) max_abs = std::max(max_abs, std::abs(fc1_w_[i * kLanes + o]));
+				float scale = max_abs / 127.0f;
+				fc1_q_scale_[o] = scale;
+				for (int i = 0; i < kFeatures; ++i) {
+					float q = (scale > 0.0f) ? std::nearbyint(fc1_w_[i * kLanes + o] / scale) : 0.0f;
+					fc1_q_[(i / 2 * kLanes + o) * 2 + i % 2] = (std::int8_t)q;
+				}
+			}
+		}
+
+		void ComputeFeatures(float const* hero, float const* minions, float const* standalone, float * features) const {
+			// transpose the minions to [feature][slot], so the convolution runs over the slots
+			alignas(64) float transposed[kMinionInDim][kLanes];
+			for (int x = 0; x < kMinionInDim; ++x) {
+				for (int s = 0; s < kMinionSlots; ++s) transposed[x][s] = minions[s * kMinionInDim + x];
+				for (int s = kMinionSlots; s < kLanes; ++s) transposed[x][s] = 0.0f;
+			}
+
+			for (int o = 0; o < kMinionOutDim; ++o) {
+				float * out = features + kMinionFeatureOffset + o * kLanes;
+				float const* w = &minion_w_[o * kMinionInDim];
+#if defined(NEURAL_NET_FUSED_AVX512)
+				__m512 acc = _mm512_set1_ps(minion_b_[o]);
+				for (int x = 0; x < kMinionInDim; ++x) {
+					acc = _mm512_fmadd_ps(_mm512_set1_ps(w[x]), _mm512_load_ps(transposed[x]), acc);
+				}
+				__m512 leaky = _mm512_mul_ps(acc, _mm512_set1_ps(kLeakyReluEpsilon));
+				_mm512_store_ps(out, _mm512_max_ps(acc, leaky));
+#elif defined(NEURAL_NET_FUSED_AVX2)
+				for (int h = 0; h < kLanes; h += 8) {
+					__m256 acc = _mm256_set1_ps(minion_b_[o]);
+					for (int x = 0; x < kMinionInDim; ++x) {
+						acc = _mm256_fmadd_ps(_mm256_set1_ps(w[x]), _mm256_load_ps(transposed[x] + h), acc);
+					}
+					__m256 leaky = _mm256_mul_ps(acc, _mm256_set1_ps(kLeakyReluEpsilon));
+					_mm256_store_ps(out + h, _mm256_max_ps(acc, leaky));
+				}
+#else
+				for (int s = 0; s < kLanes; ++s) {
+					float acc = minion_b_[o];
+					for (int x = 0; x < kMinionInDim; ++x) acc += w[x] * transposed[x][s];
+					out[s] = LeakyRelu(acc);
+				}
+#endif
+				for (int s = kMinionSlots; s < kLanes; ++s) out[s] = 0.0f;
+			}
+
+			for (int i = 0; i < kHeroes; ++i) {
+				features[kHeroFeatureOffset + i] = LeakyRelu(hero_w_ * hero[i] + hero_b_);
+			}
+			for (int i = 0; i < kStandaloneDim; ++i) {
+				features[kStandaloneFeatureOffset + i] = standalone[i];
+			}
+			for (int i = kStandaloneFeatureOffset + kStandaloneDim; i < kFeatures; ++i) {
+				features[i] = 0.0f;
+			}
+		}
+
+		void ComputeHidden(float const* features, float * hidden) const {
+#if defined(NEURAL_NET_FUSED_AVX512)
+			__m512 acc = _mm512_load_ps(fc1_b_.data());
+			for (int i = 0; i < kFeatures; ++i) {
+				acc = _mm512_fmadd_ps(_mm512_set1_ps(features[i]), _mm512_load_ps(&fc1_w_[i * kLanes]), acc);
+			}
+			__m512 leaky = _mm512_mul_ps(acc, _mm512_set1_ps(kLeakyReluEpsilon));
+			_mm512_store_ps(hidden, _mm512_max_ps(acc, leaky));
+#elif defined(NEURAL_NET_FUSED_AVX2)
+			__m256 acc0 = _mm256_load_ps(fc1_b_.data());
+			__m256 acc1 = _mm256_load_ps(fc1_b_.data() + 8);
+			for (int i = 0; i < kFeatures; ++i) {
+				__m256 f = _mm256_set1_ps(features[i]);
+				acc0 = _mm256_fmadd_ps(f, _mm256_load_ps(&fc1_w_[i * kLanes]), acc0);
+				acc1 = _mm256_fmadd_ps(f, _mm256_load_ps(&fc1_w_[i * kLanes + 8]), acc1);
+			}
+			__m256 epsilon = _mm256_set1_ps(kLeakyReluEpsilon);
+			_mm256_store_ps(hidden, _mm256_max_ps(acc0, _mm256_mul_ps(acc0, epsilon)));
+			_mm256_store_ps(hidden + 8, _mm256_max_ps(acc1, _mm256_mul_ps(acc1, epsilon)));
+#else
+			for (int o = 0; o < kLanes; ++o) hidden[o] = fc1_b_[o];
+			for (int i = 0; i < kFeatures; ++i) {
+				float f = features[i];
+				float const* w = &fc1_w_[i * kLanes];
+				for (int o = 0; o < kLanes; ++o) hidden[o] += f * w[o];
+			}
+			for (int o = 0; o < kLanes; ++o) hidden[o] = LeakyRelu(hidden[o]);
+#endif
+		}
+
+		// Quantize the features to [-127, 127]
+		// @return  The scale to dequantize
+		static float QuantizeFeatures(float const* features, std::int16_t * quantized) {
+#if defined(NEURAL_NET_FUSED_INT8_AVX512) || defined(NEURAL_NET_FUSED_INT8_AVX2)
+			__m256 const sign = _mm256_set1_ps(-0.0f);
+			__m256 max_abs = _mm256_setzero_ps();
+			for (int i = 0; i < kFeatures; i += 8) {
+				max_abs = _mm256_max_ps(max_abs, _mm256_andnot_ps(sign, _mm256_load_ps(features + i)));
+			}
+			alignas(32) float lanes[8];
+			_mm256_store_ps(lanes, max_abs);
+			float scale = *std::max_element(lanes, lanes + 8) / 127.0f;
+			__m256 inv_scale = _mm256_set1_ps((scale > 0.0f) ? (1.0f / scale) : 0.0f);
+			for (int i = 0; i < kFeatures; i += 16) {
+				__m256i lo = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_load_ps(features + i), inv_scale));
+				__m256i hi = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_load_ps(features + i + 8), inv_scale));
+				// packs works within the 128-bit lanes; restore the element order
+				__m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), 0xD8);
+				_mm256_store_si256((__m256i*)(quantized + i), packed);
+			}
+			return scale;
+#else
+			float max_abs = 0.0f;
+			for (int i = 0; i < kFeatures; ++i) max_abs = std::max(max_abs, std::abs(features[i]));
+			float scale = max_abs / 127.0f;
+			float inv_scale = (scale > 0.0f) ? (1.0f / scale) : 0.0f;
+			for (int i = 0; i < kFeatures; ++i) {
+				quantized[i] = (std::int16_t)std::lrint(features[i] * inv_scale);
+			}
+			return scale;
+#endif
+		}
+
+		void ComputeHiddenInt8(float const* features, float * hidden) const {
+			alignas(64) std::int16_t quantized[kFeatures];
+			float scale = QuantizeFeatures(features, quantized);
+
+			alignas(64) std::int32_t acc[kLanes];
+#if defined(NEURAL_NET_FUSED_INT8_AVX512)
+			__m512i sum = _mm512_setzero_si512();
+			for (int p = 0; p < kFeatures / 2; ++p) {
+				std::int32_t pair;
+				std::memcpy(&pair, quantized + p * 2, sizeof(pair));
+				__m512i w = _mm512_cvtepi8_epi16(_mm256_load_si256((__m256i const*)&fc1_q_[p * kLanes * 2]));
+				sum = _mm512_add_epi32(sum, _mm512_madd_epi16(_mm512_set1_epi32(pair), w));
+			}
+			_mm512_store_si512((__m512i*)acc, sum);
+#elif defined(NEURAL_NET_FUSED_INT8_AVX2)
+			__m256i sum0 = _mm256_setzero_si256();
+			__m256i sum1 = _mm256_setzero_si256();
+			for (int p = 0; p < kFeatures / 2; ++p) {
+				std::int32_t pair;
+				std::memcpy(&pair, quantized + p * 2, sizeof(pair));
+				__m256i x = _mm256_set1_epi32(pair);
+				std::int8_t const* w = &fc1_q_[p * kLanes * 2];
+				__m256i w0 = _mm256_cvtepi8_epi16(_mm_load_si128((__m128i const*)w));
+				__m256i w1 = _mm256_cvtepi8_epi16(_mm_load_si128((__m128i const*)(w + 16)));
+				sum0 = _mm256_add_epi32(sum0, _mm256_madd_epi16(x, w0));
+				sum1 = _mm256_add_epi32(sum1, _mm256_madd_epi16(x, w1));
+			}
+			_mm256_store_si256((__m256i*)acc, sum0);
+			_mm256_store_si256((__m256i*)(acc + 8), sum1);
+#else
+			for (int o = 0; o < kLanes; ++o) acc[o] = 0;
+			for (int p = 0; p < kFeatures / 2; ++p) {
+				std::int8_t const* w = &fc1_q_[p * kLanes * 2];
+				for (int o = 0; o < kLanes; ++o) {
+					acc[o] += quantized[p * 2] * w[o * 2] + quantized[p * 2 + 1] * w[o * 2 + 1];
+				}
+			}
+#endif
+			for (int o = 0; o < kLanes; ++o) {
+				hidden[o] = LeakyRelu((float)acc[o] * scale * fc1_q_scale_[o] + fc1_b_[o]);
+			}
+		}
+
+	private:
+		bool loaded_;
+		bool quantized_;
+
+		float hero_w_;
+		float hero_b_;
+		std::array<float, kMinionOutDim * kMinionInDim> minion_w_;
+		std::array<float, kMinionOutDim> minion_b_;
+		alignas(64) std::array<float, kFeatures * kLanes> fc1_w_;
+		alignas(64) std::array<float, kLanes> fc1_b_;
+		alignas(64) std::array<std::int8_t, kFeatures * kLanes> fc1_q_;
+		alignas(64) std::array<float, kLanes> fc1_q_scale_;
+		alignas(64) std::array<float, kLanes> fc2_w_;
+		float fc2_b_;
+	};
+}
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
+#include <random>
 #include "state/State.h"
 
 namespace neural_net {
@@ -10,6 +12,8 @@ namespace neural_net {
 		class NeuralNetworkOutputImpl;
 	}
 
+	class PolicyNetwork;
+
 	enum class FieldSide {
 		kCurrent,
 		kOpponent,
@@ -37,6 +41,26 @@ namespace neural_net {
 		kInvalidType
 	};
 
+	enum class InferencePrecision {
+		kFloat,
+		kInt8 // the first fully-connected layer runs in int8; see FusedValueNetwork
+	};
+
+	// The accuracy of a quantized network, compared to the same network in float
+	struct QuantizationReport {
+		QuantizationReport() :
+			available(false), total(0), float_correct(0), quantized_correct(0),
+			mean_abs_error(0.0), max_abs_error(0.0)
+		{}
+
+		bool available; // false if the network cannot be quantized (e.g., a random network)
+		uint64_t total;
+		uint64_t float_correct; // predicted the label correctly in float
+		uint64_t quantized_correct; // predicted the label correctly when quantized
+		double mean_abs_error; // of the predicted values, versus float
+		double max_abs_error;
+	};
+
 	class IInputGetter {
 	public:
 		virtual ~IInputGetter() {}
@@ -96,26 +120,68 @@ namespace neural_net {
 	public:
 		static void CreateWithRandomWeights(std::string const& path);
 
+		// A hash of the encoded input of the value network
+		// Inputs the network cannot tell apart have the same fingerprint.
+		static std::uint64_t GetInputFingerprint(IInputGetter const& input);
+
 		void Save(std::string const& path) const;
 		void Load(std::string const& path, bool is_random = false);
 
 		bool IsRandom() const;
 
+		// Kept across Load()
+		void SetPrecision(InferencePrecision precision);
+		InferencePrecision GetPrecision() const;
+
+		// Also copies the policy network
 		void CopyFrom(NeuralNetwork const& rhs);
 
+		// The policy network is saved and loaded with the value network, at PolicyNetwork::GetPath(path)
+		// It is untrained if that file is missing.
+		PolicyNetwork & GetPolicy();
+		PolicyNetwork const& GetPolicy() const;
+
 		void Train(
 			NeuralNetworkInput const& input,
 			NeuralNetworkOutput const& output,
 			size_t batch_size, int epoch);
 
+		// Data-parallel training in 'threads' threads
+		// Each thread trains a replica on a shard of the data; the replicas are synchronized
+		// by averaging the parameters every 'epoch_per_sync' epochs.
+		void Train(
+			NeuralNetworkInput const& input,
+			NeuralNetworkOutput const& output,
+			size_t batch_size, int epoch, int threads, int epoch_per_sync);
+
 		// @return tuple of (correct, total)
 		std::pair<uint64_t, uint64_t> Verify(
 			NeuralNetworkInput const& input,
 			NeuralNetworkOutput const& output);
 
+		// @return Mean squared error of the predictions
+		double GetLoss(
+			NeuralNetworkInput const& input,
+			NeuralNetworkOutput const& output);
+
+		// Compare the predictions under 'precision' with the ones in float
+		QuantizationReport MeasureQuantization(
+			NeuralNetworkInput const& input,
+			NeuralNetworkOutput const& output,
+			InferencePrecision precision);
+
 		double Predict(IInputGetter * input, std::mt19937 & random);
 		void Predict(impl::NeuralNetworkInputImpl const& input, std::vector<double> & results, std::mt19937 & random);
 
+		// Predict all the data in 'input' in one forward pass
+		// @param results  results[i] is the prediction of the i-th data
+		void Predict(NeuralNetworkInput const& input, std::vector<double> & results, std::mt19937 & random);
+
+		// Predict 'count' inputs in one call, without building the tiny_dnn tensors if the fused kernel
+		// is loaded; so no allocation on that path
+		// @param results  results[i] is the prediction of inputs[i]
+		void Predict(IInputGetter const* const* inputs, size_t count, double * results, std::mt19937 & random);
+
 	private:
 		impl::NeuralNetworkImpl * impl_;
 	};
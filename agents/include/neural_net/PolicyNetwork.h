@@ -0,0 +1,350 @@
+#pragma once
+
+#include <assert.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "engine/MainOp.h"
+#include "neural_net/NeuralNetwork.h"
+
+namespace neural_net {
+	static constexpr int kMainOps = engine::kMainOpMax;
+
+	// A distribution over the main-action types (engine::MainOpType)
+	// Plain data, so it can be embedded in a trivially-copyable training record.
+	struct MainOpPolicy {
+		std::uint8_t valid_mask; // bit i is set if main op i is available; zero if there is no policy
+		float probabilities[kMainOps]; // zero for the unavailable ops; sums to one otherwise
+
+		static MainOpPolicy Empty() {
+			MainOpPolicy policy;
+			policy.valid_mask = 0;
+			std::fill(std::begin(policy.probabilities), std::end(policy.probabilities), 0.0f);
+			return policy;
+		}
+
+		// @param visits  visits[i] is the visit count of main op i; negative if the op is not available
+		// @return  An empty policy if no op is visited
+		static MainOpPolicy FromVisits(std::array<std::int64_t, kMainOps> const& visits) {
+			MainOpPolicy policy = Empty();
+			std::int64_t total = 0;
+			for (int i = 0; i < kMainOps; ++i) {
+				if (visits[i] < 0) continue;
+				policy.valid_mask |= (std::uint8_t)(1 << i);
+				total += visits[i];
+			}
+			if (total <= 0) return Empty();
+			for (int i = 0; i < kMainOps; ++i) {
+				if (visits[i] > 0) policy.probabilities[i] = (float)((double)visits[i] / total);
+			}
+			return policy;
+		}
+
+		bool IsEmpty() const { return valid_mask == 0; }
+		bool IsValid(int op) const { return (valid_mask & (1 << op)) != 0; }
+
+		// @return  The most probable op; -1 if empty
+		int GetBest() const {
+			int best = -1;
+			for (int i = 0; i < kMainOps; ++i) {
+				if (!IsValid(i)) continue;
+				if (best < 0 || probabilities[i] > probabilities[best]) best = i;
+			}
+			return best;
+		}
+	};
+
+	// The accuracy of a policy network on some records with visit distributions
+	struct PolicyReport {
+		PolicyReport() : total(0), correct(0), cross_entropy(0.0) {}
+
+		uint64_t total;
+		uint64_t correct; // the predicted best op is the most visited op
+		double cross_entropy; // mean, against the visit distributions
+	};
+
+	// The policy head: predicts the visit distribution of the search over the main-action types
+	// A small two-layer net over a few summary features of the board:
+	//   features (kFeatures) -> fully connected (kHidden) + tanh -> fully connected (kMainOps) -> masked softmax
+	// It is kept beside the value network (in the file GetPath(value network path)) instead of as a
+	// second output of it, so the value network and its fused kernel are unchanged.
+	// An untrained network gives the uniform distribution over the valid ops.
+	// Thread safety: Predict() and Evaluate() are thread-safe; Train() and Load() are not.
+	class PolicyNetwork
+	{
+	public:
+		static constexpr int kFeatures = 17;
+		static constexpr int kHidden = 16;
+
+	private:
+		static constexpr int kFileVersion = 1;
+
+		using Features = std::array<float, kFeatures>;
+		using Hidden = std::array<float, kHidden>;
+		using Logits = std::array<float, kMainOps>;
+
+	public:
+		PolicyNetwork() : trained_(false), w1_(), b1_(), w2_(), b2_() {}
+
+		static std::string GetPath(std::string const& value_network_path) {
+			return value_network_path + ".policy";
+		}
+
+		bool IsTrained() const { return trained_; }
+
+		// Forget the trained weights; predict the uniform distribution again
+		void Reset() {
+			trained_ = false;
+			w1_.fill(0.0f);
+			b1_.fill(0.0f);
+			w2_.fill(0.0f);
+			b2_.fill(0.0f);
+		}
+
+		// @param valid_mask  See MainOpPolicy::valid_mask
+		MainOpPolicy Predict(IInputGetter const& input, std::uint8_t valid_mask) const {
+			MainOpPolicy policy = MainOpPolicy::Empty();
+			policy.valid_mask = valid_mask;
+			if (valid_mask == 0) return policy;
+
+			Logits logits;
+			if (trained_) {
+				Hidden hidden;
+				Forward(GetFeatures(input), hidden, logits);
+			}
+			else {
+				logits.fill(0.0f);
+			}
+			Softmax(logits, valid_mask, policy.probabilities);
+			return policy;
+		}
+
+		// Minimize the cross entropy to the visit distributions by SGD, one record at a time
+		// @param targets  targets[i] is the visit distribution of inputs[i]; empty targets are skipped
+		void Train(
+			std::vector<IInputGetter const*> const& inputs,
+			std::vector<MainOpPolicy> const& targets,
+			int epoch, float learning_rate, std::mt19937 & random)
+		{
+			assert(inputs.size() == targets.size());
+			if (!trained_) InitializeWeights(random);
+
+			std::vector<std::pair<Features, MainOpPolicy const*>> samples;
+			for (size_t i = 0; i < inputs.size(); ++i) {
+				if (targets[i].IsEmpty()) continue;
+				samples.emplace_back(GetFeatures(*inputs[i]), &targets[i]);
+			}
+
+			for (int e = 0; e < epoch; ++e) {
+				std::shuffle(samples.begin(), samples.end(), random);
+				for (auto const& sample : samples) {
+					Step(sample.first, *sample.second, learning_rate);
+				}
+			}
+		}
+
+		PolicyReport Evaluate(
+			std::vector<IInputGetter const*> const& inputs,
+			std::vector<MainOpPolicy> const& targets) const
+		{
+			assert(inputs.size() == targets.size());
+			PolicyReport report;
+			for (size_t i = 0; i < inputs.size(); ++i) {
+				auto const& target = targets[i];
+				if (target.IsEmpty()) continue;
+
+				auto predicted = Predict(*inputs[i], target.valid_mask);
+				++report.total;
+				if (predicted.GetBest() == target.GetBest()) ++report.correct;
+				for (int op = 0; op < kMainOps; ++op) {
+					if (target.probabilities[op] <= 0.0f) continue;
+					float p = std::max(predicted.probabilities[op], std::numeric_limits<float>::min());
+					report.cross_entropy -= target.probabilities[op] * std::log(p);
+				}
+			}
+			if (report.total > 0) report.cross_entropy /= report.total;
+			return report;
+		}
+
+		void Save(std::string const& path) const {
+			std::ofstream fs(path, std::ofstream::trunc);
+			fs.precision(std::numeric_limits<float>::max_digits10);
+			fs << "policy " << kFileVersion << " " << kFeatures << " " << kHidden << " " << kMainOps << "\n";
+			fs << trained_ << "\n";
+			auto write = [&](auto const& values) {
+				for (auto v : values) fs << v << " ";
+				fs << "\n";
+			};
+			write(w1_);
+			write(b1_);
+			write(w2_);
+			write(b2_);
+		}
+
+		// @return  false if the file is missing or incompatible; the network is reset then
+		bool Load(std::string const& path) {
+			Reset();
+
+			std::ifstream fs(path);
+			std::string tag;
+			int version = 0, features = 0, hidden = 0, outputs = 0;
+			if (!(fs >> tag >> version >> features >> hidden >> outputs)) return false;
+			if (tag != "policy" || version != kFileVersion) return false;
+			if (features != kFeatures || hidden != kHidden || outputs != kMainOps) return false;
+
+			bool trained = false;
+			if (!(fs >> trained)) return false;
+			auto read = [&](auto & values) {
+				for (auto & v : values) {
+					if (!(fs >> v)) return false;
+				}
+				return true;
+			};
+			if (!read(w1_) || !read(b1_) || !read(w2_) || !read(b2_)) {
+				Reset();
+				return false;
+			}
+			trained_ = trained;
+			return true;
+		}
+
+	private:
+		// Roughly normalized to [0, 1]
+		static Features GetFeatures(IInputGetter const& input) {
+			auto get = [&](FieldSide side, FieldType type, int arg1 = 0) {
+				return (float)input.GetField(side, type, arg1);
+			};
+			constexpr auto kCurrent = FieldSide::kCurrent;
+			constexpr auto kOpponent = FieldSide::kOpponent;
+
+			int hand_count = (int)get(kCurrent, FieldType::kHandCount);
+			float playable = 0.0f;
+			float cheapest_playable = 0.0f;
+			for (int i = 0; i < hand_count; ++i) {
+				if (get(kCurrent, FieldType::kHandPlayable, i) == 0.0f) continue;
+				float cost = get(kCurrent, FieldType::kHandCost, i);
+				if (playable == 0.0f || cost < cheapest_playable) cheapest_playable = cost;
+				playable += 1.0f;
+			}
+
+			int minion_count = (int)get(kCurrent, FieldType::kMinionCount);
+			float attackable = 0.0f;
+			float attackable_attack = 0.0f;
+			for (int i = 0; i < minion_count; ++i) {
+				if (get(kCurrent, FieldType::kMinionAttackable, i) == 0.0f) continue;
+				attackable += 1.0f;
+				attackable_attack += get(kCurrent, FieldType::kMinionAttack, i);
+			}
+
+			int opponent_minion_count = (int)get(kOpponent, FieldType::kMinionCount);
+			float opponent_taunts = 0.0f;
+			float opponent_minion_hp = 0.0f;
+			for (int i = 0; i < opponent_minion_count; ++i) {
+				if (get(kOpponent, FieldType::kMinionTaunt, i) != 0.0f) opponent_taunts += 1.0f;
+				opponent_minion_hp += get(kOpponent, FieldType::kMinionHP, i);
+			}
+
+			return Features{
+				1.0f, // bias
+				get(kCurrent, FieldType::kResourceCurrent) / 10.0f,
+				get(kCurrent, FieldType::kResourceTotal) / 10.0f,
+				get(kCurrent, FieldType::kResourceOverloadNext) / 10.0f,
+				hand_count / 10.0f,
+				playable / 10.0f,
+				cheapest_playable / 10.0f,
+				get(kCurrent, FieldType::kHeroPowerPlayable),
+				minion_count / 7.0f,
+				attackable / 7.0f,
+				attackable_attack / 20.0f,
+				opponent_minion_count / 7.0f,
+				opponent_taunts / 7.0f,
+				opponent_minion_hp / 30.0f,
+				(get(kCurrent, FieldType::kHeroHP) + get(kCurrent, FieldType::kHeroArmor)) / 30.0f,
+				(get(kOpponent, FieldType::kHeroHP) + get(kOpponent, FieldType::kHeroArmor)) / 30.0f,
+				get(kOpponent, FieldType::kHandCount) / 10.0f
+			};
+		}
+
+		void Forward(Features const& features, Hidden & hidden, Logits & logits) const {
+			for (int h = 0; h < kHidden; ++h) {
+				float v = b1_[h];
+				for (int f = 0; f < kFeatures; ++f) v += w1_[h * kFeatures + f] * features[f];
+				hidden[h] = std::tanh(v);
+			}
+			for (int o = 0; o < kMainOps; ++o) {
+				float v = b2_[o];
+				for (int h = 0; h < kHidden; ++h) v += w2_[o * kHidden + h] * hidden[h];
+				logits[o] = v;
+			}
+		}
+
+		static void Softmax(Logits const& logits, std::uint8_t valid_mask, float (&probabilities)[kMainOps]) {
+			float max_logit = -std::numeric_limits<float>::infinity();
+			for (int o = 0; o < kMainOps; ++o) {
+				if (valid_mask & (1 << o)) max_logit = std::max(max_logit, logits[o]);
+			}
+			float total = 0.0f;
+			for (int o = 0; o < kMainOps; ++o) {
+				probabilities[o] = (valid_mask & (1 << o)) ? std::exp(logits[o] - max_logit) : 0.0f;
+				total += probabilities[o];
+			}
+			for (int o = 0; o < kMainOps; ++o) probabilities[o] /= total;
+		}
+
+		void Step(Features const& features, MainOpPolicy const& target, float learning_rate) {
+			Hidden hidden;
+			Logits logits;
+			Forward(features, hidden, logits);
+
+			float probabilities[kMainOps];
+			Softmax(logits, target.valid_mask, probabilities);
+
+			// d(cross entropy)/d(logit) = p - t, over the valid ops
+			Logits d_logits;
+			for (int o = 0; o < kMainOps; ++o) {
+				d_logits[o] = target.IsValid(o) ? (probabilities[o] - target.probabilities[o]) : 0.0f;
+			}
+
+			Hidden d_hidden;
+			d_hidden.fill(0.0f);
+			for (int o = 0; o < kMainOps; ++o) {
+				if (d_logits[o] == 0.0f) continue;
+				for (int h = 0; h < kHidden; ++h) {
+					d_hidden[h] += w2_[o * kHidden + h] * d_logits[o];
+					w2_[o * kHidden + h] -= learning_rate * d_logits[o] * hidden[h];
+				}
+				b2_[o] -= learning_rate * d_logits[o];
+			}
+
+			for (int h = 0; h < kHidden; ++h) {
+				float d = d_hidden[h] * (1.0f - hidden[h] * hidden[h]);
+				for (int f = 0; f < kFeatures; ++f) w1_[h * kFeatures + f] -= learning_rate * d * features[f];
+				b1_[h] -= learning_rate * d;
+			}
+		}
+
+		void InitializeWeights(std::mt19937 & random) {
+			Reset();
+			// Xavier; the output layer starts at zero, so the first prediction is uniform
+			float scale = std::sqrt(6.0f / (kFeatures + kHidden));
+			std::uniform_real_distribution<float> dist(-scale, scale);
+			for (auto & w : w1_) w = dist(random);
+			trained_ = true;
+		}
+
+	private:
+		bool trained_;
+		std::array<float, kHidden * kFeatures> w1_; // w1_[h * kFeatures + f]
+		std::array<float, kHidden> b1_;
+		std::array<float, kMainOps * kHidden> w2_; // w2_[o * kHidden + h]
+		std::array<float, kMainOps> b2_;
+	};
+}
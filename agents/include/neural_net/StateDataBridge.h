@@ -0,0 +1,202 @@
+#pragma once
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#include "state/State.h"
+#include "engine/FlowControl/ActionTargetIndex.h"
+#include "engine/FlowControl/ValidActionGetter.h"
+#include "neural_net/NeuralNetwork.h"
+
+namespace neural_net {
+	// Reads the fields of a state from the view of its current player
+	// Shared by the value network (for the state values in simulation) and the policy network (for the priors in selection).
+	class StateDataBridge : public IInputGetter
+	{
+	public:
+		StateDataBridge() : state_(nullptr), attackable_indices_(),
+			playable_cards_(), hero_power_playable_()
+		{}
+
+		StateDataBridge(StateDataBridge const&) = delete;
+		StateDataBridge & operator=(StateDataBridge const&) = delete;
+
+		void Reset(state::State const& state) {
+			state_ = &state;
+
+			engine::FlowControl::ValidActionGetter valid_action(*state_);
+
+			attackable_indices_.clear();
+			valid_action.ForEachAttacker([this](int encoded_idx) {
+				attackable_indices_.push_back(encoded_idx);
+				return true;
+			});
+
+			playable_cards_.clear();
+			valid_action.ForEachPlayableCard([&](size_t idx) {
+				playable_cards_.push_back((int)idx);
+				return true;
+			});
+
+			hero_power_playable_ = valid_action.CanUseHeroPower();
+		}
+
+		double GetField(
+			FieldSide field_side,
+			FieldType field_type,
+			int arg1 = 0) const override final
+		{
+			if (field_side == FieldSide::kCurrent) {
+				return GetSideField(field_type, arg1, state_->GetCurrentPlayer());
+			}
+			else if (field_side == FieldSide::kOpponent) {
+				return GetSideField(field_type, arg1, state_->GetOppositePlayer());
+			}
+			throw std::runtime_error("invalid side");
+		}
+
+	private:
+		double GetSideField(FieldType field_type, int arg1, state::board::Player const& player) const {
+			switch (field_type) {
+			case FieldType::kResourceCurrent:
+			case FieldType::kResourceTotal:
+			case FieldType::kResourceOverload:
+			case FieldType::kResourceOverloadNext:
+				return GetResourceField(field_type, arg1, player.GetResource());
+
+			case FieldType::kHeroHP:
+			case FieldType::kHeroArmor:
+				return GetHeroField(field_type, arg1, state_->GetCard(player.GetHeroRef()));
+
+			case FieldType::kMinionCount:
+			case FieldType::kMinionHP:
+			case FieldType::kMinionMaxHP:
+			case FieldType::kMinionAttack:
+			case FieldType::kMinionAttackable:
+			case FieldType::kMinionTaunt:
+			case FieldType::kMinionShield:
+			case FieldType::kMinionStealth:
+				return GetMinionsField(field_type, arg1, player.minions_);
+
+			case FieldType::kHandCount:
+			case FieldType::kHandPlayable:
+			case FieldType::kHandCost:
+				return GetHandField(field_type, arg1, player.hand_);
+
+			case FieldType::kHeroPowerPlayable:
+				return GetHeroPowerField(field_type, arg1);
+
+			default:
+				throw std::runtime_error("unknown field type");
+			}
+		}
+
+		double GetResourceField(FieldType field_type, int arg1, state::board::PlayerResource const& resource) const {
+			switch (field_type) {
+			case FieldType::kResourceCurrent:
+				return resource.GetCurrent();
+			case FieldType::kResourceTotal:
+				return resource.GetTotal();
+			case FieldType::kResourceOverload:
+				return resource.GetCurrentOverloaded();
+			case FieldType::kResourceOverloadNext:
+				return resource.GetNextOverload();
+			default:
+				throw std::runtime_error("unknown field type");
+			}
+		}
+
+		double GetHeroField(FieldType field_type, int arg1, state::Cards::Card const& hero) const {
+			switch (field_type) {
+			case FieldType::kHeroHP:
+				return hero.GetHP();
+			case FieldType::kHeroArmor:
+				return hero.GetArmor();
+			default:
+				throw std::runtime_error("unknown field type");
+			}
+		}
+
+		double GetMinionsField(FieldType field_type, int minion_idx, state::board::Minions const& minions) const {
+			switch (field_type) {
+			case FieldType::kMinionCount:
+				return (double)minions.Size();
+			case FieldType::kMinionHP:
+			case FieldType::kMinionMaxHP:
+			case FieldType::kMinionAttack:
+			case FieldType::kMinionAttackable:
+			case FieldType::kMinionTaunt:
+			case FieldType::kMinionShield:
+			case FieldType::kMinionStealth:
+				return GetMinionField(field_type, minion_idx, state_->GetCard(minions.Get(minion_idx)));
+			default:
+				throw std::runtime_error("unknown field type");
+			}
+		}
+
+		double GetMinionField(FieldType field_type, int minion_idx, state::Cards::Card const& minion) const {
+			switch (field_type) {
+			case FieldType::kMinionHP:
+				return minion.GetHP();
+			case FieldType::kMinionMaxHP:
+				return minion.GetMaxHP();
+			case FieldType::kMinionAttack:
+				return minion.GetAttack();
+			case FieldType::kMinionAttackable:
+				for (auto target_index : attackable_indices_) {
+					if (engine::FlowControl::ActionTargetIndex::ParseMinionIndex(target_index) == minion_idx) {
+						return true;
+					}
+				}
+				return false;
+			case FieldType::kMinionTaunt:
+				return minion.HasTaunt();
+			case FieldType::kMinionShield:
+				return minion.HasShield();
+			case FieldType::kMinionStealth:
+				return minion.HasStealth();
+			default:
+				throw std::runtime_error("unknown field type");
+			}
+		}
+
+		double GetHandField(FieldType field_type, int hand_idx, state::board::Hand const& hand) const {
+			switch (field_type) {
+			case FieldType::kHandCount:
+				return (double)hand.Size();
+			case FieldType::kHandPlayable:
+			case FieldType::kHandCost:
+				return GetHandCardField(field_type, hand_idx, state_->GetCard(hand.Get(hand_idx)));
+			default:
+				throw std::runtime_error("unknown field type");
+			}
+		}
+
+		double GetHandCardField(FieldType field_type, int hand_idx, state::Cards::Card const& card) const {
+			switch (field_type) {
+			case FieldType::kHandPlayable:
+				return (std::find(playable_cards_.begin(), playable_cards_.end(), hand_idx) != playable_cards_.end());
+			case FieldType::kHandCost:
+				return card.GetCost();
+			default:
+				throw std::runtime_error("unknown field type");
+			}
+		}
+
+		double GetHeroPowerField(FieldType field_type, int arg1) const {
+			switch (field_type) {
+			case FieldType::kHeroPowerPlayable:
+				return hero_power_playable_;
+			default:
+				throw std::runtime_error("unknown field type");
+			}
+		}
+
+	private:
+		state::State const* state_;
+		std::vector<int> attackable_indices_;
+		std::vector<int> playable_cards_;
+		bool hero_power_playable_;
+	};
+}
@@ -22,9 +22,20 @@
 #pragma warning (pop)
 #endif
 
+#include <assert.h>
+#include <algorithm>
 #include <cstdio>
+#include <cstdint>
+#include <cmath>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include "neural_net/NeuralNetwork.h"
+#include "neural_net/FusedValueNetwork.h"
+#include "neural_net/PolicyNetwork.h"
 
 namespace neural_net {
 	namespace impl {
@@ -50,42 +61,51 @@ namespace neural_net {
 		{
 		public:
 			void Convert(IInputGetter const* getter, tiny_dnn::tensor_t & data) {
-				GetInputData(getter, data);
+				using Fused = FusedValueNetwork;
+				float hero[Fused::kHeroInputSize];
+				float minions[Fused::kMinionInputSize];
+				float standalone[Fused::kStandaloneInputSize];
+				Convert(getter, hero, minions, standalone);
+
+				data.emplace_back(std::begin(hero), std::end(hero));
+				data.emplace_back(std::begin(minions), std::end(minions));
+				data.emplace_back(std::begin(standalone), std::end(standalone));
 			}
 
-		private:
-			void GetInputData(IInputGetter const* getter, tiny_dnn::tensor_t & data) {
-				tiny_dnn::vec_t input1;
-				AddHeroData(FieldSide::kCurrent, getter, input1);
-				AddHeroData(FieldSide::kOpponent, getter, input1);
-				data.push_back(std::move(input1));
-
-				tiny_dnn::vec_t input2;
-				AddMinionsData(FieldSide::kCurrent, getter, input2);
-				AddMinionsData(FieldSide::kOpponent, getter, input2);
-				data.push_back(std::move(input2));
-
-				tiny_dnn::vec_t input3;
-				AddStandAloneData(getter, input3);
-				data.push_back(std::move(input3));
+			// Fill the inputs of the fused kernel; no allocation
+			void Convert(IInputGetter const* getter, float * hero, float * minions, float * standalone) {
+				float * hero_end = hero;
+				AddHeroData(FieldSide::kCurrent, getter, hero_end);
+				AddHeroData(FieldSide::kOpponent, getter, hero_end);
+				assert(hero_end == hero + FusedValueNetwork::kHeroInputSize);
+
+				float * minions_end = minions;
+				AddMinionsData(FieldSide::kCurrent, getter, minions_end);
+				AddMinionsData(FieldSide::kOpponent, getter, minions_end);
+				assert(minions_end == minions + FusedValueNetwork::kMinionInputSize);
+
+				float * standalone_end = standalone;
+				AddStandAloneData(getter, standalone_end);
+				assert(standalone_end == standalone + FusedValueNetwork::kStandaloneInputSize);
 			}
 
+		private:
 			void AddHeroData(
 				FieldSide side,
 				IInputGetter const* getter,
-				tiny_dnn::vec_t & data)
+				float *& data)
 			{
 				double hp = getter->GetField(side, FieldType::kHeroHP) +
 					getter->GetField(side, FieldType::kHeroArmor);
-				data.push_back(NormalizeFromUniformDist(hp, 0.0, 30.0));
-				//data.push_back(player["attack"].asFloat());
-				//data.push_back(player["attackable"].asBool());
+				*data++ = NormalizeFromUniformDist(hp, 0.0, 30.0);
+				//*data++ = player["attack"].asFloat();
+				//*data++ = player["attackable"].asBool();
 			}
 
 			void AddMinionsData(
 				FieldSide side,
 				IInputGetter const* getter,
-				tiny_dnn::vec_t & data)
+				float *& data)
 			{
 				int rest = 7;
 				for (int i = 0; i < (int)getter->GetField(side, FieldType::kMinionCount); ++i) {
@@ -103,40 +123,41 @@ namespace neural_net {
 				FieldSide side,
 				IInputGetter const* getter,
 				int minion_idx,
-				tiny_dnn::vec_t & data)
+				float *& data)
 			{
-				data.push_back(NormalizeFromUniformDist(getter->GetField(side, FieldType::kMinionHP, minion_idx), 1.0, 7.0));
-				data.push_back(NormalizeFromUniformDist(getter->GetField(side, FieldType::kMinionMaxHP, minion_idx), 1.0, 7.0));
-				data.push_back(NormalizeFromUniformDist(getter->GetField(side, FieldType::kMinionAttack, minion_idx), 0.0, 7.0));
-				data.push_back(NormalizeBool(getter->GetField(side, FieldType::kMinionAttackable, minion_idx)));
-				data.push_back(NormalizeBool(getter->GetField(side, FieldType::kMinionTaunt, minion_idx)));
-				data.push_back(NormalizeBool(getter->GetField(side, FieldType::kMinionShield, minion_idx)));
-				data.push_back(NormalizeBool(getter->GetField(side, FieldType::kMinionStealth, minion_idx)));
+				*data++ = NormalizeFromUniformDist(getter->GetField(side, FieldType::kMinionHP, minion_idx), 1.0, 7.0);
+				*data++ = NormalizeFromUniformDist(getter->GetField(side, FieldType::kMinionMaxHP, minion_idx), 1.0, 7.0);
+				*data++ = NormalizeFromUniformDist(getter->GetField(side, FieldType::kMinionAttack, minion_idx), 0.0, 7.0);
+				*data++ = NormalizeBool(getter->GetField(side, FieldType::kMinionAttackable, minion_idx));
+				*data++ = NormalizeBool(getter->GetField(side, FieldType::kMinionTaunt, minion_idx));
+				*data++ = NormalizeBool(getter->GetField(side, FieldType::kMinionShield, minion_idx));
+				*data++ = NormalizeBool(getter->GetField(side, FieldType::kMinionStealth, minion_idx));
 			}
 
-			void AddMinionPlaceHolderData(tiny_dnn::vec_t & data) {
-				data.push_back(0.0);
-				data.push_back(0.0);
-				data.push_back(0.0);
-				data.push_back(NormalizeBool(false));
-				data.push_back(NormalizeBool(false));
-				data.push_back(NormalizeBool(false));
-				data.push_back(NormalizeBool(false));
+			void AddMinionPlaceHolderData(float *& data) {
+				*data++ = 0.0;
+				*data++ = 0.0;
+				*data++ = 0.0;
+				*data++ = NormalizeBool(false);
+				*data++ = NormalizeBool(false);
+				*data++ = NormalizeBool(false);
+				*data++ = NormalizeBool(false);
 			}
 
 			void AddStandAloneData(
 				IInputGetter const* getter,
-				tiny_dnn::vec_t & data)
+				float *& data)
 			{
-				data.push_back(NormalizeFromUniformDist(getter->GetField(
-					FieldSide::kCurrent, FieldType::kResourceCurrent), 0, 10));
-				data.push_back(NormalizeFromUniformDist(getter->GetField(
-					FieldSide::kCurrent, FieldType::kResourceTotal), 0, 10));
-				data.push_back(NormalizeFromUniformDist(getter->GetField(
-					FieldSide::kCurrent, FieldType::kResourceOverloadNext), 0, 10));
+				*data++ = NormalizeFromUniformDist(getter->GetField(
+					FieldSide::kCurrent, FieldType::kResourceCurrent), 0, 10);
+				*data++ = NormalizeFromUniformDist(getter->GetField(
+					FieldSide::kCurrent, FieldType::kResourceTotal), 0, 10);
+				*data++ = NormalizeFromUniformDist(getter->GetField(
+					FieldSide::kCurrent, FieldType::kResourceOverloadNext), 0, 10);
 
 				int cur_hand_count = (int)getter->GetField(FieldSide::kCurrent, FieldType::kHandCount);
-				data.push_back(NormalizeFromUniformDist(cur_hand_count, 0, 10));
+				if (cur_hand_count > 10) throw std::runtime_error("too many hand cards");
+				*data++ = NormalizeFromUniformDist(cur_hand_count, 0, 10);
 
 				int cur_hand_playable = 0;
 				for (int i = 0; i < cur_hand_count; ++i) {
@@ -145,27 +166,27 @@ namespace neural_net {
 						++cur_hand_playable;
 					}
 				}
-				data.push_back(NormalizeFromUniformDist(cur_hand_playable, 0, 10));
+				*data++ = NormalizeFromUniformDist(cur_hand_playable, 0, 10);
 
 				int hand_cards = 0;
 				for (int i = 0; i < cur_hand_count; ++i) {
-					data.push_back(NormalizeFromUniformDist(
-						getter->GetField(FieldSide::kCurrent, FieldType::kHandCost, i), 0, 10));
+					*data++ = NormalizeFromUniformDist(
+						getter->GetField(FieldSide::kCurrent, FieldType::kHandCost, i), 0, 10);
 					++hand_cards;
 				}
 				while (hand_cards < 10) {
-					data.push_back(NormalizeFromUniformDist(-1, 0, 10));
+					*data++ = NormalizeFromUniformDist(-1, 0, 10);
 					++hand_cards;
 				}
 
 				int opn_hand_count = (int)getter->GetField(FieldSide::kOpponent, FieldType::kHandCount);
-				data.push_back(NormalizeFromUniformDist(opn_hand_count, 0, 10));
+				*data++ = NormalizeFromUniformDist(opn_hand_count, 0, 10);
 
-				data.push_back(NormalizeBool(
-					getter->GetField(FieldSide::kCurrent, FieldType::kHeroPowerPlayable)));
+				*data++ = NormalizeBool(
+					getter->GetField(FieldSide::kCurrent, FieldType::kHeroPowerPlayable));
 			}
 
-			tiny_dnn::float_t NormalizeFromUniformDist(double v, double min, double max) {
+			float NormalizeFromUniformDist(double v, double min, double max) {
 				// normalize to mean = 0, var = 1.0
 				// uniform dist is with variance = (max-min)^2 / 12
 				// --> so we should have (max-min)^2 / 12 = 1.0
@@ -178,15 +199,15 @@ namespace neural_net {
 				double scale = sqrt_12 / range;
 
 				double ret = (v - mean) * scale;
-				return (tiny_dnn::float_t)ret;
+				return (float)ret;
 			}
 
-			tiny_dnn::float_t NormalizeBool(bool v) {
+			float NormalizeBool(bool v) {
 				double vv = 0.0;
 				if (v) vv = 1.0;
 				else vv = -1.0;
 				double ret = NormalizeFromUniformDist(vv, -1.0, 1.0);
-				return (tiny_dnn::float_t)ret;
+				return (float)ret;
 			}
 		};
 
@@ -273,21 +294,34 @@ namespace neural_net {
 				net.init_weight();
 
 				net.save(filename);
+				PolicyNetwork().Save(PolicyNetwork::GetPath(filename));
 			}
 
 			void Load(std::string const& filename, bool is_random) {
 				net_.load(filename);
 				random_net_ = is_random;
+				LoadFused();
+				policy_.Load(PolicyNetwork::GetPath(filename)); // untrained if missing
 			}
 
 			bool IsRandom() const { return random_net_; }
 
+			// Only the fused kernel can be quantized; tiny_dnn is used in float otherwise
+			void SetPrecision(InferencePrecision precision) {
+				precision_ = precision;
+				fused_.SetQuantized(precision_ == InferencePrecision::kInt8);
+			}
+			InferencePrecision GetPrecision() const { return precision_; }
+
 			void CopyFrom(NeuralNetworkImpl const& rhs) {
 				std::string tmpfile = std::tmpnam(nullptr);
 				rhs.net_.save(tmpfile);
 				net_.load(tmpfile);
 				random_net_ = rhs.random_net_;
+				precision_ = rhs.precision_;
 				std::remove(tmpfile.c_str());
+				LoadFused();
+				policy_ = rhs.policy_;
 			}
 
 			void Train(
@@ -297,12 +331,68 @@ namespace neural_net {
 			{
 				tiny_dnn::adam opt;
 				net_.fit<tiny_dnn::mse>(opt, input.GetData(), output.GetData(), batch_size, epoch, []() {}, []() {});
+				LoadFused();
+			}
+
+			// Data-parallel training
+			// The data is split into 'threads' shards, and each shard trains a replica of this network
+			// in its own thread. Every 'epoch_per_sync' epochs, the replicas are synchronized by
+			// averaging their parameters. The threads are started once, and kept over the rounds.
+			void Train(
+				impl::NeuralNetworkInputImpl const& input,
+				impl::NeuralNetworkOutputImpl const& output,
+				size_t batch_size, int epoch, int threads, int epoch_per_sync)
+			{
+				auto const& input_data = input.GetData();
+				auto const& output_data = output.GetData();
+				assert(input_data.size() == output_data.size());
+
+				// every shard needs at least one batch
+				size_t shards = std::min((size_t)std::max(threads, 1), input_data.size() / std::max(batch_size, (size_t)1));
+				if (shards <= 1) return Train(input, output, batch_size, epoch);
+				if (epoch_per_sync <= 0) epoch_per_sync = epoch;
+
+				std::vector<std::vector<tiny_dnn::tensor_t>> shard_inputs(shards);
+				std::vector<std::vector<tiny_dnn::vec_t>> shard_outputs(shards);
+				for (size_t i = 0; i < input_data.size(); ++i) {
+					shard_inputs[i % shards].push_back(input_data[i]);
+					shard_outputs[i % shards].push_back(output_data[i]);
+				}
+
+				// replica 0 is this network
+				std::vector<std::unique_ptr<NeuralNetworkImpl>> others;
+				std::vector<NeuralNetworkImpl *> replicas{ this };
+				for (size_t i = 1; i < shards; ++i) {
+					others.emplace_back(new NeuralNetworkImpl());
+					others.back()->CopyFrom(*this);
+					replicas.push_back(others.back().get());
+				}
+
+				std::vector<tiny_dnn::adam> optimizers(shards);
+				auto parameters = GetParameters(replicas);
+				Barrier barrier(shards);
+				RunInParallel(shards, [&](size_t idx) {
+					for (int trained = 0; trained < epoch; trained += epoch_per_sync) {
+						int round_epoch = std::min(epoch_per_sync, epoch - trained);
+						replicas[idx]->net_.fit<tiny_dnn::mse>(optimizers[idx],
+							shard_inputs[idx], shard_outputs[idx], batch_size, round_epoch, []() {}, []() {});
+
+						barrier.Wait(); // all replicas trained
+						AverageParameters(parameters, idx, shards);
+						barrier.Wait(); // all parameters averaged, before the next round reads them
+					}
+				});
+				LoadFused();
 			}
 
 			void Save(std::string const& name) const {
 				net_.save(name);
+				policy_.Save(PolicyNetwork::GetPath(name));
 			}
 
+			PolicyNetwork & GetPolicy() { return policy_; }
+			PolicyNetwork const& GetPolicy() const { return policy_; }
+
 			std::pair<uint64_t, uint64_t> Verify(
 				impl::NeuralNetworkInputImpl const& input,
 				impl::NeuralNetworkOutputImpl const& output)
@@ -324,31 +414,309 @@ namespace neural_net {
 				return { correct, total };
 			}
 
+			double GetLoss(
+				impl::NeuralNetworkInputImpl const& input,
+				impl::NeuralNetworkOutputImpl const& output)
+			{
+				auto const& output_data = output.GetData();
+				if (output_data.empty()) return 0.0;
+
+				std::mt19937 random(0); // only used by a random net
+				std::vector<double> results;
+				Predict(input, results, random);
+				assert(results.size() == output_data.size());
+
+				double sum = 0.0;
+				for (size_t idx = 0; idx < results.size(); ++idx) {
+					double diff = results[idx] - output_data[idx][0];
+					sum += diff * diff;
+				}
+				return sum / results.size();
+			}
+
+			QuantizationReport MeasureQuantization(
+				impl::NeuralNetworkInputImpl const& input,
+				impl::NeuralNetworkOutputImpl const& output,
+				InferencePrecision precision)
+			{
+				QuantizationReport report;
+				if (random_net_ || !fused_.IsLoaded()) return report;
+
+				FusedValueNetwork reference = fused_;
+				reference.SetQuantized(false);
+				FusedValueNetwork quantized = fused_;
+				quantized.SetQuantized(precision == InferencePrecision::kInt8);
+
+				auto const& input_data = input.GetData();
+				auto const& output_data = output.GetData();
+				assert(input_data.size() == output_data.size());
+
+				double error_sum = 0.0;
+				for (size_t idx = 0; idx < input_data.size(); ++idx) {
+					double expected = EvaluateFused(reference, input_data[idx]);
+					double actual = EvaluateFused(quantized, input_data[idx]);
+					bool actual_win = (output_data[idx][0] > 0.0);
+
+					double error = std::abs(expected - actual);
+					error_sum += error;
+					report.max_abs_error = std::max(report.max_abs_error, error);
+					if ((expected > 0.0) == actual_win) ++report.float_correct;
+					if ((actual > 0.0) == actual_win) ++report.quantized_correct;
+					++report.total;
+				}
+				if (report.total > 0) report.mean_abs_error = error_sum / report.total;
+				report.available = true;
+				return report;
+			}
+
 			void Predict(impl::NeuralNetworkInputImpl const& input, std::vector<double> & results, std::mt19937 & random) {
 				auto const& input_data = input.GetData();
 				results.clear();
 				results.reserve(input_data.size());
-				for (size_t idx = 0; idx < input_data.size(); ++idx) {
-					results.push_back(Predict(input_data[0], random));
+
+				if (random_net_) {
+					for (size_t idx = 0; idx < input_data.size(); ++idx) {
+						results.push_back(std::uniform_real_distribution<double>(-1.0, 1.0)(random));
+					}
+					return;
+				}
+
+				if (fused_.IsLoaded()) {
+					for (auto const& data : input_data) {
+						results.push_back(EvaluateFused(data));
+					}
+					return;
+				}
+
+				if (input_data.empty()) return;
+				auto outputs = net_.predict(input_data);
+				assert(outputs.size() == input_data.size());
+				for (auto const& output : outputs) {
+					results.push_back(output[0][0]);
 				}
 			}
 
 			double Predict(IInputGetter * input, std::mt19937 & random) {
-				tiny_dnn::tensor_t data;
-				impl::InputDataConverter().Convert(input, data);
-				return Predict(data, random);
+				double result = 0.0;
+				IInputGetter const* inputs[] = { input };
+				Predict(inputs, 1, &result, random);
+				return result;
 			}
 
-			double Predict(tiny_dnn::tensor_t const& data, std::mt19937 & random) {
+			// The inputs are converted straight to the fused kernel, in chunks on the stack; no allocation
+			// Falls back to tiny_dnn if the fused kernel is not loaded.
+			void Predict(IInputGetter const* const* inputs, size_t count, double * results, std::mt19937 & random) {
+				using Fused = FusedValueNetwork;
+
 				if (random_net_) {
-					return std::uniform_real_distribution<double>(-1.0, 1.0)(random);
+					for (size_t idx = 0; idx < count; ++idx) {
+						results[idx] = std::uniform_real_distribution<double>(-1.0, 1.0)(random);
+					}
+					return;
+				}
+
+				if (!fused_.IsLoaded()) {
+					for (size_t idx = 0; idx < count; ++idx) {
+						tiny_dnn::tensor_t data;
+						impl::InputDataConverter().Convert(inputs[idx], data);
+						results[idx] = net_.predict(data)[0][0];
+					}
+					return;
+				}
+
+				constexpr size_t kChunk = 16;
+				alignas(64) float hero[kChunk * Fused::kHeroInputSize];
+				alignas(64) float minions[kChunk * Fused::kMinionInputSize];
+				alignas(64) float standalone[kChunk * Fused::kStandaloneInputSize];
+				float chunk_results[kChunk];
+				for (size_t start = 0; start < count; start += kChunk) {
+					size_t size = std::min(kChunk, count - start);
+					for (size_t i = 0; i < size; ++i) {
+						impl::InputDataConverter().Convert(inputs[start + i],
+							hero + i * Fused::kHeroInputSize,
+							minions + i * Fused::kMinionInputSize,
+							standalone + i * Fused::kStandaloneInputSize);
+					}
+					fused_.Evaluate(size, hero, minions, standalone, chunk_results);
+					for (size_t i = 0; i < size; ++i) results[start + i] = chunk_results[i];
+				}
+			}
+
+		private:
+			// Extract the weights to the fused kernel, and check it against tiny_dnn
+			// The fused kernel is disabled if the network does not have the expected topology.
+			void LoadFused() {
+				fused_.Unload();
+				if (random_net_) return;
+
+				using Fused = FusedValueNetwork;
+				std::vector<float> hero_w, hero_b, minion_w, minion_b, fc1_w, fc1_b, fc2_w, fc2_b;
+				for (size_t i = 0; i < net_.layer_size(); ++i) {
+					auto * layer = net_[i];
+					auto type = layer->layer_type();
+					if (type != "conv" && type != "fully-connected") continue;
+
+					auto weights = layer->weights();
+					if (weights.size() != 2) return;
+					auto in_size = layer->in_shape()[0].size();
+					auto out_size = layer->out_shape()[0].size();
+
+					if (type == "conv" && in_size == Fused::kHeroInputSize && out_size == Fused::kHeroes) {
+						CopyWeights(*weights[0], 1, hero_w);
+						CopyWeights(*weights[1], 1, hero_b);
+					}
+					else if (type == "conv" && in_size == Fused::kMinionInputSize && out_size == Fused::kMinionSlots * Fused::kMinionOutDim) {
+						CopyWeights(*weights[0], Fused::kMinionOutDim * Fused::kMinionInDim, minion_w);
+						CopyWeights(*weights[1], Fused::kMinionOutDim, minion_b);
+					}
+					else if (type == "fully-connected" && in_size == Fused::kConcatSize && out_size == Fused::kHidden) {
+						CopyWeights(*weights[0], Fused::kConcatSize * Fused::kHidden, fc1_w);
+						CopyWeights(*weights[1], Fused::kHidden, fc1_b);
+					}
+					else if (type == "fully-connected" && in_size == Fused::kHidden && out_size == 1) {
+						CopyWeights(*weights[0], Fused::kHidden, fc2_w);
+						CopyWeights(*weights[1], 1, fc2_b);
+					}
+					else return;
+				}
+				for (auto const* v : { &hero_w, &hero_b, &minion_w, &minion_b, &fc1_w, &fc1_b, &fc2_w, &fc2_b }) {
+					if (v->empty()) return;
+				}
+
+				fused_.Load(Fused::Weights{
+					hero_w.data(), hero_b.data(), minion_w.data(), minion_b.data(),
+					fc1_w.data(), fc1_b.data(), fc2_w.data(), fc2_b.data() });
+				fused_.SetQuantized(false);
+				if (!ValidateFused()) {
+					fused_.Unload();
+					return;
+				}
+				fused_.SetQuantized(precision_ == InferencePrecision::kInt8);
+			}
+
+			static void CopyWeights(tiny_dnn::vec_t const& from, size_t expected_size, std::vector<float> & to) {
+				to.clear();
+				if (from.size() != expected_size) return;
+				for (auto v : from) to.push_back((float)v);
+			}
+
+			// Compare the fused kernel with tiny_dnn on some random inputs
+			bool ValidateFused() {
+				constexpr int kSamples = 16;
+				constexpr double kTolerance = 1e-4;
+
+				std::mt19937 random(0);
+				std::normal_distribution<float> dist(0.0f, 1.0f);
+				for (int i = 0; i < kSamples; ++i) {
+					tiny_dnn::tensor_t data(3);
+					data[0].resize(FusedValueNetwork::kHeroInputSize);
+					data[1].resize(FusedValueNetwork::kMinionInputSize);
+					data[2].resize(FusedValueNetwork::kStandaloneInputSize);
+					for (auto & vec : data) {
+						for (auto & v : vec) v = dist(random);
+					}
+					double expected = net_.predict(data)[0][0];
+					double actual = EvaluateFused(data);
+					if (std::abs(expected - actual) > kTolerance) return false;
+				}
+				return true;
+			}
+
+			double EvaluateFused(tiny_dnn::tensor_t const& data) const {
+				return EvaluateFused(fused_, data);
+			}
+
+			static double EvaluateFused(FusedValueNetwork const& fused, tiny_dnn::tensor_t const& data) {
+				using Fused = FusedValueNetwork;
+				assert(data.size() == 3);
+				assert(data[0].size() == Fused::kHeroInputSize);
+				assert(data[1].size() == Fused::kMinionInputSize);
+				assert(data[2].size() == Fused::kStandaloneInputSize);
+
+				float hero[Fused::kHeroInputSize];
+				float minions[Fused::kMinionInputSize];
+				float standalone[Fused::kStandaloneInputSize];
+				std::copy(data[0].begin(), data[0].end(), hero);
+				std::copy(data[1].begin(), data[1].end(), minions);
+				std::copy(data[2].begin(), data[2].end(), standalone);
+				return fused.Evaluate(hero, minions, standalone);
+			}
+
+			template <class Functor>
+			static void RunInParallel(size_t threads, Functor && functor) {
+				std::vector<std::thread> workers;
+				for (size_t i = 1; i < threads; ++i) {
+					workers.emplace_back([&functor, i]() { functor(i); });
+				}
+				functor(0);
+				for (auto & worker : workers) worker.join();
+			}
+
+			// Blocks the threads until all of them arrive; reusable
+			class Barrier
+			{
+			public:
+				explicit Barrier(size_t threads) : threads_(threads), arrived_(0), generation_(0), mutex_(), cv_() {}
+
+				void Wait() {
+					std::unique_lock<std::mutex> lock(mutex_);
+					auto generation = generation_;
+					if (++arrived_ == threads_) {
+						arrived_ = 0;
+						++generation_;
+						cv_.notify_all();
+						return;
+					}
+					cv_.wait(lock, [&]() { return generation_ != generation; });
+				}
+
+			private:
+				size_t threads_;
+				size_t arrived_;
+				std::uint64_t generation_;
+				std::mutex mutex_;
+				std::condition_variable cv_;
+			};
+
+			// parameters[r][k] is the k-th parameter vector of replicas[r]
+			static std::vector<std::vector<tiny_dnn::vec_t *>> GetParameters(std::vector<NeuralNetworkImpl *> const& replicas) {
+				std::vector<std::vector<tiny_dnn::vec_t *>> parameters;
+				for (auto * replica : replicas) {
+					parameters.emplace_back();
+					for (size_t i = 0; i < replica->net_.layer_size(); ++i) {
+						for (auto * weights : replica->net_[i]->weights()) {
+							parameters.back().push_back(weights);
+						}
+					}
+					assert(parameters.back().size() == parameters.front().size());
+				}
+				return parameters;
+			}
+
+			// Average the parameters of all the replicas, and write the result back to all of them
+			// Thread 'idx' of 'threads' reduces a disjoint set of the parameter vectors, so no locking is needed.
+			static void AverageParameters(std::vector<std::vector<tiny_dnn::vec_t *>> const& parameters, size_t idx, size_t threads) {
+				auto const scale = (tiny_dnn::float_t)1.0 / (tiny_dnn::float_t)parameters.size();
+				for (size_t k = idx; k < parameters.front().size(); k += threads) {
+					auto & target = *parameters.front()[k];
+					for (size_t r = 1; r < parameters.size(); ++r) {
+						auto const& source = *parameters[r][k];
+						assert(source.size() == target.size());
+						for (size_t j = 0; j < target.size(); ++j) target[j] += source[j];
+					}
+					for (auto & v : target) v *= scale;
+					for (size_t r = 1; r < parameters.size(); ++r) {
+						*parameters[r][k] = target;
+					}
 				}
-				return net_.predict(data)[0][0];
 			}
 
 		private:
 			tiny_dnn::network<tiny_dnn::graph> net_;
 			bool random_net_;
+			InferencePrecision precision_ = InferencePrecision::kFloat;
+			FusedValueNetwork fused_;
+			PolicyNetwork policy_;
 		};
 	}
 
@@ -408,17 +776,44 @@ namespace neural_net {
 	void NeuralNetwork::CreateWithRandomWeights(std::string const& path) {
 		return impl::NeuralNetworkImpl::CreateWithRandomWeights(path);
 	}
+
+	std::uint64_t NeuralNetwork::GetInputFingerprint(IInputGetter const& input) {
+		tiny_dnn::tensor_t data;
+		impl::InputDataConverter().Convert(&input, data);
+
+		std::uint64_t hash = 14695981039346656037ULL; // FNV-1a
+		for (auto const& vec : data) {
+			for (auto v : vec) {
+				auto bytes = (unsigned char const*)&v;
+				for (size_t i = 0; i < sizeof(v); ++i) {
+					hash ^= bytes[i];
+					hash *= 1099511628211ULL;
+				}
+			}
+		}
+		return hash;
+	}
+
 	void NeuralNetwork::Load(std::string const& path, bool is_random) { 
 		// reload neural net
+		auto precision = impl_->GetPrecision();
 		delete impl_;
 		impl_ = new impl::NeuralNetworkImpl();
 
+		impl_->SetPrecision(precision);
 		impl_->Load(path, is_random);
 	}
 	bool NeuralNetwork::IsRandom() const {
 		return impl_->IsRandom();
 	}
 
+	void NeuralNetwork::SetPrecision(InferencePrecision precision) {
+		impl_->SetPrecision(precision);
+	}
+	InferencePrecision NeuralNetwork::GetPrecision() const {
+		return impl_->GetPrecision();
+	}
+
 	void NeuralNetwork::CopyFrom(NeuralNetwork const& rhs) {
 		// reload neural net
 		delete impl_;
@@ -427,6 +822,9 @@ namespace neural_net {
 		impl_->CopyFrom(*rhs.impl_);
 	}
 
+	PolicyNetwork & NeuralNetwork::GetPolicy() { return impl_->GetPolicy(); }
+	PolicyNetwork const& NeuralNetwork::GetPolicy() const { return impl_->GetPolicy(); }
+
 	void NeuralNetwork::Train(
 		NeuralNetworkInput const& input,
 		NeuralNetworkOutput const& output,
@@ -435,6 +833,14 @@ namespace neural_net {
 		impl_->Train(*input.impl_, *output.impl_, batch_size, epoch);
 	}
 	
+	void NeuralNetwork::Train(
+		NeuralNetworkInput const& input,
+		NeuralNetworkOutput const& output,
+		size_t batch_size, int epoch, int threads, int epoch_per_sync)
+	{
+		impl_->Train(*input.impl_, *output.impl_, batch_size, epoch, threads, epoch_per_sync);
+	}
+	
 	void NeuralNetwork::Save(std::string const& path) const { return impl_->Save(path); }
 
 	// @return tuple of (correct, total)
@@ -445,13 +851,38 @@ namespace neural_net {
 		return impl_->Verify(*input.impl_, *output.impl_);
 	}
 
+	double NeuralNetwork::GetLoss(
+		NeuralNetworkInput const& input,
+		NeuralNetworkOutput const& output)
+	{
+		return impl_->GetLoss(*input.impl_, *output.impl_);
+	}
+
+	QuantizationReport NeuralNetwork::MeasureQuantization(
+		NeuralNetworkInput const& input,
+		NeuralNetworkOutput const& output,
+		InferencePrecision precision)
+	{
+		return impl_->MeasureQuantization(*input.impl_, *output.impl_, precision);
+	}
+
 	void NeuralNetwork::Predict(impl::NeuralNetworkInputImpl const& input, std::vector<double> & results, std::mt19937 & random)
 	{
 		return impl_->Predict(input, results, random);
 	}
 
+	void NeuralNetwork::Predict(NeuralNetworkInput const& input, std::vector<double> & results, std::mt19937 & random)
+	{
+		return impl_->Predict(*input.impl_, results, random);
+	}
+
 	double NeuralNetwork::Predict(IInputGetter * input, std::mt19937 & random)
 	{
 		return impl_->Predict(input, random);
 	}
+
+	void NeuralNetwork::Predict(IInputGetter const* const* inputs, size_t count, double * results, std::mt19937 & random)
+	{
+		return impl_->Predict(inputs, count, results, random);
+	}
 }
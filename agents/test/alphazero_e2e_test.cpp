@@ -16,7 +16,7 @@ static void Initialize()
 	std::cout << " Done." << std::endl;
 }
 
-int main(void)
+int main(int argc, char *argv[])
 {
 	Initialize();
 
@@ -41,6 +41,8 @@ int main(void)
 	trainer_config.optimizer.batches = 100;
 	trainer_config.optimizer.epoches = 10000;
 	trainer_config.optimizer.epoches_per_run = trainer_config.optimizer.epoches / 10;
+	trainer_config.optimizer.threads = trainer_config.threads_ / 2; // the rest play self-play games meanwhile
+	trainer_config.optimizer.holdout = 100;
 
 	trainer_config.evaluation.runs = 100;
 	trainer_config.evaluation.agent_config.threads = 1;
@@ -57,6 +59,12 @@ int main(void)
 	
 	trainer_config.competitor_net_path_ = "competitor_net";
 
+	// Collect self-play records from GenerateTrainData --self-play-worker processes
+	if (argc == 3) {
+		trainer_config.remote_record_socket_ = argv[1];
+		trainer_config.remote_net_dir_ = argv[2];
+	}
+
 	// create a random model
 	// TODO: only create a random model if best_net does not exist
 
@@ -0,0 +1,138 @@
+#include <assert.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "MCTS/selection/EdgeAddon.h"
+
+// The previous layout of mcts::selection::EdgeAddon: three separate counters,
+// with credit and total updated by two independent read-modify-writes.
+// Kept here as the baseline of the benchmark.
+class UnpackedEdgeAddon
+{
+public:
+	UnpackedEdgeAddon() : chosen_times(0), credit(0), total(0) {}
+
+	void AddChosenTimes(int v) { chosen_times += v; }
+	auto GetChosenTimes() const { return chosen_times.load(); }
+
+	void AddCredit(float score, int repeat_times = 1) {
+		int total_increment = mcts::StaticConfigs::kCreditGranularity;
+		int credit_increment = (int)(score * mcts::StaticConfigs::kCreditGranularity);
+		total += total_increment * repeat_times;
+		credit += credit_increment * repeat_times;
+	}
+
+	auto GetTotal() const { return total.load(); }
+
+private:
+	std::atomic<std::int64_t> chosen_times;
+	std::atomic<std::int64_t> credit;
+	std::atomic<std::int64_t> total;
+};
+
+// One selection + back-propagation of an edge, with virtual loss
+template <class EdgeAddonType>
+static void UpdateEdge(EdgeAddonType & edge, float score)
+{
+	constexpr int kVirtualLoss = mcts::StaticConfigs::kVirtualLoss;
+	edge.AddChosenTimes(1);
+	edge.AddCredit(0.0, kVirtualLoss);
+	edge.AddCredit(1.0, kVirtualLoss);
+	edge.AddCredit(score);
+}
+
+// Each thread updates the edge (thread_idx % edges_count)
+// Siblings edges are stored contiguously, as in an unordered_map node pool.
+// Returns million updates per second.
+template <class EdgeAddonType>
+static double BenchmarkEdges(int threads, int edges_count, int updates_per_thread)
+{
+	std::vector<EdgeAddonType> edges(edges_count);
+	std::atomic<bool> start_flag(false);
+
+	std::vector<std::thread> workers;
+	for (int i = 0; i < threads; ++i) {
+		workers.emplace_back([&, i]() {
+			auto & edge = edges[i % edges_count];
+			while (!start_flag.load()) std::this_thread::yield();
+			for (int j = 0; j < updates_per_thread; ++j) {
+				UpdateEdge(edge, (j & 1) ? 1.0f : -1.0f);
+			}
+		});
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	start_flag.store(true);
+	for (auto & worker : workers) worker.join();
+	auto end = std::chrono::steady_clock::now();
+
+	std::int64_t chosen_times = 0;
+	for (auto const& edge : edges) chosen_times += edge.GetChosenTimes();
+	assert(chosen_times == (std::int64_t)threads * updates_per_thread);
+	(void)chosen_times;
+
+	auto us = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+	if (us <= 0) us = 1;
+	return (double)threads * updates_per_thread / us;
+}
+
+static void TestEdgeAddon()
+{
+	mcts::selection::EdgeAddon edge;
+	assert(edge.GetTotal() == 0);
+
+	edge.AddChosenTimes(1);
+	edge.AddCredit(0.0, mcts::StaticConfigs::kVirtualLoss);
+	assert(edge.GetTotal() == 3 * mcts::StaticConfigs::kCreditGranularity);
+	assert(edge.GetAverageCredit() == 0.0);
+
+	edge.AddCredit(-1.0);
+	assert(edge.GetTotal() == 4 * mcts::StaticConfigs::kCreditGranularity);
+	assert(edge.GetCredit() == -mcts::StaticConfigs::kCreditGranularity);
+	assert(edge.GetAverageCredit() == -0.25);
+
+	edge.AddCredit(1.0, 4);
+	assert(edge.GetTotal() == 8 * mcts::StaticConfigs::kCreditGranularity);
+	assert(edge.GetCredit() == 3 * mcts::StaticConfigs::kCreditGranularity);
+	assert(edge.GetChosenTimes() == 1);
+
+	static_assert(alignof(mcts::selection::EdgeAddon) == 64);
+}
+
+// Near the count limit, the count and the credit are halved; the average credit is kept
+static void TestEdgeAddonRescale()
+{
+	mcts::selection::EdgeAddon edge;
+	constexpr int kRepeatTimes = 1 << 27;
+	edge.AddCredit(0.5, kRepeatTimes);
+	edge.AddCredit(0.5, kRepeatTimes);
+	assert(edge.GetTotal() == (std::int64_t)3 * (kRepeatTimes / 2) * mcts::StaticConfigs::kCreditGranularity);
+	assert(edge.GetAverageCredit() == 0.5);
+
+	for (int i = 0; i < 8; ++i) edge.AddCredit(-1.0, kRepeatTimes);
+	assert(edge.GetTotal() > 0);
+	assert(edge.GetAverageCredit() < -0.5); // still recording
+}
+
+int main(void)
+{
+	TestEdgeAddon();
+	TestEdgeAddonRescale();
+
+	constexpr int kUpdatesPerThread = 1000000;
+	for (int edges_count : { 1, 16 }) {
+		for (int threads : { 1, 4, 16 }) {
+			auto unpacked = BenchmarkEdges<UnpackedEdgeAddon>(threads, edges_count, kUpdatesPerThread);
+			auto packed = BenchmarkEdges<mcts::selection::EdgeAddon>(threads, edges_count, kUpdatesPerThread);
+			std::cout << "EdgeAddon updates (" << threads << " threads, "
+				<< edges_count << " edges):"
+				<< " unpacked " << unpacked << " M/s;"
+				<< " packed " << packed << " M/s." << std::endl;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,73 @@
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+#include "engine/Game-impl.h"
+#include "Cards/PreIndexedCards.h"
+#include "TestStateBuilder.h"
+#include "agents/MCTSRunner.h"
+
+// Compare the scaling of tree parallelization (all threads share one tree)
+// and root parallelization (each thread owns a private tree)
+
+static void Initialize()
+{
+	std::cout << "Reading json file...";
+	if (!Cards::Database::GetInstance().Initialize("cards.json")) assert(false);
+	Cards::PreIndexedCards::GetInstance().Initialize();
+	std::cout << " Done." << std::endl;
+}
+
+static void Benchmark(state::State const& game_state, int threads, int trees, int secs)
+{
+	agents::MCTSAgentConfig config;
+	config.threads = threads;
+	config.root_parallel_trees = trees;
+	config.mcts.SetNeuralNetPath("neural_net_e2e_test");
+
+	std::mt19937 random(0);
+	agents::MCTSRunner runner(config, random);
+
+	auto side = game_state.GetCurrentPlayerId().GetSide();
+	auto start = std::chrono::steady_clock::now();
+	runner.Run(engine::view::BoardRefView(game_state, side));
+	std::this_thread::sleep_for(std::chrono::seconds(secs));
+	runner.WaitUntilStopped();
+	auto end = std::chrono::steady_clock::now();
+
+	auto iterations = runner.GetStatistic().GetSuccededIterates();
+	auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+
+	int best_choice = -1;
+	std::int64_t best = 0;
+	std::int64_t total = 0;
+	for (auto const& kv : runner.GetRootChoices(side)) {
+		total += kv.second.chosen_times;
+		if (kv.second.chosen_times > best) {
+			best = kv.second.chosen_times;
+			best_choice = kv.first;
+		}
+	}
+
+	std::cout << (trees == 1 ? "tree-parallel" : "root-parallel")
+		<< " threads: " << threads
+		<< " iterations per second: " << (double)iterations / ms * 1000
+		<< " best root choice: " << best_choice
+		<< " (" << (total > 0 ? 100.0 * best / total : 0.0) << "% of visits)"
+		<< std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+	Initialize();
+
+	std::mt19937 random(0);
+	auto game_state = TestStateBuilder().GetState(random);
+
+	constexpr int kSeconds = 10;
+	for (int threads : { 1, 2, 4, 8, 16, 32 }) {
+		Benchmark(game_state, threads, 1, kSeconds);
+		Benchmark(game_state, threads, threads, kSeconds);
+	}
+	return 0;
+}
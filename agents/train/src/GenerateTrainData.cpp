@@ -2,15 +2,30 @@
 
 #include <stdlib.h>
 
+#ifdef _MSC_VER
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
 #include <chrono>
+#include <csignal>
+#include <cstdio>
 #include <iostream>
 #include <random>
 #include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "Cards/PreIndexedCards.h"
 #include "TestStateBuilder.h"
 #include "judge/Judger.h"
+#include "judge/json/Reader.h"
 #include "agents/MCTSAgent.h"
+#include "alphazero/shared_data/net_publisher.h"
+#include "alphazero/shared_data/record_augmenter.h"
+#include "alphazero/shared_data/record_socket.h"
 
 static void Initialize(unsigned int rand_seed)
 {
@@ -84,6 +99,115 @@ void SaveJson(Json::Value const& json) {
 	fs.close();
 }
 
+static volatile std::sig_atomic_t g_stop_requested = 0;
+
+static void RequestStop(int)
+{
+	g_stop_requested = 1;
+}
+
+static int GetProcessId()
+{
+#ifdef _MSC_VER
+	return _getpid();
+#else
+	return static_cast<int>(getpid());
+#endif
+}
+
+static void RemoveNet(std::string const& path)
+{
+	std::remove(path.c_str());
+	std::remove(neural_net::PolicyNetwork::GetPath(path).c_str());
+}
+
+// Plays games with the latest neural net published by the trainer, and sends the training
+// records to it. Runs until interrupted (SIGINT or SIGTERM), finishing the current game first;
+// any number of workers can share one trainer.
+static int RunSelfPlayWorker(agents::MCTSAgentConfig config, std::string const& socket_path, std::string const& net_dir, std::mt19937 & rand)
+{
+	alphazero::shared_data::RecordSender sender;
+	if (!sender.Open(socket_path)) {
+		std::cout << "Failed to open record socket: " << socket_path << std::endl;
+		return 1;
+	}
+
+	alphazero::shared_data::RecordAugmenter augmenter;
+	augmenter.Initialize(alphazero::shared_data::AugmentationOptions());
+
+	// The publisher keeps only the last few versions, but MCTSAgent loads the net again on each move;
+	// so the games use a private copy of the net, which is not removed under a game.
+	// It is kept beside the published nets, named by the process id so workers do not share it.
+	std::string net_path = net_dir + "/worker." + std::to_string(GetProcessId());
+	config.mcts.SetNeuralNetPath(net_path);
+
+	std::signal(SIGINT, RequestStop);
+	std::signal(SIGTERM, RequestStop);
+
+	int net_version = 0;
+	size_t dropped = 0;
+	std::vector<alphazero::shared_data::TrainingRecord> records;
+	while (!g_stop_requested) {
+		int latest_version = alphazero::shared_data::NetPublisher::ReadVersion(net_dir);
+		if (latest_version == 0) {
+			std::cout << "Waiting for the trainer to publish a neural net..." << std::endl;
+			std::this_thread::sleep_for(std::chrono::seconds(1));
+			continue;
+		}
+		if (latest_version != net_version) {
+			neural_net::NeuralNetwork neural_net;
+			try {
+				neural_net.Load(alphazero::shared_data::NetPublisher::GetNetPath(net_dir, latest_version));
+			}
+			catch (std::exception const& ex) {
+				std::cout << "Failed to load neural net version " << latest_version << ": " << ex.what() << std::endl;
+				std::this_thread::sleep_for(std::chrono::seconds(1));
+				continue;
+			}
+			RemoveNet(net_path);
+			neural_net.Save(net_path);
+			net_version = latest_version;
+			std::cout << "Using neural net version " << net_version << std::endl;
+		}
+
+		using MCTSAgent = agents::MCTSAgent<AgentCallback>;
+		judge::json::Recorder recorder(rand);
+		judge::Judger<MCTSAgent, judge::json::Recorder> judger(rand, recorder);
+		MCTSAgent first(config, AgentCallback(config.iterations_per_action));
+		MCTSAgent second(config, AgentCallback(config.iterations_per_action));
+
+		judger.SetFirstAgent(&first);
+		judger.SetSecondAgent(&second);
+
+		state::State start_state = TestStateBuilder().GetStateWithRandomStartCard(rand(), rand);
+		judger.Start(start_state, rand);
+
+		records.clear();
+		augmenter.StartGame();
+		judge::json::Reader reader;
+		reader.Parse(recorder.GetJson(), [&](judge::json::NeuralNetInputGetter const& input, int label, neural_net::MainOpPolicy const& policy) {
+			auto record = alphazero::shared_data::TrainingRecord::Pack(input, label, policy);
+			augmenter.Augment(record, rand, [&](alphazero::shared_data::TrainingRecord const& variant) {
+				records.push_back(variant);
+			});
+		});
+
+		// Never blocks; the records are spooled while the trainer is training or evaluating
+		if (!sender.Send(records)) {
+			std::cout << "Failed to send " << sender.GetSpooled() << " records. Is the trainer running?" << std::endl;
+			std::this_thread::sleep_for(std::chrono::seconds(1));
+		}
+		if (sender.GetDropped() != dropped) {
+			dropped = sender.GetDropped();
+			std::cout << "Dropped " << dropped << " records so far, since the trainer is behind." << std::endl;
+		}
+	}
+
+	RemoveNet(net_path);
+	std::cout << "Stopped." << std::endl;
+	return 0;
+}
+
 int main(int argc, char *argv[])
 {
 	auto seed = std::random_device()();
@@ -93,11 +217,26 @@ int main(int argc, char *argv[])
 
 	Initialize(rand());
 
-	if (argc != 3) {
+	bool self_play_worker = (argc >= 2 && std::string(argv[1]) == "--self-play-worker");
+	if (self_play_worker) {
+		--argc;
+		++argv;
+	}
+
+	if (self_play_worker ? (argc != 5) : (argc != 3 && argc != 4)) {
 		std::cout << "Usage: "
 			<< argv[0]
 			<< " (threads)"
 			<< " (iterations)"
+			<< " [opening book]"
+			<< std::endl;
+		std::cout << "       "
+			<< argv[0]
+			<< " --self-play-worker"
+			<< " (threads)"
+			<< " (iterations)"
+			<< " (record socket)"
+			<< " (neural net dir)"
 			<< std::endl;
 		return 0;
 	}
@@ -106,6 +245,7 @@ int main(int argc, char *argv[])
 	config.tree_samples = 10;
 	config.threads = 1;
 	config.iterations_per_action = 1000;
+	config.early_stop = false; // the visit counts are recorded as policy targets
 	config.mcts.SetNeuralNetPath("neural_net");
 
 	{
@@ -122,6 +262,22 @@ int main(int argc, char *argv[])
 	std::cout << "\tIterations: " << config.iterations_per_action << std::endl;
 	std::cout << "\tSeed: " << seed << std::endl;
 
+	if (self_play_worker) {
+		return RunSelfPlayWorker(config, argv[3], argv[4], rand);
+	}
+
+	// The root statistics of this game are merged to the opening book
+	agents::OpeningBook opening_book;
+	std::string opening_book_file;
+	if (argc == 4) {
+		opening_book_file = argv[3];
+		if (opening_book.Load(opening_book_file)) {
+			std::cout << "\tOpening book: " << opening_book.Size() << " entries" << std::endl;
+		}
+		config.opening_book = &opening_book;
+		config.opening_book_record = true;
+	}
+
 	using MCTSAgent = agents::MCTSAgent<AgentCallback>;
 	judge::json::Recorder recorder(rand);
 	judge::Judger<MCTSAgent, judge::json::Recorder> judger(rand, recorder);
@@ -136,5 +292,15 @@ int main(int argc, char *argv[])
 
 	SaveJson(recorder.GetJson());
 
+	if (!opening_book_file.empty()) {
+		std::cout << "Saving opening book...";
+		if (!opening_book.Save(opening_book_file)) {
+			std::cout << " Failed." << std::endl;
+		}
+		else {
+			std::cout << " Done." << std::endl;
+		}
+	}
+
 	return 0;
 }
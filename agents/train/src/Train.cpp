@@ -1,53 +1,67 @@
+#include <atomic>
+#include <chrono>
 #include <exception>
 #include <fstream>
 #include <iostream>
 #include <cmath>
+#include <mutex>
 #include <string>
 #include <sstream>
+#include <thread>
 #include <vector>
 #include <random>
 
-#include "json/json.h"
-
 #include "neural_net/NeuralNetwork.h"
-#include "judge/json/Reader.h"
+#include "neural_net/PolicyNetwork.h"
+#include "judge/json/StreamReader.h"
+#include "alphazero/shared_data/training_record_file.h"
+
+using alphazero::shared_data::TrainingRecord;
+using alphazero::shared_data::TrainingRecordFile;
+using alphazero::shared_data::TrainingRecordInputGetter;
 
 class Trainer
 {
 public:
-	Trainer() : net_() {
+	Trainer() : net_(), policy_train_(), policy_validate_(), random_() {
 		neural_net::NeuralNetwork::CreateWithRandomWeights("initial_mode");
 		net_.Load("initial_model");
 	}
 
-	void AddJsonFile(std::string const& filename, bool for_validate) {
-		Json::Value obj;
-		Json::Reader reader;
-		std::ifstream fs(filename);
-		reader.parse(fs, obj);
-
-		int seq = 1;
-		judge::json::Reader board_reader;
-		board_reader.Parse(obj, [&](judge::json::NeuralNetInputGetter const& input, int label) {
+	void AddGame(TrainingRecordFile::Game const& game, bool for_validate) {
+		for (auto const& record : game) {
+			TrainingRecordInputGetter input(record);
 			if (for_validate) {
 				validate_input_.AddData(&input);
-				validate_output_.AddData(label);
+				validate_output_.AddData(record.label);
 			}
 			else {
 				train_input_.AddData(&input);
-				train_output_.AddData(label);
+				train_output_.AddData(record.label);
 			}
-		});
+			if (!record.policy.IsEmpty()) {
+				(for_validate ? policy_validate_ : policy_train_).push_back(input);
+			}
+		}
 	}
 
 	void Train()
 	{
 		size_t batch_size = 32;
 		int epoch = 10;
+		float policy_learning_rate = 0.01f;
 		size_t total_epoch = 0;
 
+		std::vector<neural_net::IInputGetter const*> policy_train_inputs, policy_validate_inputs;
+		std::vector<neural_net::MainOpPolicy> policy_train_targets, policy_validate_targets;
+		GetPolicyData(policy_train_, policy_train_inputs, policy_train_targets);
+		GetPolicyData(policy_validate_, policy_validate_inputs, policy_validate_targets);
+
 		while (true) {
 			net_.Train(train_input_, train_output_, batch_size, epoch);
+			if (!policy_train_inputs.empty()) {
+				net_.GetPolicy().Train(policy_train_inputs, policy_train_targets, epoch, policy_learning_rate, random_);
+			}
 			total_epoch += epoch;
 
 			std::stringstream ss;
@@ -69,6 +83,26 @@ public:
 					<< rate * 100.0 << "% ("
 					<< validate_verify.first << " / " << validate_verify.second << ")" << std::endl;
 			}
+
+			if (!policy_validate_inputs.empty()) {
+				auto report = net_.GetPolicy().Evaluate(policy_validate_inputs, policy_validate_targets);
+				std::cout << "validation policy top-1 rate: "
+					<< 100.0 * report.correct / report.total << "% ("
+					<< report.correct << " / " << report.total << ")"
+					<< ", cross entropy: " << report.cross_entropy << std::endl;
+			}
+		}
+	}
+
+private:
+	static void GetPolicyData(
+		std::vector<TrainingRecordInputGetter> const& records,
+		std::vector<neural_net::IInputGetter const*> & inputs,
+		std::vector<neural_net::MainOpPolicy> & targets)
+	{
+		for (auto const& record : records) {
+			inputs.push_back(&record);
+			targets.push_back(record.GetRecord().policy);
 		}
 	}
 
@@ -78,12 +112,71 @@ private:
 	neural_net::NeuralNetworkOutput train_output_;
 	neural_net::NeuralNetworkInput validate_input_;
 	neural_net::NeuralNetworkOutput validate_output_;
+	std::vector<TrainingRecordInputGetter> policy_train_; // the records with a recorded policy
+	std::vector<TrainingRecordInputGetter> policy_validate_;
+	std::mt19937 random_;
 };
 
+static void ReadFile(std::string const& path, std::string & content) {
+	std::ifstream fs(path, std::ifstream::binary);
+	if (!fs) throw std::runtime_error("Cannot open file");
+	fs.seekg(0, std::ifstream::end);
+	content.resize((size_t)fs.tellg());
+	fs.seekg(0, std::ifstream::beg);
+	fs.read(&content[0], content.size());
+}
+
+// Parse the game logs on 'threads' threads
+// Each thread takes the next file whenever it finishes one, so a few long games do not hold up the others.
+static std::vector<TrainingRecordFile::Game> ReadGames(
+	std::string const& dirname, std::vector<std::string> const& filenames, size_t threads)
+{
+	std::vector<TrainingRecordFile::Game> games(filenames.size());
+	std::atomic<size_t> next_file(0);
+	std::atomic<size_t> loaded_files(0);
+	std::atomic<bool> failed(false);
+	std::mutex output_mutex;
+
+	auto worker = [&]() {
+		judge::json::StreamReader reader;
+		std::string content;
+		while (!failed) {
+			size_t idx = next_file++;
+			if (idx >= filenames.size()) return;
+
+			try {
+				ReadFile(dirname + "/" + filenames[idx], content);
+				reader.Parse(content.data(), content.data() + content.size(), [&](judge::json::StreamBoard const& board, int label, neural_net::MainOpPolicy const& policy) {
+					games[idx].push_back(TrainingRecord::Pack(board, label, policy));
+				});
+			}
+			catch (std::exception const& e) {
+				std::lock_guard<std::mutex> lock(output_mutex);
+				std::cout << "Failed when loading file " << filenames[idx] << ": " << e.what() << std::endl;
+				failed = true;
+				return;
+			}
+
+			size_t loaded = ++loaded_files;
+			if (loaded % 1000 == 0) {
+				std::lock_guard<std::mutex> lock(output_mutex);
+				std::cout << "Loaded " << loaded << " files" << std::endl;
+			}
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for (size_t i = 0; i < threads; ++i) workers.emplace_back(worker);
+	for (auto & t : workers) t.join();
+
+	if (failed) throw std::runtime_error("Failed to load game logs");
+	return games;
+}
+
 int main(int argc, char **argv)
 {
-	if (argc != 2) {
-		std::cout << "Usage: (program) (dirname)" << std::endl;
+	if (argc != 2 && argc != 3) {
+		std::cout << "Usage: (program) (dirname) [threads]" << std::endl;
 		return -1;
 	}
 
@@ -92,37 +185,53 @@ int main(int argc, char **argv)
 	std::string dirname = argv[1];
 	std::string filelist_path = dirname + "/filelist";
 
+	// The game logs are parsed once, and packed to this file for the later runs.
+	// Remove it after changing the game logs.
+	std::string packed_path = filelist_path + ".records";
+
+	size_t threads = std::thread::hardware_concurrency();
+	if (argc == 3) {
+		std::istringstream ss(argv[2]);
+		ss >> threads;
+	}
+	if (threads == 0) threads = 1;
+
 	std::cout << "Reading from dir: " << dirname << std::endl;
 	std::cout << "Filelist file: " << filelist_path << std::endl;
 
+	std::vector<std::string> filenames;
 	std::ifstream filelist(filelist_path);
+	while (filelist) {
+		std::string filename;
+		filelist >> filename;
+		if (filename.empty()) continue;
+		filenames.push_back(filename);
+	}
+
+	std::vector<TrainingRecordFile::Game> games;
+	if (TrainingRecordFile::Load(packed_path, games) && games.size() == filenames.size()) {
+		std::cout << "Loaded " << games.size() << " games from packed file: " << packed_path << std::endl;
+	}
+	else {
+		auto start = std::chrono::steady_clock::now();
+		games = ReadGames(dirname, filenames, threads);
+		auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+		std::cout << "Loaded " << games.size() << " files in " << ms << " ms (" << threads << " threads)" << std::endl;
+
+		if (!TrainingRecordFile::Save(packed_path, games)) {
+			std::cout << "Failed to save packed file: " << packed_path << std::endl;
+		}
+	}
 
-	int loaded_files = 0;
 	std::random_device rand_dev;
 	std::mt19937 rand(rand_dev());
 
 	double validation_case_rate = 0.3; // 30% for validation
 
-	while (filelist) {
-		std::string filename;
-		filelist >> filename;
-		if (filename.empty()) continue;
-
+	for (auto const& game : games) {
 		std::uniform_real_distribution<double> unif(0.0, 1.0);
 		bool for_validate = unif(rand) < validation_case_rate;
-
-		try {
-			trainer.AddJsonFile(dirname + "/" + filename, for_validate);
-		}
-		catch (...) {
-			std::cout << "Failed when loading file " << filename << std::endl;
-			throw;
-		}
-
-		++loaded_files;
-		if (loaded_files % 100 == 0) {
-			std::cout << "Loaded " << loaded_files << " files" << std::endl;
-		}
+		trainer.AddGame(game, for_validate);
 	}
 
 	trainer.Train();
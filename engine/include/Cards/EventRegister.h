@@ -76,12 +76,13 @@ namespace Cards
 
 		template <typename LifeTime, typename EventType, typename EventHandler, typename EventHandlerArg>
 		struct AddEventHelper<LifeTime, NonCategorized_SelfInLambdaCapture, EventType, EventHandler, EventHandlerArg> {
+			static bool HandleEvent(state::CardRef self, typename EventType::Context const& context) {
+				if (!LifeTime::StillValid(ContextCardGetter::Get(context, self))) return false;
+				return EventHandlerInvoker<EventHandler, EventHandlerArg>::Invoke(self, context);
+			}
+
 			static void AddEvent(state::CardRef self, state::Cards::ZoneChangedContext const& context) {
-				context.state_.AddEvent<EventType>(
-					[self](auto context) {
-					if (!LifeTime::StillValid(ContextCardGetter::Get(context, self))) return false;
-					return EventHandlerInvoker<EventHandler, EventHandlerArg>::Invoke(self, context);
-				});
+				context.state_.AddStaticEvent<EventType>(self, &HandleEvent);
 			}
 		};
 		template <typename LifeTime, typename EventType, typename EventHandler, typename EventHandlerArg>
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <assert.h>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "Utils/CloneableContainers/Vector.h"
+
+// A cloneable vector which stores items in fixed-size pages.
+// Pages are shared between copies by reference-counted pointers, so a copy costs
+// only O(pages) pointer copies. A page is cloned on the first write to it,
+// if it is still shared with another copy.
+// Same as Vector, the identifier is the index, and items cannot be erased/removed
+
+namespace Utils
+{
+	namespace CloneableContainers
+	{
+		template <class ItemType, size_t PageSize>
+		class CopyOnWriteVector
+		{
+			static_assert(PageSize > 0);
+
+		public:
+			typedef VectorIdentifier Identifier;
+
+		private:
+			using Page = std::array<ItemType, PageSize>;
+
+		public:
+			CopyOnWriteVector() : size_(0), pages_() {}
+
+			// Pages are shared, and cloned on the first write
+			CopyOnWriteVector(CopyOnWriteVector const&) = default;
+			CopyOnWriteVector & operator=(CopyOnWriteVector const&) = default;
+
+			CopyOnWriteVector(CopyOnWriteVector &&) = default;
+			CopyOnWriteVector & operator=(CopyOnWriteVector &&) = default;
+
+		public:
+			template <typename T>
+			Identifier PushBack(T&& item) {
+				size_t idx = size_;
+				if (GetOffset(idx) == 0) {
+					pages_.push_back(std::make_shared<Page>());
+				}
+				++size_;
+				GetMutablePage(GetPageIndex(idx))[GetOffset(idx)] = std::forward<T>(item);
+				return Identifier((int)idx);
+			}
+
+			const ItemType & Get(Identifier identifier) const {
+				size_t idx = (size_t)identifier.idx;
+				assert(idx < size_);
+				return (*pages_[GetPageIndex(idx)])[GetOffset(idx)];
+			}
+
+			ItemType & GetMutable(Identifier identifier) {
+				size_t idx = (size_t)identifier.idx;
+				assert(idx < size_);
+				return GetMutablePage(GetPageIndex(idx))[GetOffset(idx)];
+			}
+
+			size_t Size() const { return size_; }
+
+			// Number of pages (possibly) shared with other copies. For diagnostics.
+			size_t GetSharedPages() const {
+				size_t ret = 0;
+				for (auto const& page : pages_) {
+					if (page.use_count() > 1) ++ret;
+				}
+				return ret;
+			}
+
+		private:
+			static constexpr size_t GetPageIndex(size_t idx) { return idx / PageSize; }
+			static constexpr size_t GetOffset(size_t idx) { return idx % PageSize; }
+
+			Page & GetMutablePage(size_t page_idx) {
+				auto & page = pages_[page_idx];
+				if (page.use_count() > 1) {
+					page = std::make_shared<Page>(*page); // copy on write
+				}
+				else {
+					// pair with the release decrement done by the previous co-owner
+					std::atomic_thread_fence(std::memory_order_acquire);
+				}
+				return *page;
+			}
+
+		private:
+			size_t size_;
+			std::vector<std::shared_ptr<Page>> pages_;
+		};
+	}
+}
@@ -15,10 +15,12 @@ namespace Utils
 	namespace CloneableContainers
 	{
 		template <typename ItemType, class Container> class Vector;
+		template <class ItemType, size_t PageSize> class CopyOnWriteVector;
 
 		class VectorIdentifier
 		{
 			template <class ItemType, class Container> friend class Vector;
+			template <class ItemType, size_t PageSize> friend class CopyOnWriteVector;
 
 		public:
 			constexpr VectorIdentifier() : idx(-1) {}
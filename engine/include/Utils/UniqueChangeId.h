@@ -0,0 +1,38 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+namespace Utils
+{
+	// Change ids which are unique across all state copies and all threads
+	// A plain counter is not enough to identify a content: two copies of the same state
+	// can be modified in different ways, and end up with the same counter value.
+	// If every modification takes a new id from here, two objects with the same id
+	// are guaranteed to hold the same content.
+	class UniqueChangeId
+	{
+	public:
+		using ValueType = int64_t;
+
+		static ValueType Next() {
+			thread_local ValueType next = 0;
+			thread_local ValueType end = 0;
+
+			if (next == end) {
+				// allocate a block of ids, so the shared atomic is rarely touched
+				next = GetAllocator().fetch_add(kBlockSize, std::memory_order_relaxed);
+				end = next + kBlockSize;
+			}
+			return next++;
+		}
+
+	private:
+		static constexpr ValueType kBlockSize = 1 << 16;
+
+		static std::atomic<ValueType> & GetAllocator() {
+			static std::atomic<ValueType> allocator(1); // 0 is reserved for default-constructed objects
+			return allocator;
+		}
+	};
+}
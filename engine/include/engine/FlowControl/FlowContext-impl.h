@@ -10,19 +10,25 @@ namespace engine {
 			state::State & state, state::CardRef card_ref, state::targetor::Targets const & target_info)
 		{
 			assert(!specified_target_.IsValid());
-			targets_.clear();
-			target_info.Fill(state, targets_);
+			auto targets = target_info.GetBitset(state);
 
-			if (targets_.empty()) {
+			int count = targets.Count();
+			if (count == 0) {
 				specified_target_.Invalidate();
 				return;
 			}
 
-			if (targets_.size() <= 1) {
-				specified_target_ = targets_[0];
+			if (count == 1) {
+				specified_target_ = targets.Get(state, 0);
 				return;
 			}
 
+			// Only a real choice is listed for the action parameter getter
+			targets_.clear();
+			targets.ForEach(state, [&](state::CardRef ref) {
+				targets_.push_back(ref);
+				return true;
+			});
 			specified_target_ = action_parameters_->GetSpecifiedTarget(state, card_ref, targets_);
 			assert(specified_target_.IsValid());
 		}
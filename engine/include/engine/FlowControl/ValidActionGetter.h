@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <vector>
 
 #include "state/State.h"
@@ -10,9 +11,78 @@ namespace engine {
 	{
 		class ValidActionGetter
 		{
+		public:
+			// Identifies the inputs to the valid actions
+			// Only 'resource', 'cards' and 'events' are unique across state copies (Utils::UniqueChangeId).
+			// 'hand', 'first_minions' and 'second_minions' are per-object counters copied along with
+			// the state, so two copies can reach the same counter with different contents.
+			// The key relies on this invariant: any change to the valid actions modifies a card,
+			// which renews 'cards'. E.g., the secrets, weapon, hero, hero power and played_*_this_turn
+			// are not in the key; they change only when a card is played, triggered, equipped or
+			// replaced. The deck is not an input to the valid actions.
+			struct ChangeIds {
+				ChangeIds() :
+					current_player(), turn(0), hand(0), first_minions(0), second_minions(0),
+					resource(0), cards(0), events(0)
+				{}
+
+				ChangeIds(state::PlayerIdentifier current_player, int turn, int hand,
+					int first_minions, int second_minions,
+					Utils::UniqueChangeId::ValueType resource,
+					Utils::UniqueChangeId::ValueType cards,
+					Utils::UniqueChangeId::ValueType events) :
+					current_player(current_player), turn(turn), hand(hand),
+					first_minions(first_minions), second_minions(second_minions),
+					resource(resource), cards(cards), events(events)
+				{}
+
+				state::PlayerIdentifier current_player;
+				int turn;
+				int hand;
+				int first_minions;
+				int second_minions;
+				Utils::UniqueChangeId::ValueType resource;
+				Utils::UniqueChangeId::ValueType cards;
+				Utils::UniqueChangeId::ValueType events;
+
+				bool operator==(ChangeIds const& rhs) const {
+					// compare the most-frequently-changed field first
+					if (cards != rhs.cards) return false;
+					if (events != rhs.events) return false;
+					if (resource != rhs.resource) return false;
+					if (hand != rhs.hand) return false;
+					if (first_minions != rhs.first_minions) return false;
+					if (second_minions != rhs.second_minions) return false;
+					if (turn != rhs.turn) return false;
+					if (current_player != rhs.current_player) return false;
+					return true;
+				}
+				bool operator!=(ChangeIds const& rhs) const { return !(*this == rhs); }
+			};
+
+			// Effective cost of a card, after all the cost modifiers are applied
+			struct PlayCardCost {
+				int cost;
+				bool cost_health_instead;
+			};
+			using HandCardCosts = std::array<PlayCardCost, state::board::Hand::max_cards_>;
+
 		public:
 			ValidActionGetter(state::State const& state) : state_(state) {}
 
+			ChangeIds GetChangeIds() const {
+				auto const& player = state_.GetCurrentPlayer();
+				return ChangeIds(
+					state_.GetCurrentPlayerId(),
+					state_.GetTurn(),
+					player.hand_.GetChangeId(),
+					state_.GetBoard().GetFirst().minions_.GetChangeId(),
+					state_.GetBoard().GetSecond().minions_.GetChangeId(),
+					player.GetResource().GetChangeId(),
+					state_.GetCardsManager().GetChangeId(),
+					state_.GetEventsChangeId());
+			}
+
 		public:
 			state::CardRef GetHeroRef(state::PlayerSide side) const {
 				return state_.GetBoard().Get(side).GetHeroRef();
@@ -32,13 +102,44 @@ namespace engine {
 			void ForEachPlayableCard(Functor && op) const
 			{
 				auto const& hand = state_.GetCurrentPlayer().hand_;
+				if (hand.Empty()) return;
+
+				HandCardCosts costs;
+				GetHandCardCosts(costs);
+
 				for (size_t idx = 0; idx < hand.Size(); ++idx) {
-					if (!IsPlayable(idx)) continue;
+					if (!IsPlayable(idx, costs[idx])) continue;
 					if (!op(idx)) return;
 				}
 			}
 
 			bool IsPlayable(size_t hand_idx) const
+			{
+				state::CardRef card_ref = state_.GetCurrentPlayer().hand_.Get(hand_idx);
+				return IsPlayable(hand_idx, GetPlayCardCost(card_ref, state_.GetCard(card_ref)));
+			}
+
+			// Get the effective costs for all hand cards,
+			// with only one pass over the cost-modifier handlers
+			void GetHandCardCosts(HandCardCosts & costs) const
+			{
+				auto const& hand = state_.GetCurrentPlayer().hand_;
+				for (size_t idx = 0; idx < hand.Size(); ++idx) {
+					costs[idx].cost = state_.GetCard(hand.Get(idx)).GetCost();
+					costs[idx].cost_health_instead = false;
+				}
+
+				state_.TriggerEventWithoutRemoveForEach<state::Events::EventTypes::GetPlayCardCost>(
+					hand.Size(),
+					[&](size_t idx) {
+						return state::Events::EventTypes::GetPlayCardCost::Context{
+							state_, hand.Get(idx), &costs[idx].cost, &costs[idx].cost_health_instead
+						};
+					});
+			}
+
+		private:
+			bool IsPlayable(size_t hand_idx, PlayCardCost const& cost) const
 			{
 				auto const& hand = state_.GetCurrentPlayer().hand_;
 				state::CardRef card_ref = hand.Get(hand_idx);
@@ -56,18 +157,19 @@ namespace engine {
 					return false;
 				}
 
-				if (!CheckCost(card_ref, card)) return false;
+				if (!CheckCost(cost)) return false;
 
 				return true;
 			}
 
+		public:
 			bool CanUseHeroPower() const {
 				state::CardRef card_ref = state_.GetCurrentPlayer().GetHeroPowerRef();
 				state::Cards::Card const& card = state_.GetCard(card_ref);
 
 				bool ret = false;
 				if (card.GetRawData().usable) {
-					ret = CheckCost(card_ref, card);
+					ret = CheckCost(GetPlayCardCost(card_ref, card));
 				}
 
 				return ret;
@@ -118,19 +220,14 @@ namespace engine {
 				}
 			}
 
-			std::vector<state::CardRef> GetDefenders() const {
-				std::vector<state::CardRef> defenders;
+			// Functor parameters: state::CardRef
+			//    Return false to stop iterating
+			template <typename Functor>
+			void ForEachDefender(Functor&& functor) const {
 				auto const& player = state_.GetBoard().Get(state_.GetCurrentPlayerId().Opposite());
 
-				state::CardRef hero_ref = player.GetHeroRef();
-				defenders.push_back(hero_ref);
-
-				player.minions_.ForEach([&](state::CardRef card_ref) {
-					defenders.push_back(card_ref);
-					return true;
-				});
-
-				return defenders;
+				if (!functor(player.GetHeroRef())) return;
+				player.minions_.ForEach(std::forward<Functor>(functor));
 			}
 
 			bool HeroPowerUsable() const {
@@ -146,24 +243,28 @@ namespace engine {
 			}
 
 		private:
-			bool CheckCost(state::CardRef card_ref, state::Cards::Card const& card) const
+			PlayCardCost GetPlayCardCost(state::CardRef card_ref, state::Cards::Card const& card) const
 			{
-				int cost = card.GetCost();
-				bool cost_health_instead = false;
+				PlayCardCost ret{ card.GetCost(), false };
 
 				state_.TriggerEventWithoutRemove<state::Events::EventTypes::GetPlayCardCost>(state::Events::EventTypes::GetPlayCardCost::Context{
-					state_, card_ref, &cost, &cost_health_instead
+					state_, card_ref, &ret.cost, &ret.cost_health_instead
 				});
 
-				if (cost <= 0) return true;
+				return ret;
+			}
+
+			bool CheckCost(PlayCardCost const& cost) const
+			{
+				if (cost.cost <= 0) return true;
 
-				if (cost_health_instead) {
+				if (cost.cost_health_instead) {
 					state::CardRef hero_ref = state_.GetCurrentPlayer().GetHeroRef();
-					if (state_.GetCard(hero_ref).GetHP() < cost) return false;
+					if (state_.GetCard(hero_ref).GetHP() < cost.cost) return false;
 				}
 				else {
 					auto& crystal = state_.GetCurrentPlayer().GetResource();
-					if (crystal.GetCurrent() < cost) return false;
+					if (crystal.GetCurrent() < cost.cost) return false;
 				}
 
 				return true;
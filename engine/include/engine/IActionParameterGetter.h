@@ -26,6 +26,10 @@ namespace engine {
 		void Initialize(FlowControl::ValidActionGetter const& valid_action_getter) {
 			analyzer_.Analyze(valid_action_getter);
 		}
+		// Reuse the analysis already done on the same state
+		void Initialize(ValidActionAnalyzer const& analyzer) {
+			analyzer_ = analyzer;
+		}
 
 		auto const& GetAnalyzer() { return analyzer_; }
 
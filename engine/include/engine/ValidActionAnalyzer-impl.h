@@ -11,6 +11,9 @@ namespace engine {
 	}
 	
 	inline void ValidActionAnalyzer::Analyze(FlowControl::ValidActionGetter const& getter) {
+		auto change_ids = getter.GetChangeIds();
+		if (analyzed_ && analyzed_change_ids_ == change_ids) return;
+
 		Reset();
 
 		action_targets_.Analyze(getter);
@@ -42,5 +45,8 @@ namespace engine {
 
 		op_map_[op_map_size_] = engine::MainOpType::kMainOpEndTurn;
 		++op_map_size_;
+
+		analyzed_ = true;
+		analyzed_change_ids_ = change_ids;
 	}
 }
\ No newline at end of file
@@ -6,21 +6,25 @@
 #include "state/State.h"
 #include "engine/MainOp.h"
 #include "engine/ActionTargets.h"
+#include "engine/FlowControl/ValidActionGetter.h"
 
 namespace engine {
-	namespace FlowControl
-	{
-		class ValidActionGetter;
-	}
-
+	// Analyze the valid actions for the current player
+	// The result is keyed on the change ids of the analyzed state (see ValidActionGetter::ChangeIds).
+	// If the state is not changed since the last analysis (e.g., an MCTS iteration restarts from the same root),
+	//    the previous result is reused.
 	class ValidActionAnalyzer
 	{
 	public:
 		ValidActionAnalyzer() : 
-			op_map_(), op_map_size_(0), attackers_(), playable_cards_(), action_targets_()
+			op_map_(), op_map_size_(0), attackers_(), playable_cards_(), action_targets_(),
+			analyzed_(false), analyzed_change_ids_()
 		{}
 
-		void Reset() { op_map_size_ = 0; }
+		void Reset() {
+			op_map_size_ = 0;
+			analyzed_ = false;
+		}
 
 		void Analyze(state::State const& state);
 		void Analyze(FlowControl::ValidActionGetter const& getter);
@@ -63,5 +67,8 @@ namespace engine {
 		std::vector<int> attackers_;
 		std::vector<size_t> playable_cards_;
 		ActionTargets action_targets_;
+
+		bool analyzed_;
+		FlowControl::ValidActionGetter::ChangeIds analyzed_change_ids_;
 	};
 }
\ No newline at end of file
@@ -1,10 +1,9 @@
 #pragma once
 
-#include <optional>
 #include <utility>
 
-#include "Utils/CloneableContainers/Vector.h"
-#include "Utils/NeverShrinkVector.h"
+#include "Utils/CloneableContainers/CopyOnWriteVector.h"
+#include "Utils/UniqueChangeId.h"
 #include "state/Cards/Card.h"
 #include "state/Types.h"
 
@@ -15,53 +14,41 @@ namespace state
 		class Manager
 		{
 		public:
-			using ItemType = Utils::PersistentOptionalItem<Card>;
+			// Cards are stored in pages, which are shared between copies and cloned on the first write.
+			// A copy costs O(pages) pointer copies, instead of O(cards) item copies.
+			// Each page costs an atomic reference count increment (and decrement) per copy, and all the
+			// MCTS threads copy from the same root state, so they contend on these counts. Larger pages
+			// mean fewer counts, but a write clones more cards (see e2e_cards_manager_benchmark).
+			static constexpr size_t kCardsPerPage = 8;
+			typedef Utils::CloneableContainers::CopyOnWriteVector<Card, kCardsPerPage> ContainerType;
 
-			// A customized vector is used to ensure the underlying buffer only grows, never shrinks
-			typedef Utils::CloneableContainers::Vector<ItemType, Utils::NeverShrinkVector<ItemType>> ContainerType;
+			Manager() : cards_(), change_id_(0) {}
 
-			Manager() : base_(nullptr), cards_() {}
-
-			Manager(Manager const& rhs) :
-				base_(rhs.base_), cards_(rhs.cards_)
-			{}
+			Manager(Manager const& rhs) = default;
+			Manager & operator=(Manager const& rhs) = default;
 
 			void RefCopy(Manager const& base) {
-				assert(base.base_ == nullptr);
-				base_ = &base;
-
-				cards_.Reset();
-				cards_.Resize(base.cards_.Size());
+				*this = base;
 			}
 
-			Manager & operator=(Manager const& rhs) {
-				base_ = rhs.base_;
-				cards_ = rhs.cards_;
-				return *this;
-			}
+			// Changed whenever a card is (possibly) modified or added
+			// The id is unique across state copies; see Utils::UniqueChangeId
+			auto GetChangeId() const { return change_id_; }
 
 		public:
 			Card const& Get(CardRef id) const {
-				auto const& item = cards_.Get(id.id);
-				if (item.HasSet()) return item.Get();
-
-				assert(base_);
-				return base_->Get(id);
+				return cards_.Get(id.id);
 			}
 
 			Card & GetMutable(CardRef id) {
-				auto & item = cards_.Get(id.id);
-				if (item.HasSet()) return item.Get();
-
-				assert(base_);
-				assert(id.id < (int)base_->cards_.Size());
-				item.RefCopy(base_->Get(id)); // copy-on-write
-				return item.Get();
+				change_id_ = Utils::UniqueChangeId::Next();
+				return cards_.GetMutable(id.id);
 			}
 
 			CardRef PushBack(Cards::Card && card)
 			{
 				assert(card.GetZone() == kCardZoneNewlyCreated);
+				change_id_ = Utils::UniqueChangeId::Next();
 				return CardRef(cards_.PushBack(std::move(card)));
 			}
 
@@ -71,8 +58,8 @@ namespace state
 			}
 
 		private:
-			Manager const* base_;
 			ContainerType cards_;
+			Utils::UniqueChangeId::ValueType change_id_;
 		};
 	}
 }
\ No newline at end of file
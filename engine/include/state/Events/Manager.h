@@ -4,6 +4,7 @@
 #include <utility>
 #include <tuple>
 
+#include "Utils/UniqueChangeId.h"
 #include "state/Types.h"
 #include "state/Events/impl/HandlersContainer.h"
 #include "state/Events/impl/CategorizedHandlersContainer.h"
@@ -42,21 +43,35 @@ namespace state
 			};
 
 		public:
-			Manager() : event_trigger_recursive_count_(0), event_tuple_(), categorized_event_tuple_() {}
+			Manager() : event_trigger_recursive_count_(0), change_id_(0), event_tuple_(), categorized_event_tuple_() {}
 
 			void RefCopy(Manager const& base) {
 				event_trigger_recursive_count_ = base.event_trigger_recursive_count_;
+				change_id_ = base.change_id_;
 				CopyOnWriteHelper::CopyOnWrite(this->event_tuple_, base.event_tuple_);
 				CopyOnWriteHelper::CopyOnWrite(this->categorized_event_tuple_, base.categorized_event_tuple_);
 			}
 
+			// Changed whenever a handler is (possibly) added, removed, or modified
+			// The id is unique across state copies; see Utils::UniqueChangeId
+			auto GetChangeId() const { return change_id_; }
+
 			template <typename EventType, typename T>
 			void PushBack(T&& handler) {
+				change_id_ = Utils::UniqueChangeId::Next();
 				GetHandlersContainer<EventType>().PushBack(std::forward<T>(handler));
 			}
 
+			// Handler generated at compile time for a card type, with 'self' as the only per-instance data
+			template <typename EventType>
+			void PushBackStatic(CardRef self, typename impl::HandlersContainer<EventType>::StaticHandlerType handler) {
+				change_id_ = Utils::UniqueChangeId::Next();
+				GetHandlersContainer<EventType>().PushBack(self, handler);
+			}
+
 			template <typename EventType, typename T>
 			void PushBack(CardRef card_ref, T&& handler) {
+				change_id_ = Utils::UniqueChangeId::Next();
 				GetCategorizedHandlersContainer<EventType>().PushBack(
 					card_ref, std::forward<T>(handler));
 			}
@@ -65,6 +80,7 @@ namespace state
 			void TriggerEvent(Args&&... args)
 			{
 				if (event_trigger_recursive_count_ >= max_event_trigger_recursive_) return;
+				change_id_ = Utils::UniqueChangeId::Next(); // handlers might be removed or mutated
 				++event_trigger_recursive_count_;
 				GetHandlersContainer<EventTriggerType>().TriggerAll(std::forward<Args>(args)...);
 				--event_trigger_recursive_count_;
@@ -74,6 +90,7 @@ namespace state
 			void TriggerCategorizedEvent(CardRef card_ref, Args&&... args)
 			{
 				if (event_trigger_recursive_count_ >= max_event_trigger_recursive_) return;
+				change_id_ = Utils::UniqueChangeId::Next(); // handlers might be removed or mutated
 				++event_trigger_recursive_count_;
 				GetCategorizedHandlersContainer<EventTriggerType>()
 					.TriggerAll(card_ref, std::forward<Args>(args)...);
@@ -89,6 +106,16 @@ namespace state
 				--event_trigger_recursive_count_;
 			}
 
+			template <typename EventTriggerType, typename ContextGetter>
+			void TriggerEventWithoutRemoveForEach(size_t count, ContextGetter&& context_getter) const
+			{
+				if (event_trigger_recursive_count_ >= max_event_trigger_recursive_) return;
+				++event_trigger_recursive_count_;
+				GetHandlersContainer<EventTriggerType>().TriggerAllWithoutRemoveForEach(
+					count, std::forward<ContextGetter>(context_getter));
+				--event_trigger_recursive_count_;
+			}
+
 			template <typename EventTriggerType, typename... Args>
 			void TriggerCategorizedEventWithoutRemove(CardRef card_ref, Args&&... args) const
 			{
@@ -102,6 +129,7 @@ namespace state
 		private:
 			constexpr static int max_event_trigger_recursive_ = 100;
 			mutable int event_trigger_recursive_count_; // obey logical const meanings
+			Utils::UniqueChangeId::ValueType change_id_;
 
 		private:
 			using EvnetTypesTuple = std::tuple<
@@ -3,6 +3,7 @@
 #include <vector>
 #include <type_traits>
 #include <utility>
+#include "state/Types.h"
 
 namespace state
 {
@@ -12,6 +13,31 @@ namespace state
 			template <typename TriggerType>
 			class HandlersContainer
 			{
+			public:
+				// Handlers registered by card types. The function is generated at compile time
+				// for each (card, event) pair, and the owner card is the only per-instance data.
+				// So these handlers are stored as PODs, and are copied by memcpy.
+				using StaticHandlerType = bool(*)(state::CardRef, typename TriggerType::Context const&);
+
+			private:
+				struct Item {
+					StaticHandlerType static_handler; // nullptr for a dynamic handler
+					state::CardRef self;
+					size_t dynamic_idx;
+				};
+				static_assert(std::is_trivially_copyable_v<Item>);
+
+				struct Handlers {
+					Handlers() : items(), dynamic_handlers(), dynamic_handlers_alive(0) {}
+
+					// handlers in the order of registration
+					std::vector<Item> items;
+
+					// Handlers with arbitrary captures
+					std::vector<typename TriggerType::type> dynamic_handlers;
+					size_t dynamic_handlers_alive;
+				};
+
 			public:
 				HandlersContainer() : base_(nullptr), handlers_() {}
 
@@ -39,7 +65,16 @@ namespace state
 				void PushBack(T&& handler)
 				{
 					static_assert(std::is_convertible_v<std::decay_t<T>, typename TriggerType::type>, "Wrong type");
-					GetContainerForWrite().push_back(std::forward<T>(handler));
+					auto & handlers = GetContainerForWrite();
+					handlers.items.push_back(Item{ nullptr, state::CardRef(), handlers.dynamic_handlers.size() });
+					handlers.dynamic_handlers.push_back(std::forward<T>(handler));
+					++handlers.dynamic_handlers_alive;
+				}
+
+				void PushBack(state::CardRef self, StaticHandlerType handler)
+				{
+					assert(handler);
+					GetContainerForWrite().items.push_back(Item{ handler, self, 0 });
 				}
 
 				// Note: Do not provide remove interface to outside
@@ -57,17 +92,17 @@ namespace state
 					//    If you play a spell, Troggzor the Earthinator summons a Burly Rockjaw Trogg.
 					//    The Burly Rockjaw Trogg does not trigger from the same spell because the consequences of playing the spell have already begun resolving.
 
-					if (GetContainerForRead().empty()) return;
+					if (GetContainerForRead().items.empty()) return;
 
-					size_t origin_size = GetContainerForRead().size();
-					for (size_t idx = 0; idx < GetContainerForRead().size();) {
+					size_t origin_size = GetContainerForRead().items.size();
+					for (size_t idx = 0; idx < GetContainerForRead().items.size();) {
 						if (idx >= origin_size) break; // do not trigger newly-added handlers
 
-						auto ret = GetContainerForRead()[idx](std::forward<Args>(args)...);
+						auto ret = Invoke(GetContainerForRead(), idx, std::forward<Args>(args)...);
 						static_assert(std::is_same_v<decltype(ret), bool>, "Should return a boolean flag indicating if we should remove the item.");
 
 						if (!ret) {
-							GetContainerForWrite().erase(GetContainerForWrite().begin() + idx);
+							Erase(idx);
 						}
 						else {
 							++idx;
@@ -86,25 +121,58 @@ namespace state
 					//    If you play a spell, Troggzor the Earthinator summons a Burly Rockjaw Trogg.
 					//    The Burly Rockjaw Trogg does not trigger from the same spell because the consequences of playing the spell have already begun resolving.
 
-					if (GetContainerForRead().empty()) return;
+					if (GetContainerForRead().items.empty()) return;
 
-					size_t origin_size = GetContainerForRead().size();
-					for (size_t idx = 0; idx < GetContainerForRead().size();++idx) {
+					size_t origin_size = GetContainerForRead().items.size();
+					for (size_t idx = 0; idx < GetContainerForRead().items.size();++idx) {
 						if (idx >= origin_size) break; // do not trigger newly-added handlers
 
-						GetContainerForRead()[idx](std::forward<Args>(args)...);
+						Invoke(GetContainerForRead(), idx, std::forward<Args>(args)...);
+					}
+				}
+
+				// Trigger all handlers on a batch of contexts, in a single pass over the handlers
+				// Each handler is invoked on context_getter(0) .. context_getter(count-1) before moving on to the next handler
+				// For every single context, the handlers are still invoked in order,
+				//    so the result is the same as calling TriggerAllWithoutRemove() for each context
+				template <typename ContextGetter>
+				void TriggerAllWithoutRemoveForEach(size_t count, ContextGetter&& context_getter) const
+				{
+					if (count == 0) return;
+					auto const& handlers = GetContainerForRead();
+					for (size_t idx = 0; idx < handlers.items.size(); ++idx) {
+						for (size_t i = 0; i < count; ++i) {
+							Invoke(handlers, idx, context_getter(i));
+						}
 					}
 				}
 
 			private:
-				typedef std::vector<typename TriggerType::type> container_type;
+				template <typename... Args>
+				static auto Invoke(Handlers const& handlers, size_t idx, Args&&... args) {
+					auto const& item = handlers.items[idx];
+					if (item.static_handler) return item.static_handler(item.self, std::forward<Args>(args)...);
+					return handlers.dynamic_handlers[item.dynamic_idx](std::forward<Args>(args)...);
+				}
+
+				void Erase(size_t idx) {
+					auto & handlers = GetContainerForWrite();
+					auto const& item = handlers.items[idx];
+					if (!item.static_handler) {
+						// release the captures; the slot is reclaimed when all dynamic handlers are gone
+						handlers.dynamic_handlers[item.dynamic_idx] = typename TriggerType::type();
+						assert(handlers.dynamic_handlers_alive > 0);
+						if (--handlers.dynamic_handlers_alive == 0) handlers.dynamic_handlers.clear();
+					}
+					handlers.items.erase(handlers.items.begin() + idx);
+				}
 
-				container_type const& GetContainerForRead() const {
+				Handlers const& GetContainerForRead() const {
 					if (base_) return *base_;
 					return handlers_;
 				}
 
-				container_type & GetContainerForWrite() {
+				Handlers & GetContainerForWrite() {
 					if (base_) {
 						handlers_ = *base_; // copy-on-write
 						base_ = nullptr;
@@ -113,8 +181,8 @@ namespace state
 				}
 
 			private:
-				container_type const* base_;
-				container_type handlers_;
+				Handlers const* base_;
+				Handlers handlers_;
 			};
 		}
 	}
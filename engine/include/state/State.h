@@ -42,6 +42,7 @@ namespace state
 		board::Board & GetBoard() { return board_; }
 
 		Cards::Manager const& GetCardsManager() const { return cards_mgr_; }
+		auto GetEventsChangeId() const { return event_mgr_.GetChangeId(); }
 
 		aura::Manager const& GetAuraManager() const { return aura_mgr_; }
 		aura::Manager & GetAuraManager() { return aura_mgr_; }
@@ -113,6 +114,10 @@ namespace state
 		void AddEvent(CardRef card_ref, T&& handler) {
 			return event_mgr_.PushBack<EventType, T>(card_ref, std::forward<T>(handler));
 		}
+		template <typename EventType, typename Handler>
+		void AddStaticEvent(CardRef self, Handler handler) {
+			return event_mgr_.PushBackStatic<EventType>(self, handler);
+		}
 		template <typename EventTriggerType, typename... Args>
 		void TriggerEvent(Args&&... args) {
 			return event_mgr_.TriggerEvent<EventTriggerType, Args...>(std::forward<Args>(args)...);
@@ -125,6 +130,10 @@ namespace state
 		void TriggerEventWithoutRemove(Args&&... args) const {
 			return event_mgr_.TriggerEventWithoutRemove<EventTriggerType, Args...>(std::forward<Args>(args)...);
 		}
+		template <typename EventTriggerType, typename ContextGetter>
+		void TriggerEventWithoutRemoveForEach(size_t count, ContextGetter&& context_getter) const {
+			return event_mgr_.TriggerEventWithoutRemoveForEach<EventTriggerType>(count, std::forward<ContextGetter>(context_getter));
+		}
 		template <typename EventTriggerType, typename... Args>
 		void TriggerCategorizedEventWithoutRemove(CardRef card_ref, Args&&... args) const {
 			return event_mgr_.TriggerCategorizedEventWithoutRemove<EventTriggerType, Args...>(card_ref, std::forward<Args>(args)...);
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "Utils/UniqueChangeId.h"
+
 namespace state
 {
 	namespace board
@@ -7,10 +9,14 @@ namespace state
 		class PlayerResource
 		{
 		public:
-			PlayerResource() : current_(0), total_(0), overload_current_(0), overload_next_(0) {}
+			PlayerResource() : current_(0), total_(0), overload_current_(0), overload_next_(0), change_id_(0) {}
+
+			// The id is unique across state copies; see Utils::UniqueChangeId
+			auto GetChangeId() const { return change_id_; }
 
 			void SetTotal(int total)
 			{
+				Changed();
 				assert(total <= 10);
 				total_ = total;
 			}
@@ -18,6 +24,7 @@ namespace state
 			int GetTotal() const { return total_; }
 
 			void DestroyOneCrystal() {
+				Changed();
 				int empty_counts = GetTotal() - GetCurrent();
 				SetTotal(GetTotal() - 1);
 				if (empty_counts <= 0) {
@@ -26,6 +33,7 @@ namespace state
 			}
 
 			void GainCrystal(int amount = 1) {
+				Changed();
 				int new_total = total_ + amount;
 				if (new_total > 10) new_total = 10;
 				int gain = new_total - total_;
@@ -34,38 +42,46 @@ namespace state
 			}
 
 			void GainEmptyCrystal(int amount = 1) {
+				Changed();
 				int new_total = total_ + amount;
 				if (new_total > 10) new_total = 10;
 				SetTotal(new_total);
 			}
 
-			void Refill() { current_ = total_; }
+			void Refill() {
+				Changed();
+				current_ = total_;
+			}
 			void SetCurrent(int current) { 
+				Changed();
 				if (current > 10) current = 10;
 				current_ = current;
 			}
 			int GetCurrent() const { return current_; }
 
 			int GetCurrentOverloaded() const { return overload_current_; }
-			void SetCurrentOverloaded(int v) { overload_current_ = v; }
+			void SetCurrentOverloaded(int v) { Changed(); overload_current_ = v; }
 
 			int GetNextOverload() const { return overload_next_; }
-			void IncreaseNextOverload(int v) { overload_next_ += v; }
-			void SetNextOverload(int v) { overload_next_ = v; }
+			void IncreaseNextOverload(int v) { Changed(); overload_next_ += v; }
+			void SetNextOverload(int v) { Changed(); overload_next_ = v; }
 
 			void UnlockOverload() {
+				Changed();
 				current_ += overload_current_;
 				overload_current_ = 0;
 				overload_next_ = 0;
 			}
 
 			void Cost(int amount) {
+				Changed();
 				assert(GetCurrent() >= amount);
 				if (amount < 0) return;
 				current_ -= amount;
 			}
 
 			void TurnStart() {
+				Changed();
 				if (total_ < 10) {
 					++total_;
 				}
@@ -74,11 +90,15 @@ namespace state
 				current_ = total_ - overload_current_;
 			}
 
+		private:
+			void Changed() { change_id_ = Utils::UniqueChangeId::Next(); }
+
 		private:
 			int current_;
 			int total_;
 			int overload_current_;
 			int overload_next_;
+			Utils::UniqueChangeId::ValueType change_id_;
 		};
 	}
 }
\ No newline at end of file
@@ -13,11 +13,12 @@ namespace state {
 				return true;
 			});
 		}
-		inline void Targets::Fill(state::State const& state, std::unordered_set<CardRef>& targets) const {
-			Process(state, [&](CardRef ref) {
-				targets.insert(ref);
-				return true;
-			});
+
+		inline TargetsBitset Targets::GetBitset(state::State const& state) const {
+			TargetsBitset ret;
+			if (include_first) FillPlayerBitset(state, kPlayerFirst, ret);
+			if (include_second) FillPlayerBitset(state, kPlayerSecond, ret);
+			return ret;
 		}
 
 		template <typename Functor>
@@ -28,10 +29,7 @@ namespace state {
 		}
 
 		inline void Targets::Count(state::State const& state, int * count) const {
-			Process(state, [count](CardRef) {
-				++(*count);
-				return true;
-			});
+			*count += GetBitset(state).Count();
 		}
 
 		template <typename Functor>
@@ -47,10 +45,7 @@ namespace state {
 		template <typename Functor>
 		inline bool Targets::ProcessPlayerTargets(state::State const& state, board::Player const& player, Functor&& functor) const {
 			auto op = [&](state::CardRef card_ref) {
-				if (card_ref == exclude) return true;
-				auto const& card = state.GetCard(card_ref);
-				if (!CheckTargetableFilter(state, card)) return true;
-				if (!CheckFilter(state, card)) return true;
+				if (!CheckCard(state, card_ref)) return true;
 				return functor(card_ref);
 			};
 
@@ -63,6 +58,28 @@ namespace state {
 			return true;
 		}
 
+		inline void Targets::FillPlayerBitset(state::State const& state, state::PlayerSide side, TargetsBitset & bitset) const {
+			auto const& player = state.GetBoard().Get(side);
+
+			if (include_hero) {
+				if (CheckCard(state, player.GetHeroRef())) bitset.SetHero(side);
+			}
+			if (include_minion) {
+				auto const& minions = player.minions_.Get();
+				for (size_t pos = 0; pos < minions.size(); ++pos) {
+					if (CheckCard(state, minions[pos])) bitset.SetMinion(side, (int)pos);
+				}
+			}
+		}
+
+		inline bool Targets::CheckCard(state::State const& state, CardRef card_ref) const {
+			if (card_ref == exclude) return false;
+			auto const& card = state.GetCard(card_ref);
+			if (!CheckTargetableFilter(state, card)) return false;
+			if (!CheckFilter(state, card)) return false;
+			return true;
+		}
+
 		inline bool Targets::CheckTargetable(state::Cards::Card const & card) const
 		{
 			if (card.GetPlayerIdentifier() != targeting_side) {
@@ -123,5 +140,32 @@ namespace state {
 			assert(false);
 			return false; // fallback
 		}
+	
+		inline CardRef TargetsBitset::GetCardRef(state::State const& state, int bit) {
+			PlayerSide side = (bit < kBitsPerSide) ? kPlayerFirst : kPlayerSecond;
+			int idx = bit % kBitsPerSide;
+			auto const& player = state.GetBoard().Get(side);
+			if (idx == 0) return player.GetHeroRef();
+			return player.minions_.Get((size_t)(idx - 1));
+		}
+
+		inline CardRef TargetsBitset::Get(state::State const& state, int nth) const {
+			assert(nth >= 0 && nth < Count());
+			uint16_t v = bits_;
+			for (int i = 0; i < nth; ++i) v &= (v - 1); // clear the lowest bits
+			assert(v != 0);
+
+			int bit = 0;
+			while (!(v & GetMask(bit))) ++bit;
+			return GetCardRef(state, bit);
+		}
+
+		template <typename Functor>
+		inline void TargetsBitset::ForEach(state::State const& state, Functor&& functor) const {
+			for (int bit = 0; bit < 2 * kBitsPerSide; ++bit) {
+				if (!(bits_ & GetMask(bit))) continue;
+				if (!functor(GetCardRef(state, bit))) return;
+			}
+		}
 	}
 }
\ No newline at end of file
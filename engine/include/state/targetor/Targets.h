@@ -1,8 +1,8 @@
 #pragma once
 
 #include <vector>
-#include <unordered_set>
 #include "state/Types.h"
+#include "state/targetor/TargetsBitset.h"
 
 namespace engine {
 	namespace FlowControl { class Manipulate; }
@@ -46,7 +46,9 @@ namespace state {
 
 		public:
 			void Fill(state::State const& state, std::vector<CardRef>& targets) const;
-			void Fill(state::State const& state, std::unordered_set<CardRef>& targets) const;
+
+			// Same targets as Fill(), but without allocation
+			TargetsBitset GetBitset(state::State const& state) const;
 
 			template <typename Functor>
 			void ForEach(state::State const& state, Functor&& func) const;
@@ -60,6 +62,10 @@ namespace state {
 			template <typename Functor>
 			bool ProcessPlayerTargets(state::State const& state, board::Player const& player, Functor&& functor) const;
 
+			void FillPlayerBitset(state::State const& state, state::PlayerSide side, TargetsBitset & bitset) const;
+
+			bool CheckCard(state::State const& state, CardRef card_ref) const;
+
 			bool CheckTargetableFilter(state::State const& state, state::Cards::Card const& card) const;
 			bool CheckFilter(state::State const& state, state::Cards::Card const& card) const;
 
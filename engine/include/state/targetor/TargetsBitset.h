@@ -0,0 +1,63 @@
+#pragma once
+
+#include <assert.h>
+#include <stdint.h>
+#include "state/Types.h"
+
+namespace state {
+	class State;
+
+	namespace targetor {
+		// A set of targets on the board, encoded as bits
+		// The bits are ordered in the same order as Targets::Fill():
+		//    bit 0: first hero; bits 1~7: first player's minions by zone position
+		//    bit 8: second hero; bits 9~15: second player's minions by zone position
+		class TargetsBitset
+		{
+		public:
+			static constexpr int kBitsPerSide = 8;
+
+			TargetsBitset() : bits_(0) {}
+
+			void SetHero(PlayerSide side) {
+				bits_ |= GetMask(GetSideOffset(side));
+			}
+
+			void SetMinion(PlayerSide side, int zone_pos) {
+				assert(zone_pos >= 0 && zone_pos < kBitsPerSide - 1);
+				bits_ |= GetMask(GetSideOffset(side) + 1 + zone_pos);
+			}
+
+			bool Empty() const { return bits_ == 0; }
+
+			int Count() const {
+				int count = 0;
+				for (uint16_t v = bits_; v; v &= (v - 1)) ++count;
+				return count;
+			}
+
+			bool operator==(TargetsBitset rhs) const { return bits_ == rhs.bits_; }
+			bool operator!=(TargetsBitset rhs) const { return bits_ != rhs.bits_; }
+
+			// Get the n-th target (zero-based)
+			CardRef Get(state::State const& state, int nth) const;
+
+			// Functor parameters: CardRef
+			//    Return false to stop iterating
+			template <typename Functor>
+			void ForEach(state::State const& state, Functor&& functor) const;
+
+		private:
+			static int GetSideOffset(PlayerSide side) {
+				assert(side == kPlayerFirst || side == kPlayerSecond);
+				return side == kPlayerFirst ? 0 : kBitsPerSide;
+			}
+			static uint16_t GetMask(int bit) { return (uint16_t)(1 << bit); }
+
+			static CardRef GetCardRef(state::State const& state, int bit);
+
+		private:
+			uint16_t bits_;
+		};
+	}
+}
@@ -2,7 +2,6 @@
 
 #include <assert.h>
 #include <vector>
-#include <unordered_set>
 #include "state/Types.h"
 #include "state/targetor/Targets.h"
 
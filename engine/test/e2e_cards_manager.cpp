@@ -0,0 +1,54 @@
+#include <vector>
+#include <assert.h>
+
+#include "state/Cards/Manager.h"
+
+static state::Cards::Card MakeCard(int cost)
+{
+	state::Cards::CardData data;
+	data.zone = state::kCardZoneNewlyCreated;
+	data.enchanted_states.cost = cost;
+	return state::Cards::Card(data);
+}
+
+template <class ManagerType>
+static void FillCards(ManagerType & mgr, std::vector<state::CardRef> & refs, int cards)
+{
+	for (int i = 0; i < cards; ++i) {
+		refs.push_back(mgr.PushBack(MakeCard(i)));
+	}
+}
+
+static void TestCopyOnWrite()
+{
+	state::Cards::Manager base;
+	std::vector<state::CardRef> refs;
+	FillCards(base, refs, 40);
+
+	state::Cards::Manager copy;
+	copy.RefCopy(base);
+	assert(copy.GetChangeId() == base.GetChangeId());
+
+	copy.GetMutable(refs[3]).SetCost(100);
+	assert(copy.GetChangeId() != base.GetChangeId());
+	assert(copy.Get(refs[3]).GetCost() == 100);
+	assert(base.Get(refs[3]).GetCost() == 3);
+	assert(copy.Get(refs[4]).GetCost() == 4);
+
+	state::Cards::Manager copy2 = copy;
+	copy2.GetMutable(refs[3]).SetCost(200);
+	auto new_ref = copy2.PushBack(MakeCard(50));
+	assert(copy2.Get(refs[3]).GetCost() == 200);
+	assert(copy.Get(refs[3]).GetCost() == 100);
+	assert(base.Get(refs[3]).GetCost() == 3);
+	assert(copy2.Get(new_ref).GetCost() == 50);
+
+	base.GetMutable(refs[39]).SetCost(300);
+	assert(copy.Get(refs[39]).GetCost() == 39);
+	assert(copy2.Get(refs[39]).GetCost() == 39);
+}
+
+void test_cards_manager()
+{
+	TestCopyOnWrite();
+}
@@ -0,0 +1,151 @@
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <assert.h>
+
+#include "Utils/CloneableContainers/Vector.h"
+#include "Utils/NeverShrinkVector.h"
+#include "state/Cards/Manager.h"
+
+// The previous design of state::Cards::Manager: a whole-vector copy-on-write store.
+// Kept here as the baseline of the benchmark.
+class WholeVectorCardsManager
+{
+public:
+	using ItemType = Utils::PersistentOptionalItem<state::Cards::Card>;
+	typedef Utils::CloneableContainers::Vector<ItemType, Utils::NeverShrinkVector<ItemType>> ContainerType;
+
+	WholeVectorCardsManager() : base_(nullptr), cards_() {}
+
+	WholeVectorCardsManager(WholeVectorCardsManager const&) = delete;
+	WholeVectorCardsManager & operator=(WholeVectorCardsManager const&) = delete;
+
+	void RefCopy(WholeVectorCardsManager const& base) {
+		assert(base.base_ == nullptr);
+		base_ = &base;
+
+		cards_.Reset();
+		cards_.Resize(base.cards_.Size());
+	}
+
+	state::Cards::Card const& Get(state::CardRef id) const {
+		auto const& item = cards_.Get(id.id);
+		if (item.HasSet()) return item.Get();
+		return base_->Get(id);
+	}
+
+	state::Cards::Card & GetMutable(state::CardRef id) {
+		auto & item = cards_.Get(id.id);
+		if (item.HasSet()) return item.Get();
+		item.RefCopy(base_->Get(id));
+		return item.Get();
+	}
+
+	state::CardRef PushBack(state::Cards::Card && card) {
+		return state::CardRef(cards_.PushBack(std::move(card)));
+	}
+
+private:
+	WholeVectorCardsManager const* base_;
+	ContainerType cards_;
+};
+
+// state::Cards::Manager with another page size
+template <size_t PageSize>
+class PagedCardsManager
+{
+public:
+	typedef Utils::CloneableContainers::CopyOnWriteVector<state::Cards::Card, PageSize> ContainerType;
+
+	PagedCardsManager() : cards_() {}
+
+	void RefCopy(PagedCardsManager const& base) { cards_ = base.cards_; }
+
+	state::Cards::Card const& Get(state::CardRef id) const { return cards_.Get(id.id); }
+	state::Cards::Card & GetMutable(state::CardRef id) { return cards_.GetMutable(id.id); }
+
+	state::CardRef PushBack(state::Cards::Card && card) {
+		return state::CardRef(cards_.PushBack(std::move(card)));
+	}
+
+private:
+	ContainerType cards_;
+};
+
+static state::Cards::Card MakeCard(int cost)
+{
+	state::Cards::CardData data;
+	data.zone = state::kCardZoneNewlyCreated;
+	data.enchanted_states.cost = cost;
+	return state::Cards::Card(data);
+}
+
+template <class ManagerType>
+static void FillCards(ManagerType & mgr, std::vector<state::CardRef> & refs, int cards)
+{
+	for (int i = 0; i < cards; ++i) {
+		refs.push_back(mgr.PushBack(MakeCard(i)));
+	}
+}
+
+// Each thread copies from the same base, as the MCTS threads do from the root state
+// @return  Wall time in microseconds
+template <class ManagerType>
+static long long BenchmarkRefCopy(int cards, int mutations, int runs, int threads)
+{
+	ManagerType base;
+	std::vector<state::CardRef> refs;
+	FillCards(base, refs, cards);
+
+	std::atomic<long long> checksum(0);
+	auto thread_main = [&]() {
+		long long sum = 0;
+		for (int run = 0; run < runs; ++run) {
+			ManagerType copy;
+			copy.RefCopy(base);
+			for (int i = 0; i < mutations; ++i) {
+				auto ref = refs[(run + i * 7) % cards];
+				copy.GetMutable(ref).SetArmor(i);
+				sum += copy.Get(ref).GetArmor();
+			}
+		}
+		checksum += sum;
+	};
+
+	auto start = std::chrono::steady_clock::now();
+	std::vector<std::thread> workers;
+	for (int i = 0; i < threads; ++i) workers.emplace_back(thread_main);
+	for (auto & worker : workers) worker.join();
+	auto end = std::chrono::steady_clock::now();
+	assert(checksum == (long long)threads * runs * mutations * (mutations - 1) / 2);
+
+	return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+}
+
+int main(void)
+{
+	constexpr int kRuns = 20000;
+	int max_threads = std::max(1, (int)std::thread::hardware_concurrency());
+	std::cout << "Current page size: " << state::Cards::Manager::kCardsPerPage << " cards." << std::endl;
+
+	for (int threads : { 1, max_threads }) {
+		for (int cards : { 32, 64, 128, 512 }) {
+			for (int mutations : { 1, 8, 32 }) {
+				std::cout << "Cards::Manager RefCopy + " << mutations << " mutations"
+					<< " (" << cards << " cards, " << threads << " threads, " << kRuns << " runs each):"
+					<< " whole-vector " << BenchmarkRefCopy<WholeVectorCardsManager>(cards, mutations, kRuns, threads) << " us;"
+					<< " paged(1) " << BenchmarkRefCopy<PagedCardsManager<1>>(cards, mutations, kRuns, threads) << " us;"
+					<< " paged(4) " << BenchmarkRefCopy<PagedCardsManager<4>>(cards, mutations, kRuns, threads) << " us;"
+					<< " paged(8) " << BenchmarkRefCopy<PagedCardsManager<8>>(cards, mutations, kRuns, threads) << " us;"
+					<< " paged(16) " << BenchmarkRefCopy<PagedCardsManager<16>>(cards, mutations, kRuns, threads) << " us;"
+					<< " paged(32) " << BenchmarkRefCopy<PagedCardsManager<32>>(cards, mutations, kRuns, threads) << " us."
+					<< std::endl;
+			}
+		}
+		if (max_threads == 1) break;
+	}
+	return 0;
+}
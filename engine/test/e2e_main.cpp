@@ -11,6 +11,7 @@
 void test2();
 void test3();
 void test4();
+void test_cards_manager();
 
 #ifdef _MSC_VER
 #pragma warning( push )
@@ -56,5 +57,7 @@ int main(void)
 	test3();
 	test4();
 
+	test_cards_manager();
+
 	return 0;
 }
\ No newline at end of file
@@ -1,7 +1,9 @@
 #pragma once
 
+#include <cstdint>
 #include <functional>
 #include <random>
+#include <vector>
 
 #include "state/State.h"
 #include "engine/view/BoardRefView.h"
@@ -22,6 +24,13 @@ namespace judge
 
 		virtual void Think(engine::view::BoardRefView game_state , std::mt19937 & random) = 0;
 
-		virtual int GetAction(engine::ActionType::Types action_type, engine::ActionChoices action_choices) = 0;
+		virtual int GetAction(engine::ActionType::Types action_type, engine::ActionChoices action_choices, std::mt19937 & random) = 0;
+
+		// The visit counts to each choice of the last GetAction(), for an agent which searches
+		// Empty if not available.
+		virtual std::vector<std::int64_t> const& GetLastChoiceVisits() const {
+			static std::vector<std::int64_t> const kEmpty;
+			return kEmpty;
+		}
 	};
 }
@@ -18,7 +18,7 @@ namespace judge
 	{
 	public:
 		void Start() {}
-		void RecordMainAction(state::State const& state, engine::MainOpType op) {}
+		void RecordMainAction(state::State const& state, engine::MainOpType op, MainOpVisits const& visits) {}
 		void RecordRandomAction(int exclusive_max, int action) {}
 		void RecordManualAction(engine::ActionType::Types action_type, engine::ActionChoices action_choices, int action) {}
 		void End(engine::Result result) {}
@@ -53,7 +53,7 @@ namespace judge
 
 				if (action_type == engine::ActionType::kMainAction) {
 					auto main_op = analyzer_.GetMainActions()[action];
-					guide_.recorder_.RecordMainAction(*state_, main_op);
+					guide_.recorder_.RecordMainAction(*state_, main_op, GetMainOpVisits());
 					return action;
 				}
 				else {
@@ -63,6 +63,19 @@ namespace judge
 				return action;
 			}
 
+		private:
+			// The agent reports its visits by choice; a main-action choice indexes the analyzed main ops
+			MainOpVisits GetMainOpVisits() {
+				MainOpVisits visits;
+				visits.fill(-1);
+				auto const& choice_visits = cb_->GetLastChoiceVisits();
+				for (int choice = 0; choice < analyzer_.GetMainActionsCount(); ++choice) {
+					auto op = analyzer_.GetMainActions()[choice];
+					visits[op] = ((size_t)choice < choice_visits.size()) ? choice_visits[choice] : 0;
+				}
+				return visits;
+			}
+
 		private:
 			Judger & guide_;
 			AgentType * cb_;
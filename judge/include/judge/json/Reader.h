@@ -1,7 +1,13 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
+#include <type_traits>
+
 #include "json/json.h"
+#include "engine/MainOp.h"
 #include "neural_net/NeuralNetwork.h"
+#include "neural_net/PolicyNetwork.h"
 
 namespace judge
 {
@@ -160,6 +166,8 @@ namespace judge
 		class Reader
 		{
 		public:
+			// @param cb  Invoked as cb(GetterType const&, int label) for each main action, in order;
+			//            or as cb(GetterType const&, int label, neural_net::MainOpPolicy const&) if it accepts the policy
 			template <class Callback, class GetterType = NeuralNetInputGetter>
 			void Parse(Json::Value const& obj, Callback&& cb) {
 				std::string result = GetResult(obj);
@@ -168,11 +176,28 @@ namespace judge
 						Json::Value const& board = obj[idx]["board"];
 
 						int label = IsCurrentPlayerWin(board, result) ? 1 : -1;
-						cb(GetterType(board), label);
+						if constexpr (std::is_invocable_v<Callback&, GetterType const&, int, neural_net::MainOpPolicy const&>) {
+							cb(GetterType(board), label, GetPolicy(obj[idx]["policy"]));
+						}
+						else {
+							cb(GetterType(board), label);
+						}
 					}
 				}
 			}
 
+			// The visit distribution over the main ops written by Recorder; empty if not recorded
+			static neural_net::MainOpPolicy GetPolicy(Json::Value const& policy) {
+				std::array<std::int64_t, neural_net::kMainOps> visits;
+				visits.fill(-1);
+				if (!policy.isObject()) return neural_net::MainOpPolicy::Empty();
+				for (int i = 0; i < neural_net::kMainOps; ++i) {
+					auto const& v = policy[engine::GetMainOpString((engine::MainOpType)i)];
+					if (!v.isNull()) visits[i] = v.asInt64();
+				}
+				return neural_net::MainOpPolicy::FromVisits(visits);
+			}
+
 		private:
 			std::string GetResult(Json::Value const& obj) {
 				for (Json::ArrayIndex idx = 0; idx < obj.size(); ++idx) {
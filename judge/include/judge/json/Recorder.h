@@ -1,5 +1,7 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
 #include <random>
 #include <string>
 
@@ -10,6 +12,10 @@
 
 namespace judge
 {
+	// The visit counts of an agent's search to each main op (indexed by engine::MainOpType)
+	// -1 for the ops not available
+	using MainOpVisits = std::array<std::int64_t, engine::kMainOpMax>;
+
 	namespace json {
 		class Recorder
 		{
@@ -20,13 +26,21 @@ namespace judge
 				json_.clear();
 			}
 
-			void RecordMainAction(state::State const& state, engine::MainOpType op)
+			void RecordMainAction(state::State const& state, engine::MainOpType op, MainOpVisits const& visits)
 			{
 				Json::Value obj;
 				obj["type"] = "kMainAction";
 				obj["board"] = engine::JsonSerializer::Serialize(state);
 				obj["choice"] = engine::GetMainOpString(op);
 
+				// the target of the policy network; see Reader
+				Json::Value policy;
+				for (int i = 0; i < engine::kMainOpMax; ++i) {
+					if (visits[i] < 0) continue;
+					policy[engine::GetMainOpString((engine::MainOpType)i)] = (Json::Int64)visits[i];
+				}
+				if (!policy.isNull()) obj["policy"] = policy;
+
 				json_.append(obj);
 			}
 
@@ -0,0 +1,397 @@
+#pragma once
+
+#include <assert.h>
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "engine/MainOp.h"
+#include "neural_net/NeuralNetwork.h"
+#include "neural_net/PolicyNetwork.h"
+
+namespace judge
+{
+	namespace json
+	{
+		// The fields of a board seen by the neural network, in the layout written by engine::JsonSerializer
+		// A field missing in the json is zero, the same as reading it by NeuralNetRefInputGetter.
+		class StreamBoard : public neural_net::IInputGetter
+		{
+		public:
+			static constexpr int kMaxMinions = 7;
+			static constexpr int kMaxHandCards = 10;
+
+			struct Minion {
+				int hp;
+				int max_hp;
+				int attack;
+				int attackable;
+				int taunt;
+				int shield;
+				int stealth;
+			};
+
+			struct HandCard {
+				int playable;
+				int cost;
+			};
+
+			struct Player {
+				int resource_current;
+				int resource_total;
+				int resource_overload;
+				int resource_overload_next;
+				int hero_hp;
+				int hero_armor;
+				int hero_power_playable;
+				int minion_count;
+				Minion minions[kMaxMinions];
+				int hand_count;
+				HandCard hand[kMaxHandCards];
+			};
+
+			StreamBoard() : current_player_is_first(false), players() {}
+
+			double GetField(
+				neural_net::FieldSide field_side,
+				neural_net::FieldType field_type,
+				int arg1 = 0) const override final
+			{
+				using neural_net::FieldType;
+				if (field_side != neural_net::FieldSide::kCurrent && field_side != neural_net::FieldSide::kOpponent) {
+					throw std::runtime_error("invalid side");
+				}
+				Player const& player = players[(int)field_side];
+
+				switch (field_type) {
+				case FieldType::kResourceCurrent: return player.resource_current;
+				case FieldType::kResourceTotal: return player.resource_total;
+				case FieldType::kResourceOverload: return player.resource_overload;
+				case FieldType::kResourceOverloadNext: return player.resource_overload_next;
+				case FieldType::kHeroHP: return player.hero_hp;
+				case FieldType::kHeroArmor: return player.hero_armor;
+				case FieldType::kHeroPowerPlayable: return player.hero_power_playable;
+
+				case FieldType::kMinionCount: return player.minion_count;
+				case FieldType::kMinionHP: return GetMinion(player, arg1).hp;
+				case FieldType::kMinionMaxHP: return GetMinion(player, arg1).max_hp;
+				case FieldType::kMinionAttack: return GetMinion(player, arg1).attack;
+				case FieldType::kMinionAttackable: return GetMinion(player, arg1).attackable;
+				case FieldType::kMinionTaunt: return GetMinion(player, arg1).taunt;
+				case FieldType::kMinionShield: return GetMinion(player, arg1).shield;
+				case FieldType::kMinionStealth: return GetMinion(player, arg1).stealth;
+
+				case FieldType::kHandCount: return player.hand_count;
+				case FieldType::kHandPlayable: return GetHandCard(player, arg1).playable;
+				case FieldType::kHandCost: return GetHandCard(player, arg1).cost;
+
+				default:
+					throw std::runtime_error("unknown field type");
+				}
+			}
+
+		private:
+			static Minion const& GetMinion(Player const& player, int idx) {
+				assert(idx >= 0 && idx < player.minion_count);
+				return player.minions[idx];
+			}
+			static HandCard const& GetHandCard(Player const& player, int idx) {
+				assert(idx >= 0 && idx < player.hand_count);
+				return player.hand[idx];
+			}
+
+		public:
+			bool current_player_is_first;
+			Player players[2]; // indexed by neural_net::FieldSide
+		};
+
+		// Reads a game log written by Recorder in one pass, without building the json DOM
+		// Only the fields seen by the neural network are extracted; everything else is skipped.
+		// Gives the same boards and labels as Reader::Parse().
+		class StreamReader
+		{
+		public:
+			StreamReader() : pos_(nullptr), end_(nullptr), boards_(), policies_() {}
+
+			StreamReader(StreamReader const&) = delete;
+			StreamReader & operator=(StreamReader const&) = delete;
+
+			// Thread safety: No. Use one reader per thread.
+			// @param cb  Invoked as cb(StreamBoard const&, int label) for each main action, in order;
+			//            or as cb(StreamBoard const&, int label, neural_net::MainOpPolicy const&) if it accepts the policy
+			template <class Callback>
+			void Parse(char const* begin, char const* end, Callback&& cb) {
+				pos_ = begin;
+				end_ = end;
+				boards_.clear();
+				policies_.clear();
+
+				std::string_view result;
+				ForEachElement([&]() {
+					ParseAction(result);
+				});
+				if (result.empty()) throw std::runtime_error("Cannot find win player");
+
+				bool first_player_win = IsResultWin(result);
+				for (size_t i = 0; i < boards_.size(); ++i) {
+					auto const& board = boards_[i];
+					int label = (board.current_player_is_first == first_player_win) ? 1 : -1;
+					if constexpr (std::is_invocable_v<Callback&, StreamBoard const&, int, neural_net::MainOpPolicy const&>) {
+						cb(board, label, policies_[i]);
+					}
+					else {
+						cb(board, label);
+					}
+				}
+			}
+
+		private:
+			void ParseAction(std::string_view & result) {
+				// members are sorted by name, so the board comes before its type
+				bool has_board = false;
+				bool is_main_action = false;
+				auto policy = neural_net::MainOpPolicy::Empty();
+				ForEachMember([&](std::string_view key) {
+					if (key == "board") {
+						boards_.emplace_back();
+						ParseBoard(boards_.back());
+						has_board = true;
+					}
+					else if (key == "policy") policy = ParsePolicy();
+					else if (key == "type") is_main_action = (ParseString() == "kMainAction");
+					else if (key == "result") result = ParseString();
+					else SkipValue();
+				});
+				if (!has_board) return;
+				if (is_main_action) policies_.push_back(policy);
+				else boards_.pop_back();
+			}
+
+			// Same as Reader::GetPolicy()
+			neural_net::MainOpPolicy ParsePolicy() {
+				std::array<std::int64_t, neural_net::kMainOps> visits;
+				visits.fill(-1);
+				ForEachMember([&](std::string_view key) {
+					for (int i = 0; i < neural_net::kMainOps; ++i) {
+						if (key == engine::GetMainOpString((engine::MainOpType)i)) {
+							visits[i] = ParseScalar();
+							return;
+						}
+					}
+					SkipValue();
+				});
+				return neural_net::MainOpPolicy::FromVisits(visits);
+			}
+
+			void ParseBoard(StreamBoard & board) {
+				ForEachMember([&](std::string_view key) {
+					if (key == "current_player_id") {
+						auto player = ParseString();
+						if (player == "kFirstPlayer") board.current_player_is_first = true;
+						else if (player == "kSecondPlayer") board.current_player_is_first = false;
+						else throw std::runtime_error("Failed to parse current player");
+					}
+					else if (key == "current_player") ParsePlayer(board.players[(int)neural_net::FieldSide::kCurrent]);
+					else if (key == "opponent_player") ParsePlayer(board.players[(int)neural_net::FieldSide::kOpponent]);
+					else SkipValue();
+				});
+			}
+
+			void ParsePlayer(StreamBoard::Player & player) {
+				ForEachMember([&](std::string_view key) {
+					if (key == "resource") {
+						ForEachMember([&](std::string_view key) {
+							if (key == "current") player.resource_current = ParseScalar();
+							else if (key == "total") player.resource_total = ParseScalar();
+							else if (key == "overload_current") player.resource_overload = ParseScalar();
+							else if (key == "overload_next") player.resource_overload_next = ParseScalar();
+							else SkipValue();
+						});
+					}
+					else if (key == "hero") {
+						ForEachMember([&](std::string_view key) {
+							if (key == "hp") player.hero_hp = ParseScalar();
+							else if (key == "armor") player.hero_armor = ParseScalar();
+							else SkipValue();
+						});
+					}
+					else if (key == "hero_power") {
+						ForEachMember([&](std::string_view key) {
+							if (key == "playable") player.hero_power_playable = ParseScalar();
+							else SkipValue();
+						});
+					}
+					else if (key == "minions") {
+						ForEachElement([&]() {
+							if (player.minion_count >= StreamBoard::kMaxMinions) throw std::runtime_error("too many minions");
+							auto & minion = player.minions[player.minion_count++];
+							ForEachMember([&](std::string_view key) {
+								if (key == "hp") minion.hp = ParseScalar();
+								else if (key == "max_hp") minion.max_hp = ParseScalar();
+								else if (key == "attack") minion.attack = ParseScalar();
+								else if (key == "attackable") minion.attackable = ParseScalar();
+								else if (key == "taunt") minion.taunt = ParseScalar();
+								else if (key == "shield") minion.shield = ParseScalar();
+								else if (key == "stealth") minion.stealth = ParseScalar();
+								else SkipValue();
+							});
+						});
+					}
+					else if (key == "hand") {
+						ForEachElement([&]() {
+							if (player.hand_count >= StreamBoard::kMaxHandCards) throw std::runtime_error("too many hand cards");
+							auto & card = player.hand[player.hand_count++];
+							ForEachMember([&](std::string_view key) {
+								if (key == "playable") card.playable = ParseScalar();
+								else if (key == "cost") card.cost = ParseScalar();
+								else SkipValue();
+							});
+						});
+					}
+					else SkipValue();
+				});
+			}
+
+			bool IsResultWin(std::string_view win_player) {
+				if (win_player == "kResultFirstPlayerWin") return true;
+				if (win_player == "kResultSecondPlayerWin") return false;
+				if (win_player == "kResultDraw") return false;
+				throw std::runtime_error("Failed to parse winning player");
+			}
+
+		private:
+			// @param f  Invoked as f(key) for each member; it should consume the value
+			template <class Functor>
+			void ForEachMember(Functor && f) {
+				if (SkipWhitespaces() == 'n') { SkipLiteral("null"); return; } // an empty container is written as null
+				Expect('{');
+				if (SkipWhitespaces() == '}') { ++pos_; return; }
+				while (true) {
+					SkipWhitespaces();
+					auto key = ParseString();
+					Expect(':');
+					SkipWhitespaces();
+					f(key);
+					char c = SkipWhitespaces();
+					++pos_;
+					if (c == '}') return;
+					if (c != ',') throw std::runtime_error("json: expect ',' or '}'");
+				}
+			}
+
+			// @param f  Invoked as f() for each element; it should consume the value
+			template <class Functor>
+			void ForEachElement(Functor && f) {
+				if (SkipWhitespaces() == 'n') { SkipLiteral("null"); return; } // an empty container is written as null
+				Expect('[');
+				if (SkipWhitespaces() == ']') { ++pos_; return; }
+				while (true) {
+					SkipWhitespaces();
+					f();
+					char c = SkipWhitespaces();
+					++pos_;
+					if (c == ']') return;
+					if (c != ',') throw std::runtime_error("json: expect ',' or ']'");
+				}
+			}
+
+			// @return  The raw content between the quotes; escape sequences are not decoded
+			std::string_view ParseString() {
+				Expect('"');
+				char const* start = pos_;
+				while (pos_ < end_) {
+					char c = *pos_++;
+					if (c == '\\') ++pos_;
+					else if (c == '"') return std::string_view(start, pos_ - 1 - start);
+				}
+				throw std::runtime_error("json: unterminated string");
+			}
+
+			// A number (truncated to int), or a boolean (as 0 or 1), or null (as 0)
+			int ParseScalar() {
+				char c = SkipWhitespaces();
+				if (c == 't') { SkipLiteral("true"); return 1; }
+				if (c == 'f') { SkipLiteral("false"); return 0; }
+				if (c == 'n') { SkipLiteral("null"); return 0; }
+
+				bool negative = false;
+				if (c == '-') { negative = true; ++pos_; }
+				if (pos_ >= end_ || *pos_ < '0' || *pos_ > '9') throw std::runtime_error("json: expect a number");
+				int v = 0;
+				while (pos_ < end_ && *pos_ >= '0' && *pos_ <= '9') {
+					v = v * 10 + (*pos_ - '0');
+					++pos_;
+				}
+				SkipScalar(); // fraction and exponent
+				return negative ? -v : v;
+			}
+
+			void SkipValue() {
+				char c = SkipWhitespaces();
+				if (c == '"') {
+					ParseString();
+					return;
+				}
+				if (c != '{' && c != '[') {
+					SkipScalar();
+					return;
+				}
+
+				int depth = 0;
+				while (pos_ < end_) {
+					c = *pos_;
+					if (c == '"') {
+						ParseString();
+						continue;
+					}
+					++pos_;
+					if (c == '{' || c == '[') ++depth;
+					else if (c == '}' || c == ']') {
+						if (--depth == 0) return;
+					}
+				}
+				throw std::runtime_error("json: unexpected end");
+			}
+
+			void SkipScalar() {
+				while (pos_ < end_) {
+					char c = *pos_;
+					if (c == ',' || c == '}' || c == ']' || IsWhitespace(c)) return;
+					++pos_;
+				}
+			}
+
+			void SkipLiteral(std::string_view literal) {
+				if ((size_t)(end_ - pos_) < literal.size() || std::string_view(pos_, literal.size()) != literal) {
+					throw std::runtime_error("json: invalid literal");
+				}
+				pos_ += literal.size();
+			}
+
+			void Expect(char c) {
+				if (SkipWhitespaces() != c) throw std::runtime_error(std::string("json: expect '") + c + "'");
+				++pos_;
+			}
+
+			// @return  The next character; or '\0' at the end
+			char SkipWhitespaces() {
+				while (pos_ < end_ && IsWhitespace(*pos_)) ++pos_;
+				return (pos_ < end_) ? *pos_ : '\0';
+			}
+
+			static bool IsWhitespace(char c) {
+				return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+			}
+
+		private:
+			char const* pos_;
+			char const* end_;
+			std::vector<StreamBoard> boards_;
+			std::vector<neural_net::MainOpPolicy> policies_; // policies_[i] is of boards_[i]
+		};
+	}
+}
@@ -50,6 +50,7 @@ namespace ui
 			});
 
 			config_.tree_samples = root_sample_count;
+			config_.tree_max_bytes = (std::int64_t)2 * 1024 * 1024 * 1024;
 			config_.mcts.SetNeuralNetPath("neural_net");
 
 			shell_.SetConfig(config_, random_);
@@ -150,6 +151,14 @@ namespace ui
 						Log(ss.str());
 					}
 
+					{
+						std::stringstream ss;
+						auto tree_memory = controller_->GetTreeMemoryUsage().Get();
+						ss << "Tree nodes: " << tree_memory.nodes
+							<< " (about " << (tree_memory.GetEstimatedBytes() >> 20) << " MB)";
+						Log(ss.str());
+					}
+
 					last_report_rest_sec = rest_sec;
 				}
 				return true;